@@ -0,0 +1,116 @@
+#include "alias_table.hpp"
+
+#include <chrono>
+#include <cmath>
+
+#include "parallel.hpp"
+
+namespace {
+float sanitizedWeight(float w) { return std::isfinite(w) && w > 0.0f ? w : 0.0f; }
+}  // namespace
+
+std::vector<AliasEntry> buildAliasTable(std::span<const float> weights, AliasTableStats* stats) {
+    auto start     = std::chrono::steady_clock::now();
+    const size_t n = weights.size();
+    std::vector<AliasEntry> entries(n);
+    if (n == 0) return entries;
+
+    // the same chunk partition serves the sum and both split passes
+    const size_t chunkCount = std::min(workerCount(), (n + 65535) / 65536);
+    std::vector<double> partialSums(std::max<size_t>(1, chunkCount), 0.0);
+    parallelForChunks(n, chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+        double sum = 0.0;
+        for (size_t i = begin; i < end; i++) sum += sanitizedWeight(weights[i]);
+        partialSums[chunk] = sum;
+    });
+    double total = 0.0;
+    for (double sum : partialSums) total += sum;
+    const bool uniform = total <= 0.0;
+
+    // weights scaled so the average bucket holds 1; count the small (< 1) ones per chunk
+    std::vector<double> scaled(n);
+    std::vector<size_t> smallCounts(partialSums.size(), 0);
+    parallelForChunks(n, chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+        size_t smallCount = 0;
+        for (size_t i = begin; i < end; i++) {
+            float w           = sanitizedWeight(weights[i]);
+            scaled[i]         = uniform ? 1.0 : double(w) * double(n) / total;
+            entries[i].weight = w;
+            entries[i].pdf    = uniform ? 1.0f / float(n) : float(double(w) / total);
+            smallCount += scaled[i] < 1.0 ? 1 : 0;
+        }
+        smallCounts[chunk] = smallCount;
+    });
+
+    // small and large index lists in index order: chunk offsets from a prefix sum, then a parallel fill.
+    // Both lists are used as stacks below and can together never hold more than n indices.
+    std::vector<size_t> smallOffsets(smallCounts.size(), 0);
+    std::vector<size_t> largeOffsets(smallCounts.size(), 0);
+    size_t smallTotal = 0;
+    size_t largeTotal = 0;
+    for (size_t c = 0; c < smallCounts.size(); c++) {
+        size_t chunkSize = n * (c + 1) / smallCounts.size() - n * c / smallCounts.size();
+        smallOffsets[c]  = smallTotal;
+        largeOffsets[c]  = largeTotal;
+        smallTotal += smallCounts[c];
+        largeTotal += chunkSize - smallCounts[c];
+    }
+    std::vector<uint32_t> small(n);
+    std::vector<uint32_t> large(n);
+    parallelForChunks(n, chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+        size_t s = smallOffsets[chunk];
+        size_t l = largeOffsets[chunk];
+        for (size_t i = begin; i < end; i++) {
+            if (scaled[i] < 1.0) {
+                small[s++] = static_cast<uint32_t>(i);
+            } else {
+                large[l++] = static_cast<uint32_t>(i);
+            }
+        }
+    });
+
+    // Vose: every small bucket is topped up by a large one, which loses what it gave away
+    size_t smallSize = smallTotal;
+    size_t largeSize = largeTotal;
+    while (smallSize > 0 && largeSize > 0) {
+        uint32_t s = small[--smallSize];
+        uint32_t l = large[largeSize - 1];
+
+        entries[s].probability = static_cast<float>(scaled[s]);
+        entries[s].alias       = l;
+        scaled[l]              = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0) {
+            largeSize--;
+            small[smallSize++] = l;
+        }
+    }
+    // whatever is left is 1 up to rounding
+    while (largeSize > 0) {
+        uint32_t l             = large[--largeSize];
+        entries[l].probability = 1.0f;
+        entries[l].alias       = l;
+    }
+    while (smallSize > 0) {
+        uint32_t s             = small[--smallSize];
+        entries[s].probability = 1.0f;
+        entries[s].alias       = s;
+    }
+
+    if (stats) {
+        stats->totalWeight = total;
+        stats->uniform     = uniform;
+        stats->buildMs     = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return entries;
+}
+
+std::vector<double> aliasTableProbabilities(std::span<const AliasEntry> entries) {
+    std::vector<double> probabilities(entries.size(), 0.0);
+    const double bucket = entries.empty() ? 0.0 : 1.0 / double(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        double keep = std::clamp(double(entries[i].probability), 0.0, 1.0);
+        probabilities[i] += bucket * keep;
+        probabilities[entries[i].alias] += bucket * (1.0 - keep);
+    }
+    return probabilities;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Walker/Vose alias table: O(1) sampling of index i with probability weights[i] / sum(weights)
+ *
+ * Sampling with two uniforms u0, u1 in [0, 1):
+ *   i = min(floor(u0 * N), N - 1)
+ *   result = u1 < entries[i].probability ? i : entries[i].alias
+ *   pdf = entries[result].pdf
+ * No Vulkan or glm types, so the builder can be exercised on the CPU alone; the entry layout
+ * matches the AliasEntry StructuredBuffer in restir.slang.
+ */
+struct AliasEntry {
+    float probability;  // of keeping the bucket's own index
+    uint32_t alias;     // taken otherwise
+    float pdf;          // weights[i] / sum(weights) of this entry's own index
+    float weight;       // weights[i] as given (negative and non-finite inputs read as 0)
+};
+static_assert(sizeof(AliasEntry) == 16, "std430 layout of AliasEntry in restir.slang");
+
+struct AliasTableStats {
+    double totalWeight = 0.0;
+    double buildMs     = 0.0;
+    bool uniform       = false;  // every weight was 0, the table samples uniformly
+};
+
+/**
+ * @brief build the table in O(N)
+ *
+ * Normalization and the small/large split run on all worker threads (parallel.hpp), the pairing
+ * pass is a single linear sweep. Buckets left over by rounding get probability 1.
+ */
+std::vector<AliasEntry> buildAliasTable(std::span<const float> weights, AliasTableStats* stats = nullptr);
+
+/**
+ * @brief exact probability of sampling every index from a table, for checking it against the pdfs
+ */
+std::vector<double> aliasTableProbabilities(std::span<const AliasEntry> entries);
@@ -0,0 +1,66 @@
+#include "as_cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+bool AsCache::open(const std::string& path, const AsCacheDevice& device) {
+    if (!file.open(path)) return false;
+    if (file.size() < sizeof(AsCacheHeader)) {
+        file.close();
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    bool valid = header.magic == AS_CACHE_MAGIC && header.version == AS_CACHE_VERSION && header.device.vendorID == device.vendorID &&
+                 header.device.deviceID == device.deviceID && header.device.driverVersion == device.driverVersion &&
+                 memcmp(header.device.pipelineCacheUUID, device.pipelineCacheUUID, AS_CACHE_UUID_SIZE) == 0 && header.entryOffset % 16 == 0 &&
+                 header.entryOffset <= file.size() && header.entryCount <= (file.size() - header.entryOffset) / sizeof(AsCacheEntry);
+    // every blob has to lie inside the file and hold at least the two UUIDs the compatibility check reads
+    for (uint32_t i = 0; i < header.entryCount && valid; i++) {
+        const AsCacheEntry& e = entry(i);
+        valid = e.offset % 16 == 0 && e.offset <= file.size() && e.size <= file.size() - e.offset && e.size >= 2 * AS_CACHE_UUID_SIZE;
+    }
+    if (!valid) {
+        file.close();
+    }
+    return valid;
+}
+
+void AsCache::write(const std::string& path, const AsCacheDevice& device, float buildMilliseconds, const std::vector<AsCacheBlob>& blobs) {
+    auto align16 = [](uint64_t v) { return (v + 15) & ~uint64_t(15); };
+
+    AsCacheHeader header{.magic             = AS_CACHE_MAGIC,
+                         .version           = AS_CACHE_VERSION,
+                         .device            = device,
+                         .entryCount        = static_cast<uint32_t>(blobs.size()),
+                         .buildMilliseconds = buildMilliseconds,
+                         .entryOffset       = align16(sizeof(AsCacheHeader))};
+    std::vector<AsCacheEntry> entries(blobs.size());
+    uint64_t offset = align16(header.entryOffset + blobs.size() * sizeof(AsCacheEntry));
+    for (size_t i = 0; i < blobs.size(); i++) {
+        entries[i] = {.key = blobs[i].key, .offset = offset, .size = blobs[i].size, .structureSize = blobs[i].structureSize};
+        offset     = align16(offset + blobs[i].size);
+    }
+
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("failed to create AS cache " + tmpPath);
+
+        const char zeros[16] = {};
+        auto writeAt = [&](uint64_t offset, const void* src, uint64_t size) {
+            uint64_t pos = static_cast<uint64_t>(out.tellp());
+            out.write(zeros, static_cast<std::streamsize>(offset - pos));  // alignment padding
+            if (size > 0) out.write(static_cast<const char*>(src), static_cast<std::streamsize>(size));
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.entryOffset, entries.data(), entries.size() * sizeof(AsCacheEntry));
+        for (size_t i = 0; i < blobs.size(); i++) {
+            writeAt(entries[i].offset, blobs[i].data, blobs[i].size);
+        }
+        if (!out) throw std::runtime_error("failed to write AS cache " + tmpPath);
+    }
+    std::filesystem::rename(tmpPath, path);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh_cache.hpp"
+
+/**
+ * @brief .vkas: serialized BLASes (vkCmdCopyAccelerationStructureToMemoryKHR output), one entry per submesh
+ *
+ * Layout (little endian, every section 16-byte aligned):
+ *   AsCacheHeader
+ *   AsCacheEntry[entryCount]
+ *   serialized acceleration structures
+ *
+ * The header identifies the device and driver that wrote the file; a file from a different GPU or driver
+ * build is ignored as a whole. Each entry is keyed by the content hash of the geometry it was built from
+ * (plus the build settings), so a stale entry is detected before anything is uploaded. The driver still has
+ * the final word: every blob starts with the driver/compatibility UUIDs that
+ * vkGetDeviceAccelerationStructureCompatibilityKHR checks.
+ */
+constexpr uint32_t AS_CACHE_MAGIC     = 0x53414B56;  // "VKAS"
+constexpr uint32_t AS_CACHE_VERSION   = 1;
+constexpr uint32_t AS_CACHE_UUID_SIZE = 16;
+
+// the device/driver a cache file is valid for (VkPhysicalDeviceProperties)
+struct AsCacheDevice {
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[AS_CACHE_UUID_SIZE];
+};
+
+struct AsCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    AsCacheDevice device;
+    uint32_t entryCount;
+    float buildMilliseconds;  // what building the structures took, reported next to the load time
+    uint64_t entryOffset;
+};
+
+struct AsCacheEntry {
+    uint64_t key;            // geometry content hash + build settings
+    uint64_t offset;         // of the serialized data in the file
+    uint64_t size;           // serialized bytes
+    uint64_t structureSize;  // VkAccelerationStructureCreateInfoKHR::size of the deserialized structure
+};
+
+// one serialized acceleration structure to write
+struct AsCacheBlob {
+    uint64_t key;
+    uint64_t structureSize;
+    const void* data;
+    uint64_t size;
+};
+
+/**
+ * @brief validated view into a mapped .vkas file, pointers stay valid while the AsCache is alive
+ *
+ */
+class AsCache {
+   public:
+    /**
+     * @brief map path and check it was written by this device and driver
+     *
+     * @return false if the file is missing, truncated or from another device/driver
+     */
+    bool open(const std::string& path, const AsCacheDevice& device);
+    void close() { file.close(); }
+
+    uint32_t entryCount() const { return header.entryCount; }
+    float buildMilliseconds() const { return header.buildMilliseconds; }
+    const AsCacheEntry& entry(uint32_t i) const { return reinterpret_cast<const AsCacheEntry*>(file.data() + header.entryOffset)[i]; }
+    const uint8_t* blob(uint32_t i) const { return file.data() + entry(i).offset; }
+
+    /**
+     * @brief write a .vkas file (through a temporary file, like MeshCache::write)
+     */
+    static void write(const std::string& path, const AsCacheDevice& device, float buildMilliseconds, const std::vector<AsCacheBlob>& blobs);
+
+   private:
+    MappedFile file;
+    AsCacheHeader header{};
+};
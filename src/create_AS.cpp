@@ -1,44 +1,179 @@
 #include "tutorial.hpp"
 
-void HelloTriangleApplication::createAccelerationStructures() {
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+double elapsedMs(Clock::time_point from, Clock::time_point to) { return std::chrono::duration<double, std::milli>(to - from).count(); }
+
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+// builds [first, first + count) run in one vkCmdBuildAccelerationStructuresKHR and use scratchSize bytes of the shared scratch buffer
+struct ScratchBatch {
+    size_t first               = 0;
+    size_t count               = 0;
+    vk::DeviceSize scratchSize = 0;
+};
+
+/**
+ * @brief split builds (in order) into batches whose aligned scratch ranges fit in budget
+ *
+ * A build that needs more than the budget on its own gets a batch of its own. scratchOffsets receives the offset of
+ * every build's scratch range inside its batch.
+ */
+std::vector<ScratchBatch> planScratchBatches(const std::vector<vk::DeviceSize>& scratchSizes,
+                                             vk::DeviceSize alignment,
+                                             vk::DeviceSize budget,
+                                             std::vector<vk::DeviceSize>& scratchOffsets) {
+    std::vector<ScratchBatch> batches;
+    scratchOffsets.resize(scratchSizes.size());
+    for (size_t i = 0; i < scratchSizes.size(); i++) {
+        vk::DeviceSize size = alignUp(scratchSizes[i], alignment);
+        if (batches.empty() || batches.back().scratchSize + size > budget) batches.push_back({.first = i});
+        ScratchBatch& batch = batches.back();
+        scratchOffsets[i]   = batch.scratchSize;
+        batch.scratchSize += size;
+        batch.count++;
+    }
+    return batches;
+}
+
+// everything a BLAS depends on; hashed into the AS cache key of its submesh
+struct BlasCacheKey {
+    uint64_t geometryHash;
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t maxVertex;
+    int32_t vertexOffset;
+    uint32_t vertexFormat;
+    uint32_t vertexStride;
+    uint32_t buildFlags;
+    uint32_t reserved;
+};
+
+// one key per submesh, none if the geometry has no content hash (the cache is skipped then)
+std::vector<uint64_t> blasCacheKeys(const std::vector<SubMesh>& submeshes, uint64_t geometryHash) {
+    if (geometryHash == 0) return {};
+    std::vector<uint64_t> keys(submeshes.size());
+    for (size_t i = 0; i < submeshes.size(); i++) {
+        MeshLod lod = submeshes[i].lod(std::min(BLAS_LOD, submeshes[i].lodCount - 1));
+        BlasCacheKey key{
+            .geometryHash = geometryHash,
+            .indexOffset  = lod.indexOffset,
+            .indexCount   = lod.indexCount,
+            .maxVertex    = submeshes[i].maxVertex,
+            .vertexOffset = submeshes[i].vertexOffset,
+            .vertexFormat = static_cast<uint32_t>(PACKED_VERTICES ? PackedVertex::positionFormat : vk::Format::eR32G32B32Sfloat),
+            .vertexStride = static_cast<uint32_t>(PACKED_VERTICES ? PackedVertex::positionStride : sizeof(Vertex)),
+            .buildFlags   = COMPACT_BLAS ? static_cast<uint32_t>(vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction) : 0u,
+            .reserved     = 0};
+        keys[i] = hash64(&key, sizeof(key));
+    }
+    return keys;
+}
+
+// offset of the deserialized size in a serialized acceleration structure (driver UUID, compatibility UUID, serialized size)
+constexpr size_t SERIALIZED_STRUCTURE_SIZE_OFFSET = 2 * AS_CACHE_UUID_SIZE + sizeof(uint64_t);
+// copyAccelerationStructureToMemory / copyMemoryToAccelerationStructure addresses have to be 256-byte aligned
+constexpr vk::DeviceSize SERIALIZED_ALIGNMENT = 256;
+
+// refits require the flags of the build they update, so both use these
+const vk::BuildAccelerationStructureFlagsKHR TLAS_BUILD_FLAGS =
+    vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate | vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace;
+
+// column-major glm::mat4 -> the row-major 3x4 matrix of an instance
+void writeInstanceTransform(const glm::mat4& m, vk::TransformMatrixKHR& transform) {
+    float* dst = &transform.matrix[0][0];
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    __m128 c0 = _mm_loadu_ps(&m[0][0]);
+    __m128 c1 = _mm_loadu_ps(&m[1][0]);
+    __m128 c2 = _mm_loadu_ps(&m[2][0]);
+    __m128 c3 = _mm_loadu_ps(&m[3][0]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(dst, c0);
+    _mm_storeu_ps(dst + 4, c1);
+    _mm_storeu_ps(dst + 8, c2);
+#else
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 4; c++) {
+            dst[r * 4 + c] = m[c][r];
+        }
+    }
+#endif
+}
+
+}  // namespace
+
+/**
+ * @brief build one BLAS per submesh with a single submit
+ *
+ * All builds share one scratch buffer: planScratchBatches() packs them into batches of at most BLAS_SCRATCH_BUDGET
+ * bytes, each batch is one buildAccelerationStructuresKHR call, and a barrier between batches lets the next one reuse
+ * the scratch memory. Batches are timed with timestamp queries when the queue supports them.
+ */
+void HelloTriangleApplication::buildBottomLevelAccelerationStructures() {
+    Clock::time_point start = Clock::now();
+
     // get vertex and index buffer device address
     vk::DeviceAddress vertexAddr = getVertAddress(vertexBuffer);
     vk::DeviceAddress indexAddr  = getIndexAddr(indexBuffer);
 
+    auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+    vk::DeviceSize scratchAlignment =
+        properties.get<vk::PhysicalDeviceAccelerationStructurePropertiesKHR>().minAccelerationStructureScratchOffsetAlignment;
+    float timestampPeriod = properties.get<vk::PhysicalDeviceProperties2>().properties.limits.timestampPeriod;
+
+    size_t blasCount = submeshes.size();
+    std::vector<vk::AccelerationStructureGeometryKHR> geometries(blasCount);
+    std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos(blasCount);
+    std::vector<vk::AccelerationStructureBuildRangeInfoKHR> buildRanges(blasCount);
+    std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> buildRangePointers(blasCount);
+    std::vector<vk::DeviceSize> scratchSizes(blasCount);
+    std::vector<vk::DeviceSize> blasSizes(blasCount);
+    std::vector<vk::AccelerationStructureKHR> blasViews(blasCount);
+
     // reserve space for BLAS handles, buffers and memories
-    blasHandles.reserve(submeshes.size());
-    blasBuffers.reserve(submeshes.size());
-    blasMemories.reserve(submeshes.size());
-
-    // create BLAS for each submesh
-    for (auto& submesh : submeshes) {
-        vk::AccelerationStructureGeometryTrianglesDataKHR trianglesData{.vertexFormat = vk::Format::eR32G32B32Sfloat,
-                                                                        .vertexData   = vertexAddr,
-                                                                        .vertexStride = sizeof(Vertex),
-                                                                        .maxVertex    = submesh.maxVertex,
-                                                                        .indexType    = vk::IndexType::eUint32,
-                                                                        .indexData    = indexAddr + submesh.indexOffset * sizeof(uint32_t)};
-        vk::AccelerationStructureGeometryDataKHR geometryData(trianglesData);
-
-        vk::AccelerationStructureGeometryKHR blasGeometry{
+    blasHandles.reserve(blasCount);
+    blasBuffers.reserve(blasCount);
+    blasMemories.reserve(blasCount);
+
+    // create a BLAS for each submesh, the builds are recorded below
+    for (size_t i = 0; i < blasCount; i++) {
+        const SubMesh& submesh = submeshes[i];
+        // shadow rays may trace a coarser level than the one rasterized (BLAS_LOD)
+        MeshLod lod = submesh.lod(std::min(BLAS_LOD, submesh.lodCount - 1));
+        // the packed layout builds from its own position stream (fp32 or fp16)
+        vk::AccelerationStructureGeometryTrianglesDataKHR trianglesData{
+            .vertexFormat = PACKED_VERTICES ? PackedVertex::positionFormat : vk::Format::eR32G32B32Sfloat,
+            .vertexData   = vertexAddr,
+            .vertexStride = PACKED_VERTICES ? PackedVertex::positionStride : sizeof(Vertex),
+            .maxVertex    = submesh.vertexOffset + submesh.maxVertex,
+            .indexType    = vk::IndexType::eUint32,
+            .indexData    = indexAddr + lod.indexOffset * sizeof(uint32_t)};
+
+        geometries[i] = vk::AccelerationStructureGeometryKHR{
             .geometryType = vk::GeometryTypeKHR::eTriangles,
-            .geometry     = geometryData,
+            .geometry     = vk::AccelerationStructureGeometryDataKHR(trianglesData),
             .flags        = vk::GeometryFlagBitsKHR::eOpaque,
         };
 
-        vk::AccelerationStructureBuildGeometryInfoKHR buildInfo{
+        buildInfos[i] = vk::AccelerationStructureBuildGeometryInfoKHR{
             .type          = vk::AccelerationStructureTypeKHR::eBottomLevel,
+            .flags         = COMPACT_BLAS ? vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction : vk::BuildAccelerationStructureFlagsKHR{},
             .mode          = vk::BuildAccelerationStructureModeKHR::eBuild,
             .geometryCount = 1,
-            .pGeometries   = &blasGeometry,
+            .pGeometries   = &geometries[i],
         };
 
-        uint32_t primitiveCount = submesh.indexCount / 3;
+        uint32_t primitiveCount = lod.indexCount / 3;
         vk::AccelerationStructureBuildSizesInfoKHR buildSizes =
-            device.getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, {primitiveCount});
+            device.getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfos[i], {primitiveCount});
 
-        vk::raii::Buffer blasBuffer       = nullptr;
-        vk::raii::DeviceMemory blasMemory = nullptr;
+        vk::raii::Buffer blasBuffer = nullptr;
+        GpuAllocation blasMemory    = nullptr;
         createBuffer(buildSizes.accelerationStructureSize,
                      vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
                      vk::MemoryPropertyFlagBits::eDeviceLocal,
@@ -57,51 +192,371 @@ void HelloTriangleApplication::createAccelerationStructures() {
             .type   = vk::AccelerationStructureTypeKHR::eBottomLevel,
         };
         blasHandles.push_back(device.createAccelerationStructureKHR(blasCreateInfo));
+        buildInfos[i].dstAccelerationStructure = *blasHandles.back();
+        blasViews[i]                           = *blasHandles.back();
+        blasSizes[i]                           = buildSizes.accelerationStructureSize;
+
+        buildRanges[i]        = vk::AccelerationStructureBuildRangeInfoKHR{.primitiveCount  = primitiveCount,
+                                                                           .primitiveOffset = 0,
+                                                                           .firstVertex     = static_cast<uint32_t>(submesh.vertexOffset),
+                                                                           .transformOffset = 0};
+        buildRangePointers[i] = &buildRanges[i];
+        scratchSizes[i]       = buildSizes.buildScratchSize;
+    }
+    if (blasCount == 0) return;
+
+    // one scratch buffer, sized for the largest batch (+ slack to align its device address)
+    std::vector<vk::DeviceSize> scratchOffsets;
+    std::vector<ScratchBatch> batches = planScratchBatches(scratchSizes, scratchAlignment, BLAS_SCRATCH_BUDGET, scratchOffsets);
+    vk::DeviceSize scratchSize        = 0;
+    for (const ScratchBatch& batch : batches) scratchSize = std::max(scratchSize, batch.scratchSize);
+
+    vk::raii::Buffer scratchBuffer = nullptr;
+    GpuAllocation scratchMemory    = nullptr;
+    createBuffer(scratchSize + scratchAlignment,
+                 vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal,
+                 scratchBuffer,
+                 scratchMemory);
+    vk::DeviceAddress scratchAddr = alignUp(device.getBufferAddressKHR({.buffer = *scratchBuffer}), scratchAlignment);
+    for (size_t i = 0; i < blasCount; i++) buildInfos[i].scratchData.deviceAddress = scratchAddr + scratchOffsets[i];
+
+    // timestamps before the first and after every batch
+    uint32_t timestampBits        = physicalDevice.getQueueFamilyProperties()[queueIndex].timestampValidBits;
+    auto queryCount               = static_cast<uint32_t>(batches.size() + 1);
+    vk::raii::QueryPool queryPool = nullptr;
+    if (timestampBits != 0) {
+        queryPool = vk::raii::QueryPool(device, vk::QueryPoolCreateInfo{.queryType = vk::QueryType::eTimestamp, .queryCount = queryCount});
+    }
+    // compacted sizes are queried in the same submit, right after the builds
+    vk::raii::QueryPool compactedSizeQueries = nullptr;
+    if (COMPACT_BLAS) {
+        vk::QueryPoolCreateInfo queryInfo{.queryType  = vk::QueryType::eAccelerationStructureCompactedSizeKHR,
+                                          .queryCount = static_cast<uint32_t>(blasCount)};
+        compactedSizeQueries = vk::raii::QueryPool(device, queryInfo);
+    }
 
-        // scratch buffer
-        vk::raii::Buffer scratchBuffer       = nullptr;
-        vk::raii::DeviceMemory scratchMemory = nullptr;
-        createBuffer(buildSizes.buildScratchSize,
-                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+    Clock::time_point recordStart = Clock::now();
+    auto cmd                      = beginSingleTimeCommands();
+    if (timestampBits != 0) {
+        cmd->resetQueryPool(*queryPool, 0, queryCount);
+        cmd->writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *queryPool, 0);
+    }
+    if (COMPACT_BLAS) cmd->resetQueryPool(*compactedSizeQueries, 0, static_cast<uint32_t>(blasCount));
+    // the next batch overwrites the scratch memory of this one; the last barrier makes the BLASes visible to the TLAS build
+    vk::MemoryBarrier2 buildBarrier{
+        .srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+        .srcAccessMask = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+        .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+        .dstAccessMask = vk::AccessFlagBits2::eAccelerationStructureReadKHR | vk::AccessFlagBits2::eAccelerationStructureWriteKHR};
+    for (size_t b = 0; b < batches.size(); b++) {
+        const ScratchBatch& batch = batches[b];
+        auto count                = static_cast<uint32_t>(batch.count);
+        cmd->buildAccelerationStructuresKHR(
+            vk::ArrayProxy<const vk::AccelerationStructureBuildGeometryInfoKHR>(count, &buildInfos[batch.first]),
+            vk::ArrayProxy<const vk::AccelerationStructureBuildRangeInfoKHR* const>(count, &buildRangePointers[batch.first]));
+        if (timestampBits != 0) {
+            cmd->writeTimestamp2(vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR, *queryPool, static_cast<uint32_t>(b + 1));
+        }
+        cmd->pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &buildBarrier});
+    }
+    if (COMPACT_BLAS) {
+        cmd->writeAccelerationStructuresPropertiesKHR(blasViews, vk::QueryType::eAccelerationStructureCompactedSizeKHR, *compactedSizeQueries, 0);
+    }
+    endSingleTimeCommands(*cmd);
+    Clock::time_point end = Clock::now();
+
+    std::cout << "[Info] BLAS: " << blasCount << " builds in " << batches.size() << " batches, " << scratchSize / 1024
+              << " KiB shared scratch, setup " << elapsedMs(start, recordStart) << " ms, record + execute " << elapsedMs(recordStart, end)
+              << " ms, total " << elapsedMs(start, end) << " ms" << std::endl;
+    if (timestampBits != 0) {
+        auto [result, ticks] = queryPool.getResults<uint64_t>(
+            0, queryCount, queryCount * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        uint64_t tickMask = timestampBits >= 64 ? ~0ull : (1ull << timestampBits) - 1;
+        auto gpuMs        = [&](size_t from, size_t to) { return double((ticks[to] - ticks[from]) & tickMask) * timestampPeriod * 1e-6; };
+        for (size_t b = 0; result == vk::Result::eSuccess && b < batches.size(); b++) {
+            std::cout << "[Info]   batch " << b << ": " << batches[b].count << " builds, " << batches[b].scratchSize / 1024
+                      << " KiB scratch, GPU " << gpuMs(b, b + 1) << " ms" << std::endl;
+        }
+        if (result == vk::Result::eSuccess) std::cout << "[Info]   GPU total " << gpuMs(0, batches.size()) << " ms" << std::endl;
+    }
+
+    if (COMPACT_BLAS) {
+        auto [result, compactedSizes] =
+            compactedSizeQueries.getResults<vk::DeviceSize>(0,
+                                                            static_cast<uint32_t>(blasCount),
+                                                            blasCount * sizeof(vk::DeviceSize),
+                                                            sizeof(vk::DeviceSize),
+                                                            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        if (result != vk::Result::eSuccess) throw std::runtime_error("failed to read compacted BLAS sizes!");
+        compactBottomLevelAccelerationStructures(blasSizes, compactedSizes);
+    }
+}
+
+/**
+ * @brief copy every BLAS into a buffer of its compacted size and release the original
+ *
+ * The copies share one submit; the originals are destroyed once it has finished.
+ */
+void HelloTriangleApplication::compactBottomLevelAccelerationStructures(const std::vector<vk::DeviceSize>& builtSizes,
+                                                                        const std::vector<vk::DeviceSize>& compactedSizes) {
+    Clock::time_point start = Clock::now();
+
+    std::vector<vk::raii::AccelerationStructureKHR> compactHandles;
+    std::vector<vk::raii::Buffer> compactBuffers;
+    std::vector<GpuAllocation> compactMemories;
+    compactHandles.reserve(blasHandles.size());
+    compactBuffers.reserve(blasHandles.size());
+    compactMemories.reserve(blasHandles.size());
+
+    auto cmd = beginSingleTimeCommands();
+    for (size_t i = 0; i < blasHandles.size(); i++) {
+        vk::raii::Buffer buffer = nullptr;
+        GpuAllocation memory    = nullptr;
+        createBuffer(compactedSizes[i],
+                     vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
                      vk::MemoryPropertyFlagBits::eDeviceLocal,
-                     scratchBuffer,
-                     scratchMemory);
-        // scratch buffer device address
-        vk::BufferDeviceAddressInfo scratchAddrInfo{.buffer = *scratchBuffer};
-        buildInfo.scratchData.deviceAddress = device.getBufferAddressKHR(scratchAddrInfo);
-        buildInfo.dstAccelerationStructure  = *blasHandles.back();
+                     buffer,
+                     memory);
+        compactBuffers.push_back(std::move(buffer));
+        compactMemories.push_back(std::move(memory));
+
+        vk::AccelerationStructureCreateInfoKHR createInfo{
+            .buffer = *compactBuffers.back(),
+            .offset = 0,
+            .size   = compactedSizes[i],
+            .type   = vk::AccelerationStructureTypeKHR::eBottomLevel,
+        };
+        compactHandles.push_back(device.createAccelerationStructureKHR(createInfo));
+
+        cmd->copyAccelerationStructureKHR(vk::CopyAccelerationStructureInfoKHR{
+            .src = *blasHandles[i], .dst = *compactHandles.back(), .mode = vk::CopyAccelerationStructureModeKHR::eCompact});
+    }
+    // make the copies visible to the TLAS build
+    vk::MemoryBarrier2 copyBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+                                   .srcAccessMask = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+                                   .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+                                   .dstAccessMask = vk::AccessFlagBits2::eAccelerationStructureReadKHR};
+    cmd->pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &copyBarrier});
+    endSingleTimeCommands(*cmd);
+
+    // the originals are no longer referenced by anything (the TLAS instances are written afterwards)
+    blasHandles  = std::move(compactHandles);
+    blasBuffers  = std::move(compactBuffers);
+    blasMemories = std::move(compactMemories);
+
+    vk::DeviceSize builtTotal     = 0;
+    vk::DeviceSize compactedTotal = 0;
+    for (size_t i = 0; i < builtSizes.size(); i++) {
+        std::cout << "[Info]   BLAS " << i << ": " << builtSizes[i] / 1024 << " -> " << compactedSizes[i] / 1024 << " KiB, reclaimed "
+                  << (builtSizes[i] - compactedSizes[i]) / 1024 << " KiB" << std::endl;
+        builtTotal += builtSizes[i];
+        compactedTotal += compactedSizes[i];
+    }
+    double reclaimedPercent = builtTotal ? 100.0 * double(builtTotal - compactedTotal) / double(builtTotal) : 0.0;
+    std::cout << "[Info] BLAS compaction: " << builtTotal / 1024 << " -> " << compactedTotal / 1024 << " KiB, reclaimed "
+              << (builtTotal - compactedTotal) / 1024 << " KiB (" << reclaimedPercent << "%) in " << elapsedMs(start, Clock::now()) << " ms"
+              << std::endl;
+}
+
+AsCacheDevice HelloTriangleApplication::asCacheDevice() const {
+    vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+    AsCacheDevice cacheDevice{.vendorID = properties.vendorID, .deviceID = properties.deviceID, .driverVersion = properties.driverVersion};
+    memcpy(cacheDevice.pipelineCacheUUID, properties.pipelineCacheUUID.data(), AS_CACHE_UUID_SIZE);
+    return cacheDevice;
+}
 
-        vk::AccelerationStructureBuildRangeInfoKHR buildRange{
-            .primitiveCount = primitiveCount, .primitiveOffset = 0, .firstVertex = 0, .transformOffset = 0};
+/**
+ * @brief deserialize every BLAS from AS_CACHE_PATH instead of building it
+ *
+ * @param keys expected cache key of every submesh
+ * @return false (and creates nothing) if the file is missing, stale or not compatible with this device
+ */
+bool HelloTriangleApplication::loadBlasCache(const std::vector<uint64_t>& keys) {
+    Clock::time_point start = Clock::now();
+    AsCache cache;
+    if (!cache.open(AS_CACHE_PATH, asCacheDevice())) return false;
+
+    bool valid = cache.entryCount() == keys.size();
+    for (uint32_t i = 0; i < cache.entryCount() && valid; i++) {
+        vk::AccelerationStructureVersionInfoKHR versionInfo{.pVersionData = cache.blob(i)};
+        valid = cache.entry(i).key == keys[i] &&
+                device.getAccelerationStructureCompatibilityKHR(versionInfo) == vk::AccelerationStructureCompatibilityKHR::eCompatible;
+    }
+    if (!valid) {
+        std::cout << "[Info] BLAS cache: " << AS_CACHE_PATH << " is stale or incompatible, rebuilding" << std::endl;
+        return false;
+    }
 
-        auto cmd = beginSingleTimeCommands();
-        cmd->buildAccelerationStructuresKHR({buildInfo}, {&buildRange});
-        endSingleTimeCommands(*cmd);
+    // all serialized structures go into one device-local buffer
+    std::vector<vk::DeviceSize> offsets(keys.size());
+    vk::DeviceSize serializedSize = 0;
+    for (uint32_t i = 0; i < cache.entryCount(); i++) {
+        offsets[i]     = serializedSize;
+        serializedSize = alignUp(serializedSize + cache.entry(i).size, SERIALIZED_ALIGNMENT);
+    }
+    vk::raii::Buffer serializedBuffer = nullptr;
+    GpuAllocation serializedMemory    = nullptr;
+    createBuffer(serializedSize,
+                 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal,
+                 serializedBuffer,
+                 serializedMemory);
+    for (uint32_t i = 0; i < cache.entryCount(); i++) {
+        uploads.uploadBuffer(*serializedBuffer, offsets[i], cache.blob(i), cache.entry(i).size);
+    }
+    vk::DeviceAddress serializedAddr = device.getBufferAddressKHR({.buffer = *serializedBuffer});
+
+    blasHandles.reserve(keys.size());
+    blasBuffers.reserve(keys.size());
+    blasMemories.reserve(keys.size());
+    vk::DeviceSize structureBytes = 0;
+
+    auto cmd = beginSingleTimeCommands();
+    for (uint32_t i = 0; i < cache.entryCount(); i++) {
+        vk::DeviceSize structureSize = cache.entry(i).structureSize;
+        vk::raii::Buffer blasBuffer  = nullptr;
+        GpuAllocation blasMemory     = nullptr;
+        createBuffer(structureSize,
+                     vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     blasBuffer,
+                     blasMemory);
+        blasBuffers.push_back(std::move(blasBuffer));
+        blasMemories.push_back(std::move(blasMemory));
+
+        vk::AccelerationStructureCreateInfoKHR blasCreateInfo{
+            .buffer = *blasBuffers.back(),
+            .offset = 0,
+            .size   = structureSize,
+            .type   = vk::AccelerationStructureTypeKHR::eBottomLevel,
+        };
+        blasHandles.push_back(device.createAccelerationStructureKHR(blasCreateInfo));
+        structureBytes += structureSize;
+
+        cmd->copyMemoryToAccelerationStructureKHR(vk::CopyMemoryToAccelerationStructureInfoKHR{
+            .src = serializedAddr + offsets[i], .dst = *blasHandles.back(), .mode = vk::CopyAccelerationStructureModeKHR::eDeserialize});
+    }
+    // make the structures visible to the TLAS build
+    vk::MemoryBarrier2 copyBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+                                   .srcAccessMask = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+                                   .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+                                   .dstAccessMask = vk::AccessFlagBits2::eAccelerationStructureReadKHR};
+    cmd->pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &copyBarrier});
+    endSingleTimeCommands(*cmd);
+
+    std::cout << "[Info] BLAS cache: loaded " << keys.size() << " structures (" << structureBytes / 1024 << " KiB) from " << AS_CACHE_PATH << " in "
+              << elapsedMs(start, Clock::now()) << " ms, building them took " << cache.buildMilliseconds() << " ms" << std::endl;
+    return true;
+}
+
+/**
+ * @brief serialize every BLAS into AS_CACHE_PATH for the next launch
+ *  a cache that cannot be written only costs startup time, so failures are reported and ignored
+ */
+void HelloTriangleApplication::writeBlasCache(const std::vector<uint64_t>& keys, double buildMs) {
+    Clock::time_point start = Clock::now();
+    auto count              = static_cast<uint32_t>(blasHandles.size());
+    std::vector<vk::AccelerationStructureKHR> blasViews(count);
+    for (uint32_t i = 0; i < count; i++) blasViews[i] = *blasHandles[i];
+
+    vk::QueryPoolCreateInfo queryInfo{.queryType = vk::QueryType::eAccelerationStructureSerializationSizeKHR, .queryCount = count};
+    vk::raii::QueryPool sizeQueries(device, queryInfo);
+    auto cmd = beginSingleTimeCommands();
+    cmd->resetQueryPool(*sizeQueries, 0, count);
+    cmd->writeAccelerationStructuresPropertiesKHR(blasViews, vk::QueryType::eAccelerationStructureSerializationSizeKHR, *sizeQueries, 0);
+    endSingleTimeCommands(*cmd);
+    auto [result, sizes] = sizeQueries.getResults<vk::DeviceSize>(
+        0, count, count * sizeof(vk::DeviceSize), sizeof(vk::DeviceSize), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+    if (result != vk::Result::eSuccess) {
+        std::cerr << "[Warning] BLAS cache: failed to query serialization sizes" << std::endl;
+        return;
+    }
+
+    // serialize straight into host-visible memory
+    std::vector<vk::DeviceSize> offsets(count);
+    vk::DeviceSize serializedSize = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        offsets[i]     = serializedSize;
+        serializedSize = alignUp(serializedSize + sizes[i], SERIALIZED_ALIGNMENT);
+    }
+    vk::raii::Buffer serializedBuffer = nullptr;
+    GpuAllocation serializedMemory    = nullptr;
+    createBuffer(serializedSize,
+                 vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                 serializedBuffer,
+                 serializedMemory);
+    vk::DeviceAddress serializedAddr = device.getBufferAddressKHR({.buffer = *serializedBuffer});
+
+    cmd = beginSingleTimeCommands();
+    for (uint32_t i = 0; i < count; i++) {
+        cmd->copyAccelerationStructureToMemoryKHR(vk::CopyAccelerationStructureToMemoryInfoKHR{
+            .src = blasViews[i], .dst = serializedAddr + offsets[i], .mode = vk::CopyAccelerationStructureModeKHR::eSerialize});
+    }
+    vk::MemoryBarrier2 hostBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+                                   .srcAccessMask = vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+                                   .dstStageMask  = vk::PipelineStageFlagBits2::eHost,
+                                   .dstAccessMask = vk::AccessFlagBits2::eHostRead};
+    cmd->pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &hostBarrier});
+    endSingleTimeCommands(*cmd);
+
+    const auto* serialized = static_cast<const uint8_t*>(serializedMemory.mapMemory(0, serializedSize));
+    std::vector<AsCacheBlob> blobs(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t structureSize = 0;
+        memcpy(&structureSize, serialized + offsets[i] + SERIALIZED_STRUCTURE_SIZE_OFFSET, sizeof(structureSize));
+        blobs[i] = {.key = keys[i], .structureSize = structureSize, .data = serialized + offsets[i], .size = sizes[i]};
+    }
+    try {
+        AsCache::write(AS_CACHE_PATH, asCacheDevice(), static_cast<float>(buildMs), blobs);
+        std::cout << "[Info] BLAS cache: wrote " << count << " structures (" << serializedSize / 1024 << " KiB) to " << AS_CACHE_PATH << " in "
+                  << elapsedMs(start, Clock::now()) << " ms" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "[Warning] " << e.what() << std::endl;
+    }
+}
+
+void HelloTriangleApplication::createAccelerationStructures() {
+    // static geometry: deserialize the BLASes of the last launch when they are still valid for this device
+    std::vector<uint64_t> cacheKeys = AS_CACHE ? blasCacheKeys(submeshes, geometryHash) : std::vector<uint64_t>{};
+    if (cacheKeys.empty() || !loadBlasCache(cacheKeys)) {
+        Clock::time_point buildStart = Clock::now();
+        buildBottomLevelAccelerationStructures();
+        if (!cacheKeys.empty()) writeBlasCache(cacheKeys, elapsedMs(buildStart, Clock::now()));
     }
 
     // create TLAS
     std::vector<vk::AccelerationStructureInstanceKHR> instances;
-    instances.reserve(submeshes.size());
+    instances.reserve(sceneInstances.size());
 
     vk::TransformMatrixKHR transformMatrix = {std::array<std::array<float, 4>, 3>{
         std::array<float, 4>{1.0f, 0.0f, 0.0f, 0.0f}, std::array<float, 4>{0.0f, 1.0f, 0.0f, 0.0f}, std::array<float, 4>{0.0f, 0.0f, 1.0f, 0.0f}}};
 
-    // instance list(put every BLAS into the instance list)
+    // BLAS addresses do not change after this point, the instances reference them directly
+    blasAddresses.resize(blasHandles.size());
     for (size_t i = 0; i < blasHandles.size(); i++) {
-        vk::AccelerationStructureDeviceAddressInfoKHR addressInfo{.accelerationStructure = *blasHandles[i]};
-        vk::DeviceAddress blasAddress = device.getAccelerationStructureAddressKHR(addressInfo);
+        blasAddresses[i] = device.getAccelerationStructureAddressKHR({.accelerationStructure = *blasHandles[i]});
+    }
 
+    // instance list: one instance per instance table entry, copies of a submesh share its BLAS
+    for (const SceneInstance& entry : sceneInstances) {
         vk::AccelerationStructureInstanceKHR instance{};
         instance.transform                              = transformMatrix;
-        instance.instanceCustomIndex                    = i;  // material index
+        instance.instanceCustomIndex                    = entry.customIndex;  // material index
         instance.mask                                   = 0xFF;
         instance.instanceShaderBindingTableRecordOffset = 0;
         instance.flags                                  = static_cast<uint32_t>(vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable);
-        instance.accelerationStructureReference         = blasAddress;
+        instance.accelerationStructureReference         = blasAddresses[entry.submesh];
 
         instances.push_back(instance);
     }
 
+    // the first updateTLAS() writes the real transforms into every frame's instances
+    instanceDirtyMask.assign(instances.size(), 0);
+    for (std::vector<uint32_t>& dirty : dirtyInstances) dirty.clear();
+    for (uint32_t i = 0; i < instances.size(); i++) markInstanceDirty(i);
+
     // Resize vectors for double buffering
     tlas.clear();
     tlasBuffer.clear();
@@ -110,6 +565,8 @@ void HelloTriangleApplication::createAccelerationStructures() {
     tlasScratchMemory.clear();
     instanceBuffer.clear();
     instanceMemory.clear();
+    instanceMapped.clear();
+    tlasTimestampQueries.clear();
 
     tlas.reserve(MAX_FRAMES_IN_FLIGHT);
     tlasBuffer.reserve(MAX_FRAMES_IN_FLIGHT);
@@ -119,59 +576,56 @@ void HelloTriangleApplication::createAccelerationStructures() {
     instanceBuffer.reserve(MAX_FRAMES_IN_FLIGHT);
     instanceMemory.reserve(MAX_FRAMES_IN_FLIGHT);
 
-    // staging buffer to upload instance data
     vk::DeviceSize instanceBufferSize = sizeof(vk::AccelerationStructureInstanceKHR) * instances.size();
+    uint32_t instanceCount            = static_cast<uint32_t>(instances.size());
 
-    vk::raii::Buffer stagingBuffer       = nullptr;
-    vk::raii::DeviceMemory stagingMemory = nullptr;
-    createBuffer(instanceBufferSize,
-                 vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                 stagingBuffer,
-                 stagingMemory);
-
-    void* data = stagingMemory.mapMemory(0, instanceBufferSize);
-    memcpy(data, instances.data(), instanceBufferSize);
-    stagingMemory.unmapMemory();
+    // all initial TLAS builds go into one submit
+    std::array<vk::AccelerationStructureGeometryKHR, MAX_FRAMES_IN_FLIGHT> tlasGeometries;
+    std::array<vk::AccelerationStructureBuildGeometryInfoKHR, MAX_FRAMES_IN_FLIGHT> tlasBuildInfos;
+    vk::AccelerationStructureBuildRangeInfoKHR tlasRange{
+        .primitiveCount = instanceCount, .primitiveOffset = 0, .firstVertex = 0, .transformOffset = 0};
+    std::array<const vk::AccelerationStructureBuildRangeInfoKHR*, MAX_FRAMES_IN_FLIGHT> tlasRanges;
 
     // Create TLAS resources for EACH frame
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        // 1. Create Instance Buffer
-        vk::raii::Buffer instBuf       = nullptr;
-        vk::raii::DeviceMemory instMem = nullptr;
+        // 1. Create Instance Buffer (persistently mapped, updateTLAS() writes the transforms that change in place)
+        vk::raii::Buffer instBuf = nullptr;
+        GpuAllocation instMem    = nullptr;
         createBuffer(instanceBufferSize,
-                     vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
-                         vk::BufferUsageFlagBits::eTransferDst,
-                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
                      instBuf,
                      instMem);
 
         instanceBuffer.push_back(std::move(instBuf));
         instanceMemory.push_back(std::move(instMem));
-
-        // Copy initial data
-        copyBuffer(stagingBuffer, instanceBuffer.back(), instanceBufferSize);
+        instanceMapped.push_back(static_cast<vk::AccelerationStructureInstanceKHR*>(instanceMemory.back().mapMemory(0, instanceBufferSize)));
+        memcpy(instanceMapped.back(), instances.data(), instanceBufferSize);
+        // deformed submeshes have a BLAS per frame in flight
+        for (uint32_t j = 0; j < sceneInstances.size() && !deformedSubmeshes.empty(); j++) {
+            int32_t slot = deformedSlot[sceneInstances[j].submesh];
+            if (slot >= 0) instanceMapped.back()[j].accelerationStructureReference = deformedBlasAddresses[i * deformedSubmeshes.size() + slot];
+        }
 
         // 2. Get Instance Buffer Address
         vk::BufferDeviceAddressInfo instanceBufAddrInfo{.buffer = *instanceBuffer.back()};
         vk::DeviceAddress instanceAddr = device.getBufferAddressKHR(instanceBufAddrInfo);
 
         vk::AccelerationStructureGeometryInstancesDataKHR instancesData{.arrayOfPointers = vk::False, .data = instanceAddr};
-        vk::AccelerationStructureGeometryKHR tlasGeometry{.geometryType = vk::GeometryTypeKHR::eInstances, .geometry = instancesData};
+        tlasGeometries[i] = vk::AccelerationStructureGeometryKHR{.geometryType = vk::GeometryTypeKHR::eInstances, .geometry = instancesData};
 
         vk::AccelerationStructureBuildGeometryInfoKHR tlasBuildInfo{.type          = vk::AccelerationStructureTypeKHR::eTopLevel,
-                                                                    .flags         = vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate,
+                                                                    .flags         = TLAS_BUILD_FLAGS,
                                                                     .mode          = vk::BuildAccelerationStructureModeKHR::eBuild,
                                                                     .geometryCount = 1,
-                                                                    .pGeometries   = &tlasGeometry};
+                                                                    .pGeometries   = &tlasGeometries[i]};
 
-        uint32_t instanceCount = static_cast<uint32_t>(instances.size());
         vk::AccelerationStructureBuildSizesInfoKHR tlasBuildSizes =
             device.getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice, tlasBuildInfo, {instanceCount});
 
         // 3. Create TLAS Buffer
-        vk::raii::Buffer tBuffer       = nullptr;
-        vk::raii::DeviceMemory tMemory = nullptr;
+        vk::raii::Buffer tBuffer = nullptr;
+        GpuAllocation tMemory    = nullptr;
         createBuffer(tlasBuildSizes.accelerationStructureSize,
                      vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
                      vk::MemoryPropertyFlagBits::eDeviceLocal,
@@ -190,9 +644,9 @@ void HelloTriangleApplication::createAccelerationStructures() {
         tlasBuildInfo.dstAccelerationStructure = *tlas.back();
 
         // 5. Create Scratch Buffer
-        vk::raii::Buffer sBuffer       = nullptr;
-        vk::raii::DeviceMemory sMemory = nullptr;
-        createBuffer(tlasBuildSizes.buildScratchSize,
+        vk::raii::Buffer sBuffer = nullptr;
+        GpuAllocation sMemory    = nullptr;
+        createBuffer(std::max(tlasBuildSizes.buildScratchSize, tlasBuildSizes.updateScratchSize),
                      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
                      vk::MemoryPropertyFlagBits::eDeviceLocal,
                      sBuffer,
@@ -202,98 +656,150 @@ void HelloTriangleApplication::createAccelerationStructures() {
 
         vk::BufferDeviceAddressInfo tlasScratchAddrInfo{.buffer = *tlasScratchBuffer.back()};
         tlasBuildInfo.scratchData.deviceAddress = device.getBufferAddressKHR(tlasScratchAddrInfo);
+        tlasBuildInfos[i]                       = tlasBuildInfo;
+        tlasRanges[i]                           = &tlasRange;
+    }
 
-        // 6. Build Initial TLAS
-        vk::AccelerationStructureBuildRangeInfoKHR tlasRange{
-            .primitiveCount = instanceCount, .primitiveOffset = 0, .firstVertex = 0, .transformOffset = 0};
+    // the first update of every frame does a full build from the real transforms (a fresh policy asks for one)
+    tlasPolicies.fill(TlasRefitPolicy({.maxAreaGrowth = TLAS_REBUILD_AREA_GROWTH, .maxRefits = TLAS_MAX_REFITS}));
+    tlasTimestampsPending.fill(false);
+    uint32_t timestampBits = physicalDevice.getQueueFamilyProperties()[queueIndex].timestampValidBits;
+    tlasTimestampMask      = timestampBits == 0 ? 0 : timestampBits >= 64 ? ~0ull : (1ull << timestampBits) - 1;
+    tlasTimestampPeriod    = physicalDevice.getProperties().limits.timestampPeriod;
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT && tlasTimestampMask != 0; i++) {
+        tlasTimestampQueries.emplace_back(device, vk::QueryPoolCreateInfo{.queryType = vk::QueryType::eTimestamp, .queryCount = 2});
+    }
 
-        auto cmd = beginSingleTimeCommands();
-        cmd->buildAccelerationStructuresKHR({tlasBuildInfo}, {&tlasRange});
-        endSingleTimeCommands(*cmd);
+    // 6. Build Initial TLAS (each frame has its own scratch buffer, so they can build together)
+    auto cmd = beginSingleTimeCommands();
+    cmd->buildAccelerationStructuresKHR(tlasBuildInfos, tlasRanges);
+    endSingleTimeCommands(*cmd);
+}
+/**
+ * @brief queue a scene instance for a transform write into every frame's instance buffers
+ */
+void HelloTriangleApplication::markInstanceDirty(uint32_t instance) {
+    static_assert(MAX_FRAMES_IN_FLIGHT <= 8, "instanceDirtyMask holds one bit per frame in flight");
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+        if (instanceDirtyMask[instance] & (1u << frame)) continue;
+        instanceDirtyMask[instance] |= 1u << frame;
+        dirtyInstances[frame].push_back(instance);
     }
 }
-void HelloTriangleApplication::updateTLAS(const vk::raii::CommandBuffer& cmd) {
-    glm::mat4 spin        = currentModelMatrix;
-    glm::mat4 standUp     = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    glm::mat4 bunnyMatrix = spin * standUp;
-    glm::mat4 wallMatrix  = glm::mat4(1.0f);
-
-    std::vector<vk::AccelerationStructureInstanceKHR> instances;
-    instances.reserve(blasHandles.size());
 
-    // B. Re-generate Instances with new Transform
+/**
+ * @brief bring this frame's TLAS up to date with the instances that moved
+ *
+ * Only the transforms of dirty instances are written, straight into the persistently mapped instance
+ * buffer and the raster pass's instanceTransformBuffers (host writes are visible to the submit, so no copy
+ * or transfer barrier is needed); instancePreviousTransformBuffers gets the matrices the last recorded frame
+ * drew them with, for motion vectors. A frame whose instances did not change keeps its TLAS as it is.
+ * Otherwise the frame's TlasRefitPolicy picks a refit, or a full ePreferFastTrace build once the refitted
+ * bounds have drifted too far from the last build.
+ */
+void HelloTriangleApplication::updateTLAS(const vk::raii::CommandBuffer& cmd) {
+    // GPU time of the last update recorded for this frame, its fence has signalled by now
+    if (tlasTimestampsPending[currentFrame]) {
+        auto [result, ticks] =
+            tlasTimestampQueries[currentFrame].getResults<uint64_t>(0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (result == vk::Result::eSuccess) tlasStats.gpuMs = double((ticks[1] - ticks[0]) & tlasTimestampMask) * tlasTimestampPeriod * 1e-6;
+        tlasTimestampsPending[currentFrame] = false;
+    }
 
-    for (size_t i = 0; i < blasHandles.size(); i++) {
-        vk::AccelerationStructureDeviceAddressInfoKHR addressInfo{.accelerationStructure = *blasHandles[i]};
-        vk::DeviceAddress blasAddress = device.getAccelerationStructureAddressKHR(addressInfo);
-
-        // [FIX] Use same logic: Last one is Box, others are Bunny
-        bool isCornellBox       = (i == blasHandles.size() - 1);
-        glm::mat4 selectedModel = isCornellBox ? wallMatrix : bunnyMatrix;
-
-        vk::TransformMatrixKHR transform;
-        for (int r = 0; r < 3; r++) {
-            for (int c = 0; c < 4; c++) {
-                transform.matrix[r][c] = selectedModel[c][r];
-            }
+    // the model matrix moves every animated instance (the bunnies, not the Cornell box)
+    if (currentModelMatrix != instanceModelMatrix) {
+        instanceModelMatrix = currentModelMatrix;
+        for (uint32_t i = 0; i < sceneInstances.size(); i++) {
+            if (sceneInstances[i].animated) markInstanceDirty(i);
         }
-
-        vk::AccelerationStructureInstanceKHR instance{};
-        instance.transform                              = transform;
-        instance.instanceCustomIndex                    = i;
-        instance.mask                                   = 0xFF;
-        instance.instanceShaderBindingTableRecordOffset = 0;
-        instance.flags                                  = static_cast<uint32_t>(vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable);
-        instance.accelerationStructureReference         = blasAddress;
-        instances.push_back(instance);
+    }
+    // motion vectors: the frame's previous transforms catch up with the instances that moved in earlier frames
+    glm::mat4* previous = static_cast<glm::mat4*>(instancePreviousTransformBuffers[currentFrame].mapped);
+    for (auto [begin, end] : instancePreviousDirty.take(currentFrame)) {
+        for (uint32_t i = begin; i < end; i++) previous[i] = instancePreviousModels[i];
+    }
+    std::vector<uint32_t>& dirty = dirtyInstances[currentFrame];
+    TlasRefitPolicy& policy      = tlasPolicies[currentFrame];
+    tlasStats.dirtyInstances     = static_cast<uint32_t>(dirty.size());
+    if (dirty.empty()) {
+        tlasStats.mode = TlasUpdateMode::Skip;
+        tlasStats.skips++;
+        return;
     }
 
-    // C. Upload to Buffer
-    // FIX 1: Use 3 arguments. 'instances' vector converts to ArrayProxy automatically.
-    // Use instanceBuffer[currentFrame]
-    cmd.updateBuffer<vk::AccelerationStructureInstanceKHR>(*instanceBuffer[currentFrame], 0, instances);
-
-    // D. Barrier: Ensure upload finishes before Build reads it
-    // FIX: Add eShaderRead to dstAccessMask because instance buffer reads via device address count as shader reads
-    vk::MemoryBarrier2 transferBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eTransfer,
-                                       .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
-                                       .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
-                                       .dstAccessMask = vk::AccessFlagBits2::eAccelerationStructureReadKHR | vk::AccessFlagBits2::eShaderRead};
-    vk::DependencyInfo depInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &transferBarrier};
-    cmd.pipelineBarrier2(depInfo);
+    vk::AccelerationStructureInstanceKHR* instances = instanceMapped[currentFrame];
+    glm::mat4* transforms                           = static_cast<glm::mat4*>(instanceTransformBuffers[currentFrame].mapped);
+    for (uint32_t i : dirty) {
+        // the raster pass reads the same matrices from instanceTransformBuffers
+        glm::mat4 model = sceneInstanceMatrix(i);
+        transforms[i]   = model;
+        // this frame still sees where the instance was last drawn, every later frame where it is now
+        previous[i] = instancePreviousModels[i];
+        if (model != instancePreviousModels[i]) {
+            instancePreviousModels[i] = model;
+            instancePreviousDirty.mark(i);
+        }
+        writeInstanceTransform(model, instances[i].transform);
+        policy.moved(i, instanceBounds(model, submeshes[sceneInstances[i].submesh].boundingSphere));
+        instanceDirtyMask[i] &= ~(1u << currentFrame);
+    }
+    dirty.clear();
+
+    tlasStats.areaGrowth = policy.areaGrowth();
+    bool rebuild         = policy.shouldRebuild();
+    if (rebuild) {
+        // every instance of this frame's buffer is current now, a new build starts from their bounds
+        std::vector<InstanceBounds> bounds(sceneInstances.size());
+        for (uint32_t i = 0; i < bounds.size(); i++) {
+            bounds[i] = instanceBounds(sceneInstanceMatrix(i), submeshes[sceneInstances[i].submesh].boundingSphere);
+        }
+        policy.rebuilt(bounds);
+        tlasStats.mode = TlasUpdateMode::Rebuild;
+        tlasStats.rebuilds++;
+    } else {
+        policy.refitted();
+        tlasStats.mode = TlasUpdateMode::Refit;
+        tlasStats.refits++;
+    }
+    tlasStats.refitsSinceBuild = policy.refitsSinceBuild();
 
-    // E. Build TLAS
     vk::BufferDeviceAddressInfo instanceBufAddrInfo{.buffer = *instanceBuffer[currentFrame]};
     vk::DeviceAddress instanceAddr = device.getBufferAddressKHR(instanceBufAddrInfo);
 
     vk::AccelerationStructureGeometryInstancesDataKHR instancesData{.arrayOfPointers = vk::False, .data = instanceAddr};
     vk::AccelerationStructureGeometryKHR tlasGeometry{.geometryType = vk::GeometryTypeKHR::eInstances, .geometry = instancesData};
 
-    // FIX 2: Construct DeviceOrHostAddressKHR explicitly
-    // Use tlasScratchBuffer[currentFrame]
     vk::DeviceAddress scratchAddr = device.getBufferAddressKHR({.buffer = *tlasScratchBuffer[currentFrame]});
 
-    vk::AccelerationStructureBuildGeometryInfoKHR tlasBuildInfo{.type                     = vk::AccelerationStructureTypeKHR::eTopLevel,
-                                                                .flags                    = vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate,
-                                                                .mode                     = vk::BuildAccelerationStructureModeKHR::eUpdate,
-                                                                .srcAccelerationStructure = *tlas[currentFrame],
-                                                                .dstAccelerationStructure = *tlas[currentFrame],
-                                                                .geometryCount            = 1,
-                                                                .pGeometries              = &tlasGeometry,
-                                                                .scratchData              = vk::DeviceOrHostAddressKHR(scratchAddr)};
+    vk::AccelerationStructureBuildGeometryInfoKHR tlasBuildInfo{
+        .type                     = vk::AccelerationStructureTypeKHR::eTopLevel,
+        .flags                    = TLAS_BUILD_FLAGS,
+        .mode                     = rebuild ? vk::BuildAccelerationStructureModeKHR::eBuild : vk::BuildAccelerationStructureModeKHR::eUpdate,
+        .srcAccelerationStructure = rebuild ? vk::AccelerationStructureKHR{} : *tlas[currentFrame],
+        .dstAccelerationStructure = *tlas[currentFrame],
+        .geometryCount            = 1,
+        .pGeometries              = &tlasGeometry,
+        .scratchData              = vk::DeviceOrHostAddressKHR(scratchAddr)};
 
     vk::AccelerationStructureBuildRangeInfoKHR tlasRange{
-        .primitiveCount = static_cast<uint32_t>(instances.size()), .primitiveOffset = 0, .firstVertex = 0, .transformOffset = 0};
+        .primitiveCount = static_cast<uint32_t>(sceneInstances.size()), .primitiveOffset = 0, .firstVertex = 0, .transformOffset = 0};
     const vk::AccelerationStructureBuildRangeInfoKHR* pRange = &tlasRange;
 
-    // FIX 3: Remove '1' (count) and use brackets {} to create ArrayProxy
+    if (tlasTimestampMask != 0) {
+        cmd.resetQueryPool(*tlasTimestampQueries[currentFrame], 0, 2);
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *tlasTimestampQueries[currentFrame], 0);
+    }
     cmd.buildAccelerationStructuresKHR(tlasBuildInfo, pRange);
+    if (tlasTimestampMask != 0) {
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR, *tlasTimestampQueries[currentFrame], 1);
+        tlasTimestampsPending[currentFrame] = true;
+    }
 
-    // F. Barrier: Ensure Build finishes before Compute Shader reads it
+    // Barrier: Ensure Build finishes before Compute Shader reads it
     vk::MemoryBarrier2 buildBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
                                     .srcAccessMask = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
                                     .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
                                     .dstAccessMask = vk::AccessFlagBits2::eShaderRead};
     vk::DependencyInfo buildDepInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &buildBarrier};
     cmd.pipelineBarrier2(buildDepInfo);
-}
\ No newline at end of file
+}
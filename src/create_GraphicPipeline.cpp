@@ -6,7 +6,9 @@
 void HelloTriangleApplication::createGraphicsPipeline() {
     vk::raii::ShaderModule shaderModule = createShaderModule(readFile("shaders/shader.spv"));
     // declare shader stages
-    vk::PipelineShaderStageCreateInfo vertShaderStageInfo{.stage = vk::ShaderStageFlagBits::eVertex, .module = shaderModule, .pName = "vertMain"};
+    // the packed layout has its own vertex entry point that decodes PackedVertex
+    vk::PipelineShaderStageCreateInfo vertShaderStageInfo{
+        .stage = vk::ShaderStageFlagBits::eVertex, .module = shaderModule, .pName = PACKED_VERTICES ? "vertMainPacked" : "vertMain"};
     vk::PipelineShaderStageCreateInfo fragShaderStageInfo{.stage = vk::ShaderStageFlagBits::eFragment, .module = shaderModule, .pName = "fragMain"};
     // combine shader stages
     vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
@@ -14,17 +16,34 @@ void HelloTriangleApplication::createGraphicsPipeline() {
     vk::Format colorFormats[] = {
         vk::Format::eR32G32B32A32Sfloat,  // 0: Swapchain Color
         vk::Format::eR32G32B32A32Sfloat,  // 1: Position
-        vk::Format::eR32G32B32A32Sfloat   // 2: Normal
+        vk::Format::eR32G32B32A32Sfloat,  // 2: Normal
+        vk::Format::eR16G16B16A16Sfloat   // 3: Motion vectors
     };
-    // push constant range
-    vk::PushConstantRange pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eVertex, .offset = 0, .size = sizeof(MeshPushConstants)};
-    // get two vertex input descriptions from Vertex struct
+    // get two vertex input descriptions from Vertex struct (or PackedVertex, two bindings), plus the previous positions
     // then create vertex input state info
-    auto bindingDescription    = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{.vertexBindingDescriptionCount   = 1,
-                                                           .pVertexBindingDescriptions      = &bindingDescription,
-                                                           .vertexAttributeDescriptionCount = attributeDescriptions.size(),
+    std::vector<vk::VertexInputBindingDescription> bindingDescriptions;
+    std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
+    if (PACKED_VERTICES) {
+        auto bindings   = PackedVertex::getBindingDescriptions();
+        auto attributes = PackedVertex::getAttributeDescriptions();
+        bindingDescriptions.assign(bindings.begin(), bindings.end());
+        attributeDescriptions.assign(attributes.begin(), attributes.end());
+    } else {
+        auto attributes = Vertex::getAttributeDescriptions();
+        bindingDescriptions.push_back(Vertex::getBindingDescription());
+        attributeDescriptions.assign(attributes.begin(), attributes.end());
+    }
+    // location 4: the previous frame's position of the same vertex (deformed vertices move), in binding 0's layout
+    if (PACKED_VERTICES) {
+        bindingDescriptions.push_back({PREVIOUS_POSITION_BINDING, PackedVertex::positionStride, vk::VertexInputRate::eVertex});
+        attributeDescriptions.push_back({4, PREVIOUS_POSITION_BINDING, PackedVertex::positionFormat, 0});
+    } else {
+        bindingDescriptions.push_back({PREVIOUS_POSITION_BINDING, sizeof(Vertex), vk::VertexInputRate::eVertex});
+        attributeDescriptions.push_back({4, PREVIOUS_POSITION_BINDING, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, pos)});
+    }
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{.vertexBindingDescriptionCount   = static_cast<uint32_t>(bindingDescriptions.size()),
+                                                           .pVertexBindingDescriptions      = bindingDescriptions.data(),
+                                                           .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size()),
                                                            .pVertexAttributeDescriptions    = attributeDescriptions.data()};
     // Input assembly
     vk::PipelineInputAssemblyStateCreateInfo inputAssembly{.topology = vk::PrimitiveTopology::eTriangleList};
@@ -48,28 +67,30 @@ void HelloTriangleApplication::createGraphicsPipeline() {
                                                          .depthBoundsTestEnable = vk::False,
                                                          .stencilTestEnable     = vk::False};
 
-    // Color blending for three attachments
+    // Color blending for four attachments
     vk::PipelineColorBlendAttachmentState colorBlendAttachment{.blendEnable    = vk::False,
                                                                .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
                                                                                  vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
-    std::vector<vk::PipelineColorBlendAttachmentState> blendAttachments = {colorBlendAttachment, colorBlendAttachment, colorBlendAttachment};
-    vk::PipelineColorBlendStateCreateInfo colorBlending{
-        .logicOpEnable = vk::False, .logicOp = vk::LogicOp::eCopy, .attachmentCount = 3, .pAttachments = blendAttachments.data()};
+    std::vector<vk::PipelineColorBlendAttachmentState> blendAttachments(std::size(colorFormats), colorBlendAttachment);
+    vk::PipelineColorBlendStateCreateInfo colorBlending{.logicOpEnable   = vk::False,
+                                                        .logicOp         = vk::LogicOp::eCopy,
+                                                        .attachmentCount = static_cast<uint32_t>(blendAttachments.size()),
+                                                        .pAttachments    = blendAttachments.data()};
 
     // Dynamic state
     std::vector dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
     vk::PipelineDynamicStateCreateInfo dynamicState{.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
                                                     .pDynamicStates    = dynamicStates.data()};
-    // add descriptorSetLayout
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
-        .setLayoutCount = 1, .pSetLayouts = &*descriptorSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
+    // add descriptorSetLayout (current and previous model matrices come from the instance transform buffers, no push constants)
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{.setLayoutCount = 1, .pSetLayouts = &*descriptorSetLayout};
     // pipeline layout
     pipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
     // add depth format
     vk::Format depthFormat = findDepthFormat();
     // Pipeline Rendering Create Info
-    vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{
-        .colorAttachmentCount = 3, .pColorAttachmentFormats = colorFormats, .depthAttachmentFormat = depthFormat};
+    vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{.colorAttachmentCount    = static_cast<uint32_t>(std::size(colorFormats)),
+                                                                .pColorAttachmentFormats = colorFormats,
+                                                                .depthAttachmentFormat   = depthFormat};
 
     vk::GraphicsPipelineCreateInfo pipelineInfo{.pNext      = &pipelineRenderingCreateInfo,  // add pNext to link to Pipeline Rendering Create Info
                                                 .stageCount = 2,                             // vertex and fragment shaders, so two stages
@@ -92,7 +113,9 @@ void HelloTriangleApplication::createComputePipeline() {
     vk::PipelineShaderStageCreateInfo computeShaderStageInfo{
         .stage = vk::ShaderStageFlagBits::eCompute, .module = computeShaderModule, .pName = "main"};
 
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{.setLayoutCount = 1, .pSetLayouts = &*computeDescriptorSetLayout};
+    vk::PushConstantRange pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(RestirPushConstants)};
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+        .setLayoutCount = 1, .pSetLayouts = &*computeDescriptorSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
     computePipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
 
     vk::ComputePipelineCreateInfo pipelineInfo{.stage = computeShaderStageInfo, .layout = computePipelineLayout};
@@ -0,0 +1,364 @@
+#include "tutorial.hpp"
+
+/*
+deforming geometry (DEFORM_MESHES): deform.slang displaces the bunny's rest pose into a per frame copy of the
+vertex buffer, and the bunny's BLASes are refit from it (eUpdate) in the frame's command buffer, ahead of the
+TLAS update and the ReSTIR dispatch. Each frame in flight owns its vertices and BLASes, so a frame never updates
+structures the other one may still be tracing. Refits keep the BVH topology of the rest pose, so every
+DEFORM_BLAS_REBUILD_INTERVAL updates the BLASes are rebuilt instead. The raster pass draws deformed submeshes
+from the same per frame vertices, so rasterized and traced geometry match, and reads the previous frame's copy
+as the previous positions of its motion vectors.
+*/
+
+namespace {
+
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+// refits require the flags of the build they update, so both use these
+const vk::BuildAccelerationStructureFlagsKHR DEFORMED_BLAS_FLAGS =
+    vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate | vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace;
+
+// the deformed buffers use the layout of binding 0: Vertex, or the packed position stream
+constexpr uint32_t DEFORM_VERTEX_STRIDE = PACKED_VERTICES ? PackedVertex::positionStride : sizeof(Vertex);
+static_assert(!(DEFORM_MESHES && PACKED_VERTICES && PACKED_POSITIONS_FP16), "deform.slang writes fp32 positions");
+
+// triangles of a deformed submesh, at the same LOD as its static BLAS
+vk::AccelerationStructureGeometryKHR deformedGeometry(const SubMesh& submesh, vk::DeviceAddress vertexAddr, vk::DeviceAddress indexAddr) {
+    MeshLod lod = submesh.lod(std::min(BLAS_LOD, submesh.lodCount - 1));
+    vk::AccelerationStructureGeometryTrianglesDataKHR trianglesData{.vertexFormat = vk::Format::eR32G32B32Sfloat,
+                                                                    .vertexData   = vertexAddr,
+                                                                    .vertexStride = DEFORM_VERTEX_STRIDE,
+                                                                    .maxVertex    = submesh.vertexOffset + submesh.maxVertex,
+                                                                    .indexType    = vk::IndexType::eUint32,
+                                                                    .indexData    = indexAddr + lod.indexOffset * sizeof(uint32_t)};
+    return vk::AccelerationStructureGeometryKHR{.geometryType = vk::GeometryTypeKHR::eTriangles,
+                                                .geometry     = vk::AccelerationStructureGeometryDataKHR(trianglesData),
+                                                .flags        = vk::GeometryFlagBitsKHR::eOpaque};
+}
+
+}  // namespace
+
+void HelloTriangleApplication::createDeformPipeline() {
+    if (!DEFORM_MESHES) return;
+
+    // Binding 0: rest pose vertices, 1: this frame's deformed vertices (output)
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings;
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i] = vk::DescriptorSetLayoutBinding{.binding         = i,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .descriptorCount = 1,
+                                                     .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    }
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
+    deformSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::PushConstantRange pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(DeformPushConstants)};
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+        .setLayoutCount = 1, .pSetLayouts = &*deformSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
+    deformPipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+
+    vk::raii::ShaderModule shaderModule = createShaderModule(readFile("shaders/deform.spv"));
+    vk::PipelineShaderStageCreateInfo stageInfo{.stage = vk::ShaderStageFlagBits::eCompute, .module = shaderModule, .pName = "main"};
+    vk::ComputePipelineCreateInfo pipelineInfo{.stage = stageInfo, .layout = deformPipelineLayout};
+    deformPipeline = vk::raii::Pipeline(device, nullptr, pipelineInfo);
+}
+
+/**
+ * @brief per frame vertex copies and refittable BLASes for every submesh an animated instance uses
+ *
+ * The BLASes are built once from the rest pose here, so the TLAS build can reference them and the first frame can refit.
+ */
+void HelloTriangleApplication::createDeformedGeometry() {
+    if (!DEFORM_MESHES) return;
+
+    deformedSlot.assign(submeshes.size(), -1);
+    deformedSubmeshes.clear();
+    for (const SceneInstance& instance : sceneInstances) {
+        if (!instance.animated || deformedSlot[instance.submesh] >= 0) continue;
+        deformedSlot[instance.submesh] = static_cast<int32_t>(deformedSubmeshes.size());
+        deformedSubmeshes.push_back(instance.submesh);
+    }
+    if (deformedSubmeshes.empty()) return;
+
+    // the wave is centered on the deformed geometry; vertices before it are copied along so vertexOffset stays valid
+    InstanceBounds box{.min = glm::vec3(std::numeric_limits<float>::max()), .max = glm::vec3(std::numeric_limits<float>::lowest())};
+    deformedVertexCount = 0;
+    for (uint32_t s : deformedSubmeshes) {
+        InstanceBounds part = instanceBounds(glm::mat4(1.0f), submeshes[s].boundingSphere);
+        box.min             = glm::min(box.min, part.min);
+        box.max             = glm::max(box.max, part.max);
+        deformedVertexCount = std::max(deformedVertexCount, static_cast<uint32_t>(submeshes[s].vertexOffset) + submeshes[s].maxVertex + 1);
+    }
+    deformBounds = glm::vec4(0.5f * (box.min + box.max), 0.5f * glm::length(box.max - box.min));
+    // a vertex moves at most DEFORM_AMPLITUDE * radius, LOD selection and the TLAS policy see the grown spheres
+    for (uint32_t s : deformedSubmeshes) submeshes[s].boundingSphere.w += DEFORM_AMPLITUDE * deformBounds.w;
+
+    vk::DeviceSize vertexBytes = vk::DeviceSize(deformedVertexCount) * DEFORM_VERTEX_STRIDE;
+    deformedVertexBuffers.clear();
+    deformedVertexBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (BufferResource& vertices : deformedVertexBuffers) {
+        vertices.size = vertexBytes;
+        createBuffer(vertices.size,
+                     vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+                         vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     vertices.buffer,
+                     vertices.memory);
+    }
+
+    auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+    vk::DeviceSize scratchAlignment =
+        properties.get<vk::PhysicalDeviceAccelerationStructurePropertiesKHR>().minAccelerationStructureScratchOffsetAlignment;
+    vk::DeviceAddress indexAddr = getIndexAddr(indexBuffer);
+
+    size_t count     = deformedSubmeshes.size();
+    size_t blasCount = count * MAX_FRAMES_IN_FLIGHT;
+    std::vector<vk::AccelerationStructureGeometryKHR> geometries(blasCount);
+    std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos(blasCount);
+    std::vector<vk::AccelerationStructureBuildRangeInfoKHR> buildRanges(blasCount);
+    std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> buildRangePointers(blasCount);
+    deformPrimitiveCounts.resize(count);
+    deformScratchOffsets.resize(count);
+    deformedBlasHandles.clear();
+    deformedBlasBuffers.clear();
+    deformedBlasMemories.clear();
+    deformedBlasAddresses.resize(blasCount);
+    deformedBlasHandles.reserve(blasCount);
+    deformedBlasBuffers.reserve(blasCount);
+    deformedBlasMemories.reserve(blasCount);
+
+    // sizes are the same for every frame: the scratch ranges (large enough for a build or an update) are planned once
+    vk::DeviceSize scratchSize = 0;
+    vk::DeviceSize blasBytes   = 0;
+    for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+        vk::DeviceAddress vertexAddr = getVertAddress(deformedVertexBuffers[f].buffer);
+        for (size_t slot = 0; slot < count; slot++) {
+            const SubMesh& submesh = submeshes[deformedSubmeshes[slot]];
+            size_t b               = f * count + slot;
+            geometries[b]          = deformedGeometry(submesh, vertexAddr, indexAddr);
+            buildInfos[b]          = vk::AccelerationStructureBuildGeometryInfoKHR{.type          = vk::AccelerationStructureTypeKHR::eBottomLevel,
+                                                                                   .flags         = DEFORMED_BLAS_FLAGS,
+                                                                                   .mode          = vk::BuildAccelerationStructureModeKHR::eBuild,
+                                                                                   .geometryCount = 1,
+                                                                                   .pGeometries   = &geometries[b]};
+
+            uint32_t primitiveCount = submesh.lod(std::min(BLAS_LOD, submesh.lodCount - 1)).indexCount / 3;
+            vk::AccelerationStructureBuildSizesInfoKHR buildSizes =
+                device.getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfos[b], {primitiveCount});
+            if (f == 0) {
+                deformPrimitiveCounts[slot] = primitiveCount;
+                deformScratchOffsets[slot]  = scratchSize;
+                scratchSize += alignUp(std::max(buildSizes.buildScratchSize, buildSizes.updateScratchSize), scratchAlignment);
+            }
+
+            vk::raii::Buffer blasBuffer = nullptr;
+            GpuAllocation blasMemory    = nullptr;
+            createBuffer(buildSizes.accelerationStructureSize,
+                         vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                         vk::MemoryPropertyFlagBits::eDeviceLocal,
+                         blasBuffer,
+                         blasMemory);
+            deformedBlasBuffers.push_back(std::move(blasBuffer));
+            deformedBlasMemories.push_back(std::move(blasMemory));
+            vk::AccelerationStructureCreateInfoKHR blasCreateInfo{.buffer = *deformedBlasBuffers.back(),
+                                                                  .offset = 0,
+                                                                  .size   = buildSizes.accelerationStructureSize,
+                                                                  .type   = vk::AccelerationStructureTypeKHR::eBottomLevel};
+            deformedBlasHandles.push_back(device.createAccelerationStructureKHR(blasCreateInfo));
+            buildInfos[b].dstAccelerationStructure = *deformedBlasHandles.back();
+            blasBytes += buildSizes.accelerationStructureSize;
+
+            buildRanges[b]        = vk::AccelerationStructureBuildRangeInfoKHR{.primitiveCount  = primitiveCount,
+                                                                               .primitiveOffset = 0,
+                                                                               .firstVertex     = static_cast<uint32_t>(submesh.vertexOffset),
+                                                                               .transformOffset = 0};
+            buildRangePointers[b] = &buildRanges[b];
+        }
+    }
+
+    // one scratch buffer per frame (+ slack to align its device address)
+    deformScratchBuffers.clear();
+    deformScratchBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    deformScratchAddresses.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+        BufferResource& scratch = deformScratchBuffers[f];
+        scratch.size            = scratchSize + scratchAlignment;
+        createBuffer(scratch.size,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     scratch.buffer,
+                     scratch.memory);
+        deformScratchAddresses[f] = alignUp(device.getBufferAddressKHR({.buffer = *scratch.buffer}), scratchAlignment);
+        for (size_t slot = 0; slot < count; slot++) {
+            buildInfos[f * count + slot].scratchData.deviceAddress = deformScratchAddresses[f] + deformScratchOffsets[slot];
+        }
+    }
+    for (size_t b = 0; b < blasCount; b++) {
+        deformedBlasAddresses[b] = device.getAccelerationStructureAddressKHR({.accelerationStructure = *deformedBlasHandles[b]});
+    }
+
+    // rest pose into every frame's vertices, then the initial builds from it
+    auto cmd = beginSingleTimeCommands();
+    for (BufferResource& vertices : deformedVertexBuffers) {
+        cmd->copyBuffer(*vertexBuffer, *vertices.buffer, vk::BufferCopy{.srcOffset = 0, .dstOffset = 0, .size = vertexBytes});
+    }
+    vk::MemoryBarrier2 copyBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eCopy,
+                                   .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                                   .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+                                   .dstAccessMask = vk::AccessFlagBits2::eShaderRead};
+    cmd->pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &copyBarrier});
+    cmd->buildAccelerationStructuresKHR(buildInfos, buildRangePointers);
+    // make the BLASes visible to the TLAS build
+    vk::MemoryBarrier2 buildBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+                                    .srcAccessMask = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+                                    .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+                                    .dstAccessMask = vk::AccessFlagBits2::eAccelerationStructureReadKHR};
+    cmd->pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &buildBarrier});
+    endSingleTimeCommands(*cmd);
+
+    deformTimestampQueries.clear();
+    if (physicalDevice.getQueueFamilyProperties()[queueIndex].timestampValidBits != 0) {
+        for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+            deformTimestampQueries.emplace_back(device, vk::QueryPoolCreateInfo{.queryType = vk::QueryType::eTimestamp, .queryCount = 2});
+        }
+    }
+    deformStats = DeformStats{.vertices = deformedVertexCount, .blasCount = static_cast<uint32_t>(count)};
+
+    std::cout << "[Info] Deformed geometry: " << count << " submeshes, " << deformedVertexCount << " vertices, per frame "
+              << vertexBytes / 1024 << " KiB vertices + " << blasBytes / MAX_FRAMES_IN_FLIGHT / 1024 << " KiB BLAS + "
+              << scratchSize / 1024 << " KiB scratch" << std::endl;
+}
+
+void HelloTriangleApplication::createDeformDescriptorSets() {
+    if (deformedSubmeshes.empty()) return;
+
+    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *deformSetLayout);
+    vk::DescriptorSetAllocateInfo allocInfo{
+        .descriptorPool = descriptorPool, .descriptorSetCount = static_cast<uint32_t>(layouts.size()), .pSetLayouts = layouts.data()};
+    deformDescriptorSets = device.allocateDescriptorSets(allocInfo);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        std::array<vk::DescriptorBufferInfo, 2> bufferInfos{
+            vk::DescriptorBufferInfo{.buffer = *vertexBuffer, .offset = 0, .range = deformedVertexBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *deformedVertexBuffers[i].buffer, .offset = 0, .range = deformedVertexBuffers[i].size}};
+        std::array<vk::WriteDescriptorSet, 2> descriptorWrites;
+        for (uint32_t b = 0; b < descriptorWrites.size(); b++) {
+            descriptorWrites[b] = vk::WriteDescriptorSet{.dstSet          = *deformDescriptorSets[i],
+                                                         .dstBinding      = b,
+                                                         .dstArrayElement = 0,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                         .pBufferInfo     = &bufferInfos[b]};
+        }
+        device.updateDescriptorSets(descriptorWrites, {});
+    }
+}
+
+/**
+ * @brief animate this frame's vertices and refit (or rebuild) its deformed BLASes
+ *
+ * Recorded before updateTLAS(): the instances of deformed submeshes are marked dirty so the TLAS refits
+ * over the new BLAS bounds. GPU time is measured with timestamps and read one frame cycle later.
+ */
+void HelloTriangleApplication::recordDeformation(const vk::raii::CommandBuffer& cmd) {
+    if (deformTimestampsPending[currentFrame]) {
+        auto [result, ticks] =
+            deformTimestampQueries[currentFrame].getResults<uint64_t>(0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (result == vk::Result::eSuccess) deformStats.gpuMs = double((ticks[1] - ticks[0]) & tlasTimestampMask) * tlasTimestampPeriod * 1e-6;
+        deformTimestampsPending[currentFrame] = false;
+    }
+    bool timestamps = !deformTimestampQueries.empty() && tlasTimestampMask != 0;
+    if (timestamps) {
+        cmd.resetQueryPool(*deformTimestampQueries[currentFrame], 0, 2);
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *deformTimestampQueries[currentFrame], 0);
+    }
+
+    DeformPushConstants constants{.center      = deformBounds,
+                                  .time        = animationTime * 2.0f,
+                                  .amplitude   = DEFORM_AMPLITUDE,
+                                  .frequency   = 1.5f,
+                                  .vertexCount = deformedVertexCount,
+                                  .strideWords = DEFORM_VERTEX_STRIDE / sizeof(uint32_t)};
+    // the frame recorded before this one drew these vertices as its previous positions (motion vectors)
+    vk::MemoryBarrier2 previousBarrier{.srcStageMask = vk::PipelineStageFlagBits2::eVertexAttributeInput,
+                                       .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &previousBarrier});
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *deformPipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *deformPipelineLayout, 0, *deformDescriptorSets[currentFrame], nullptr);
+    cmd.pushConstants<DeformPushConstants>(*deformPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+    cmd.dispatch((constants.vertexCount + 63) / 64, 1, 1);
+
+    // the BLAS update, the raster pass and the ReSTIR GI hit fetch read the new vertices
+    vk::MemoryBarrier2 vertexBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                     .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                                     .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR |
+                                                     vk::PipelineStageFlagBits2::eVertexAttributeInput | vk::PipelineStageFlagBits2::eComputeShader,
+                                     .dstAccessMask = vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eVertexAttributeRead};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &vertexBarrier});
+
+    // refits keep the rest pose's topology, a periodic rebuild restores the trace quality
+    uint32_t updates = ++deformUpdateCount[currentFrame];
+    bool rebuild     = DEFORM_BLAS_REBUILD_INTERVAL > 0 && updates % DEFORM_BLAS_REBUILD_INTERVAL == 0;
+
+    size_t count = deformedSubmeshes.size();
+    std::vector<vk::AccelerationStructureGeometryKHR> geometries(count);
+    std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos(count);
+    std::vector<vk::AccelerationStructureBuildRangeInfoKHR> buildRanges(count);
+    std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> buildRangePointers(count);
+    vk::DeviceAddress vertexAddr = getVertAddress(deformedVertexBuffers[currentFrame].buffer);
+    vk::DeviceAddress indexAddr  = getIndexAddr(indexBuffer);
+    for (size_t slot = 0; slot < count; slot++) {
+        const SubMesh& submesh                 = submeshes[deformedSubmeshes[slot]];
+        vk::AccelerationStructureKHR structure = *deformedBlasHandles[currentFrame * count + slot];
+        geometries[slot]                       = deformedGeometry(submesh, vertexAddr, indexAddr);
+
+        buildInfos[slot] = vk::AccelerationStructureBuildGeometryInfoKHR{
+            .type                     = vk::AccelerationStructureTypeKHR::eBottomLevel,
+            .flags                    = DEFORMED_BLAS_FLAGS,
+            .mode                     = rebuild ? vk::BuildAccelerationStructureModeKHR::eBuild : vk::BuildAccelerationStructureModeKHR::eUpdate,
+            .srcAccelerationStructure = rebuild ? vk::AccelerationStructureKHR{} : structure,
+            .dstAccelerationStructure = structure,
+            .geometryCount            = 1,
+            .pGeometries              = &geometries[slot],
+            .scratchData              = vk::DeviceOrHostAddressKHR(deformScratchAddresses[currentFrame] + deformScratchOffsets[slot])};
+        buildRanges[slot]        = vk::AccelerationStructureBuildRangeInfoKHR{.primitiveCount  = deformPrimitiveCounts[slot],
+                                                                              .primitiveOffset = 0,
+                                                                              .firstVertex     = static_cast<uint32_t>(submesh.vertexOffset),
+                                                                              .transformOffset = 0};
+        buildRangePointers[slot] = &buildRanges[slot];
+    }
+    cmd.buildAccelerationStructuresKHR(buildInfos, buildRangePointers);
+    if (timestamps) {
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR, *deformTimestampQueries[currentFrame], 1);
+        deformTimestampsPending[currentFrame] = true;
+    }
+    // the TLAS build and the ray queries read the updated BLASes
+    vk::MemoryBarrier2 buildBarrier{
+        .srcStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+        .srcAccessMask = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+        .dstStageMask  = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR | vk::PipelineStageFlagBits2::eComputeShader,
+        .dstAccessMask = vk::AccessFlagBits2::eAccelerationStructureReadKHR};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &buildBarrier});
+
+    // the instance boxes in the TLAS come from the BLAS bounds, so every instance of a deformed submesh refits too
+    for (uint32_t i = 0; i < sceneInstances.size(); i++) {
+        if (deformedSlot[sceneInstances[i].submesh] >= 0) markInstanceDirty(i);
+    }
+
+    deformStats.rebuilt = rebuild;
+    if (rebuild) {
+        deformStats.rebuilds++;
+    } else {
+        deformStats.refits++;
+    }
+}
+
+void HelloTriangleApplication::printDeformStats() const {
+    if (deformedSubmeshes.empty()) {
+        std::cout << "[Info] Deformation: off (DEFORM_MESHES)" << std::endl;
+        return;
+    }
+    std::cout << "[Info] Deformation: " << deformStats.vertices << " vertices, " << deformStats.blasCount << " BLASes "
+              << (deformStats.rebuilt ? "rebuilt" : "refit") << " last frame, GPU " << deformStats.gpuMs << " ms (animation + BLAS update), totals: "
+              << deformStats.refits << " refits, " << deformStats.rebuilds << " rebuilds" << std::endl;
+}
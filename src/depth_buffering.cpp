@@ -11,8 +11,8 @@ void HelloTriangleApplication::createDepthResources() {
     depthImageView.clear();
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vk::raii::Image img              = nullptr;
-        vk::raii::DeviceMemory imgMemory = nullptr;
+        vk::raii::Image img     = nullptr;
+        GpuAllocation imgMemory = nullptr;
 
         createImage(swapChainExtent.width, std::max(swapChainExtent.height, 1u), depthFormat,
                     vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment,
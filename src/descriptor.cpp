@@ -16,26 +16,31 @@ void HelloTriangleApplication::createDescriptorPool() {
     std::array<vk::DescriptorPoolSize, 5> poolSizes;
     // uniform buffer
     poolSizes[0] = vk::DescriptorPoolSize{.type = vk::DescriptorType::eUniformBuffer, .descriptorCount = MAX_FRAMES_IN_FLIGHT + 10};
-    // texture sampler
-    poolSizes[1] = vk::DescriptorPoolSize{.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = MAX_FRAMES_IN_FLIGHT + 10};
+    // texture sampler, + the compute set's history (previous position and normal), motion vectors, the spatial reuse,
+    // ReSTIR GI and denoiser sets
+    poolSizes[1] = vk::DescriptorPoolSize{.type            = vk::DescriptorType::eCombinedImageSampler,
+                                          .descriptorCount = MAX_FRAMES_IN_FLIGHT + 10 + 32 * MAX_FRAMES_IN_FLIGHT};
     // light buffer
     poolSizes[2] = vk::DescriptorPoolSize{
         .type            = vk::DescriptorType::eStorageBuffer,
-        .descriptorCount = MAX_FRAMES_IN_FLIGHT + 10  // some work around number
+        // + meshlet culling, deformation, light animation and cluster cull sets, instance transforms, light alias table,
+        // light tree, cluster lists, ReSTIR reservoirs (this and the previous frame's), previous instance transforms,
+        // the spatial reuse and ReSTIR GI sets
+        .descriptorCount = MAX_FRAMES_IN_FLIGHT + 10 + 32 * MAX_FRAMES_IN_FLIGHT
     };
     // storage image
     poolSizes[3] = vk::DescriptorPoolSize{
         .type            = vk::DescriptorType::eStorageImage,
-        .descriptorCount = MAX_FRAMES_IN_FLIGHT + 10  // some work around number
+        .descriptorCount = MAX_FRAMES_IN_FLIGHT + 10 + 19 * MAX_FRAMES_IN_FLIGHT  // + the spatial reuse, GI resolve and denoiser sets
     };
 
     poolSizes[4] = vk::DescriptorPoolSize{
         .type            = vk::DescriptorType::eAccelerationStructureKHR,
-        .descriptorCount = 2  // some work around number
+        .descriptorCount = 5 * MAX_FRAMES_IN_FLIGHT  // compute, spatial reuse and ReSTIR GI sets
     };
     vk::DescriptorPoolCreateInfo poolInfo{
         .flags         = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-        .maxSets       = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT + 10),  // total number of descriptor sets that can be allocated
+        .maxSets       = static_cast<uint32_t>(10 * MAX_FRAMES_IN_FLIGHT + 10),  // total number of descriptor sets that can be allocated
         .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
         .pPoolSizes    = poolSizes.data()};
 
@@ -51,7 +56,7 @@ every binding need to be described in vk::DescriptorSetLayoutBinding structure
     5. pImmutableSamplers : used for image sampler, can be nullptr for uniform buffer
     */
 void HelloTriangleApplication::createDescriptorSetLayout() {
-    std::array<vk::DescriptorSetLayoutBinding, 2> bindings;
+    std::vector<vk::DescriptorSetLayoutBinding> bindings(2);
 
     // binding 0 : uniform buffer object (MVP matrices)
     bindings[0] = vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr);
@@ -59,6 +64,17 @@ void HelloTriangleApplication::createDescriptorSetLayout() {
     // binding 1 : combined image sampler (texture sampler)
     bindings[1] = vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr);
 
+    // binding 2 : material colors for the packed vertex layout
+    if (PACKED_VERTICES) {
+        bindings.push_back(vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr));
+    }
+
+    // binding 3 : model matrix per scene instance
+    bindings.push_back(vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr));
+
+    // binding 4 : the previous frame's model matrix per scene instance (motion vectors)
+    bindings.push_back(vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr));
+
     vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
     descriptorSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
 }
@@ -97,6 +113,33 @@ void HelloTriangleApplication::createDescriptorSets() {
                                                            .pImageInfo      = &imageInfo}};
         //
         device.updateDescriptorSets(descriptorWrites, {});
+        if (PACKED_VERTICES) {
+            vk::DescriptorBufferInfo materialInfo{.buffer = materialBufferResource.buffer, .offset = 0, .range = materialBufferResource.size};
+            vk::WriteDescriptorSet materialWrite{.dstSet          = descriptorSets[i],
+                                                 .dstBinding      = 2,
+                                                 .dstArrayElement = 0,
+                                                 .descriptorCount = 1,
+                                                 .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                 .pBufferInfo     = &materialInfo};
+            device.updateDescriptorSets(materialWrite, {});
+        }
+        vk::DescriptorBufferInfo transformInfo{.buffer = instanceTransformBuffers[i].buffer, .offset = 0, .range = instanceTransformBuffers[i].size};
+        vk::WriteDescriptorSet transformWrite{.dstSet          = descriptorSets[i],
+                                              .dstBinding      = 3,
+                                              .dstArrayElement = 0,
+                                              .descriptorCount = 1,
+                                              .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                              .pBufferInfo     = &transformInfo};
+        device.updateDescriptorSets(transformWrite, {});
+        vk::DescriptorBufferInfo previousTransformInfo{
+            .buffer = instancePreviousTransformBuffers[i].buffer, .offset = 0, .range = instancePreviousTransformBuffers[i].size};
+        vk::WriteDescriptorSet previousTransformWrite{.dstSet          = descriptorSets[i],
+                                                      .dstBinding      = 4,
+                                                      .dstArrayElement = 0,
+                                                      .descriptorCount = 1,
+                                                      .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                      .pBufferInfo     = &previousTransformInfo};
+        device.updateDescriptorSets(previousTransformWrite, {});
     }
 }
 void HelloTriangleApplication::createComputeDescriptorSetLayout() {
@@ -107,8 +150,17 @@ void HelloTriangleApplication::createComputeDescriptorSetLayout() {
     3. Light Buffer
     4. Storage Image (Output Image)
     5. TLAS (for ray tracing)
+    6. Light alias table
+    7. Light tree
+    8. Cluster light ranges
+    9. Cluster light indices
+    10. ReSTIR reservoirs
+    11. Previous frame's G-Buffer Position
+    12. Previous frame's G-Buffer Normal
+    13. G-Buffer motion vectors
+    14. Previous frame's ReSTIR reservoirs
     */
-    std::array<vk::DescriptorSetLayoutBinding, 6> bindings;
+    std::array<vk::DescriptorSetLayoutBinding, 15> bindings;
     // Binding 0: G-Buffer Position (Input Texture)
     bindings[0] = vk::DescriptorSetLayoutBinding{.binding         = 0,
                                                  .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
@@ -140,6 +192,34 @@ void HelloTriangleApplication::createComputeDescriptorSetLayout() {
                                                  .descriptorCount = 1,
                                                  .stageFlags      = vk::ShaderStageFlagBits::eCompute};
 
+    // Binding 6: Light alias table
+    bindings[6] = vk::DescriptorSetLayoutBinding{
+        .binding = 6, .descriptorType = vk::DescriptorType::eStorageBuffer, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute};
+
+    // Binding 7: Light tree
+    bindings[7] = vk::DescriptorSetLayoutBinding{
+        .binding = 7, .descriptorType = vk::DescriptorType::eStorageBuffer, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute};
+
+    // Binding 8, 9: Cluster light ranges and indices, 10: ReSTIR reservoirs
+    for (uint32_t b = 8; b <= 10; b++) {
+        bindings[b] = vk::DescriptorSetLayoutBinding{.binding         = b,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .descriptorCount = 1,
+                                                     .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    }
+
+    // Binding 11, 12: previous frame's G-Buffer Position and Normal, 13: motion vectors (temporal reuse)
+    for (uint32_t b = 11; b <= 13; b++) {
+        bindings[b] = vk::DescriptorSetLayoutBinding{.binding         = b,
+                                                     .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                                                     .descriptorCount = 1,
+                                                     .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    }
+
+    // Binding 14: previous frame's ReSTIR reservoirs
+    bindings[14] = vk::DescriptorSetLayoutBinding{
+        .binding = 14, .descriptorType = vk::DescriptorType::eStorageBuffer, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute};
+
     vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
 
     computeDescriptorSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
@@ -167,7 +247,26 @@ void HelloTriangleApplication::createComputeDescriptorSets() {
         vk::DescriptorImageInfo albedoInfo{
             .sampler = *viking_room.textureSampler, .imageView = *gBufferAlbedoImageView[i], .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
 
-        vk::DescriptorBufferInfo lightBufferInfo{.buffer = lightBufferResource.buffer, .offset = 0, .range = sizeof(Light) * lights.size()};
+        // the lights and their tree follow the frame: each frame in flight updates its own copies
+        vk::DescriptorBufferInfo lightBufferInfo{.buffer = lightBuffers[i].buffer, .offset = 0, .range = lightBuffers[i].size};
+        vk::DescriptorBufferInfo lightAliasInfo{.buffer = lightAliasBufferResource.buffer, .offset = 0, .range = lightAliasBufferResource.size};
+        vk::DescriptorBufferInfo lightTreeInfo{.buffer = lightTreeBuffers[i].buffer, .offset = 0, .range = lightTreeBuffers[i].size};
+        vk::DescriptorBufferInfo clusterRangeInfo{.buffer = clusterRangeBuffers[i].buffer, .offset = 0, .range = clusterRangeBuffers[i].size};
+        vk::DescriptorBufferInfo clusterIndexInfo{.buffer = clusterIndexBuffers[i].buffer, .offset = 0, .range = clusterIndexBuffers[i].size};
+        vk::DescriptorBufferInfo reservoirInfo{.buffer = reservoirBuffers[i].buffer, .offset = 0, .range = reservoirBuffers[i].size};
+
+        // temporal reuse reads what the frame recorded before this one left behind
+        size_t previous = (i + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+        vk::DescriptorImageInfo previousPosInfo{.sampler     = *viking_room.textureSampler,
+                                                .imageView   = *gBufferPositionImageView[previous],
+                                                .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+        vk::DescriptorImageInfo previousNormalInfo{.sampler     = *viking_room.textureSampler,
+                                                   .imageView   = *gBufferNormalImageView[previous],
+                                                   .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+        vk::DescriptorImageInfo motionInfo{
+            .sampler = *viking_room.textureSampler, .imageView = *gBufferMotionImageView[i], .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+        vk::DescriptorBufferInfo previousReservoirInfo{
+            .buffer = reservoirBuffers[previous].buffer, .offset = 0, .range = reservoirBuffers[previous].size};
 
         vk::DescriptorImageInfo outputInfo{
             .imageView   = *storageImageView[i],
@@ -188,7 +287,7 @@ void HelloTriangleApplication::createComputeDescriptorSets() {
                                        .descriptorType  = vk::DescriptorType::eAccelerationStructureKHR};
 
         // Write descriptor set
-        std::array<vk::WriteDescriptorSet, 6> descriptorWrites;
+        std::array<vk::WriteDescriptorSet, 15> descriptorWrites;
         // G-Buffer Position
         descriptorWrites[0] = vk::WriteDescriptorSet{.dstSet          = *computeDescriptorSets[i],
                                                      .dstBinding      = 0,
@@ -227,6 +326,57 @@ void HelloTriangleApplication::createComputeDescriptorSets() {
 
         // TLAS
         descriptorWrites[5] = asWrite;
+        // Light alias table
+        descriptorWrites[6] = vk::WriteDescriptorSet{.dstSet          = *computeDescriptorSets[i],
+                                                     .dstBinding      = 6,
+                                                     .dstArrayElement = 0,
+                                                     .descriptorCount = 1,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .pBufferInfo     = &lightAliasInfo};
+        // Light tree
+        descriptorWrites[7] = vk::WriteDescriptorSet{.dstSet          = *computeDescriptorSets[i],
+                                                     .dstBinding      = 7,
+                                                     .dstArrayElement = 0,
+                                                     .descriptorCount = 1,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .pBufferInfo     = &lightTreeInfo};
+        // Cluster light ranges and indices
+        descriptorWrites[8] = vk::WriteDescriptorSet{.dstSet          = *computeDescriptorSets[i],
+                                                     .dstBinding      = 8,
+                                                     .dstArrayElement = 0,
+                                                     .descriptorCount = 1,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .pBufferInfo     = &clusterRangeInfo};
+        descriptorWrites[9] = vk::WriteDescriptorSet{.dstSet          = *computeDescriptorSets[i],
+                                                     .dstBinding      = 9,
+                                                     .dstArrayElement = 0,
+                                                     .descriptorCount = 1,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .pBufferInfo     = &clusterIndexInfo};
+        // ReSTIR reservoirs
+        descriptorWrites[10] = vk::WriteDescriptorSet{.dstSet          = *computeDescriptorSets[i],
+                                                      .dstBinding      = 10,
+                                                      .dstArrayElement = 0,
+                                                      .descriptorCount = 1,
+                                                      .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                      .pBufferInfo     = &reservoirInfo};
+        // Previous frame's G-Buffer Position and Normal, motion vectors
+        std::array<const vk::DescriptorImageInfo*, 3> historyImages{&previousPosInfo, &previousNormalInfo, &motionInfo};
+        for (uint32_t b = 0; b < historyImages.size(); b++) {
+            descriptorWrites[11 + b] = vk::WriteDescriptorSet{.dstSet          = *computeDescriptorSets[i],
+                                                              .dstBinding      = 11 + b,
+                                                              .dstArrayElement = 0,
+                                                              .descriptorCount = 1,
+                                                              .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                                                              .pImageInfo      = historyImages[b]};
+        }
+        // Previous frame's ReSTIR reservoirs
+        descriptorWrites[14] = vk::WriteDescriptorSet{.dstSet          = *computeDescriptorSets[i],
+                                                      .dstBinding      = 14,
+                                                      .dstArrayElement = 0,
+                                                      .descriptorCount = 1,
+                                                      .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                      .pBufferInfo     = &previousReservoirInfo};
         device.updateDescriptorSets(descriptorWrites, {});
     }
 }
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief dirty element tracking for a buffer that exists once per frame in flight
+ *
+ * mark(i) queues element i for every frame's copy (a bit per frame keeps it from being queued twice);
+ * take(frame) hands back that frame's dirty elements as sorted [begin, end) ranges and forgets them.
+ * A change made while recording any frame thus reaches each copy the next time its frame is recorded.
+ * No Vulkan types: the caller writes the ranges into its persistently mapped buffers.
+ */
+template <uint32_t Frames>
+class FrameDirtyRanges {
+    static_assert(Frames <= 8, "one mask bit per frame in flight");
+
+   public:
+    using Range = std::pair<uint32_t, uint32_t>;
+
+    void resize(size_t count) {
+        mask.assign(count, 0);
+        for (std::vector<uint32_t>& queue : queues) queue.clear();
+        all.fill(false);
+    }
+    size_t size() const { return mask.size(); }
+
+    void mark(uint32_t index) {
+        for (uint32_t frame = 0; frame < Frames; frame++) {
+            if (all[frame] || (mask[index] & (1u << frame))) continue;
+            mask[index] |= 1u << frame;
+            queues[frame].push_back(index);
+        }
+    }
+    // everything changed: one range per frame, no per element queueing
+    void markAll() { all.fill(true); }
+
+    /**
+     * @brief this frame's dirty ranges, merging neighbours closer than mergeGap elements (rewriting a few
+     *  clean elements is cheaper than another copy)
+     */
+    std::vector<Range> take(uint32_t frame, uint32_t mergeGap = 0) {
+        std::vector<Range> ranges;
+        std::vector<uint32_t>& queue = queues[frame];
+        if (all[frame]) {
+            all[frame] = false;
+            if (!mask.empty()) ranges.push_back({0u, static_cast<uint32_t>(mask.size())});
+        } else {
+            std::sort(queue.begin(), queue.end());
+            for (uint32_t index : queue) {
+                if (!ranges.empty() && index <= ranges.back().second + mergeGap) {
+                    ranges.back().second = index + 1;
+                } else {
+                    ranges.push_back({index, index + 1});
+                }
+            }
+        }
+        for (uint32_t index : queue) mask[index] &= ~(1u << frame);
+        queue.clear();
+        return ranges;
+    }
+
+   private:
+    std::vector<uint8_t> mask;  // bit f: the element is queued in queues[f]
+    std::array<std::vector<uint32_t>, Frames> queues;
+    std::array<bool, Frames> all{};
+};
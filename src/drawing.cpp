@@ -38,7 +38,14 @@ void HelloTriangleApplication::createCommandBuffers() {
 void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex) {
     auto& cmd = commandBuffers[currentFrame];
     cmd.begin({});
+    updateLights(cmd);
+    if (!deformedSubmeshes.empty()) {
+        recordDeformation(cmd);
+    }
     updateTLAS(cmd);
+    if (clusterCulling) {
+        recordMeshletCulling(cmd);
+    }
     // --- PHASE 1: Prepare Image Layouts for Rasterization ---
     // Transition Swapchain image to Color Attachment layout
     draw_transition_image_layout(*gBufferAlbedoImage[currentFrame],
@@ -59,17 +66,26 @@ void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex) {
                                  vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
                                  vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
                                  vk::ImageAspectFlagBits::eDepth);
-    // Transition Position G-Buffer
+    // Transition Position G-Buffer (the previous frame's ReSTIR pass may still read it as its history)
     draw_transition_image_layout(*gBufferPositionImage[currentFrame],
                                  vk::ImageLayout::eUndefined,
                                  vk::ImageLayout::eColorAttachmentOptimal,
                                  {},
                                  vk::AccessFlagBits2::eColorAttachmentWrite,
-                                 vk::PipelineStageFlagBits2::eTopOfPipe,
+                                 vk::PipelineStageFlagBits2::eComputeShader,
                                  vk::PipelineStageFlagBits2::eColorAttachmentOutput,
                                  vk::ImageAspectFlagBits::eColor);
-    // Transition Normal G-Buffer
+    // Transition Normal G-Buffer (history as well)
     draw_transition_image_layout(*gBufferNormalImage[currentFrame],
+                                 vk::ImageLayout::eUndefined,
+                                 vk::ImageLayout::eColorAttachmentOptimal,
+                                 {},
+                                 vk::AccessFlagBits2::eColorAttachmentWrite,
+                                 vk::PipelineStageFlagBits2::eComputeShader,
+                                 vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                                 vk::ImageAspectFlagBits::eColor);
+    // Transition Motion G-Buffer
+    draw_transition_image_layout(*gBufferMotionImage[currentFrame],
                                  vk::ImageLayout::eUndefined,
                                  vk::ImageLayout::eColorAttachmentOptimal,
                                  {},
@@ -82,7 +98,7 @@ void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex) {
     vk::ClearValue clearColor = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f);
     vk::ClearValue clearDepth = vk::ClearDepthStencilValue(1.0f, 0);
 
-    // Setup G-Buffer attachments (Alebedo, World Position, Normal)
+    // Setup G-Buffer attachments (Alebedo, World Position, Normal, Motion)
     vk::RenderingAttachmentInfo colorAttachmentInfo[] = {{.imageView   = *gBufferAlbedoImageView[currentFrame],
                                                           .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
                                                           .loadOp      = vk::AttachmentLoadOp::eClear,
@@ -94,6 +110,11 @@ void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex) {
                                                           .storeOp     = vk::AttachmentStoreOp::eStore,
                                                           .clearValue  = clearColor},
                                                          {.imageView   = *gBufferNormalImageView[currentFrame],
+                                                          .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                                                          .loadOp      = vk::AttachmentLoadOp::eClear,
+                                                          .storeOp     = vk::AttachmentStoreOp::eStore,
+                                                          .clearValue  = clearColor},
+                                                         {.imageView   = *gBufferMotionImageView[currentFrame],
                                                           .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
                                                           .loadOp      = vk::AttachmentLoadOp::eClear,
                                                           .storeOp     = vk::AttachmentStoreOp::eStore,
@@ -107,7 +128,7 @@ void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex) {
 
     vk::RenderingInfo renderingInfo = {.renderArea           = {.offset = {0, 0}, .extent = swapChainExtent},
                                        .layerCount           = 1,
-                                       .colorAttachmentCount = 3,
+                                       .colorAttachmentCount = 4,
                                        .pColorAttachments    = colorAttachmentInfo,
                                        .pDepthAttachment     = &depthAttachmentInfo};
     //
@@ -116,32 +137,47 @@ void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex) {
     cmd.setViewport(0, vk::Viewport(0.0f, 0.0f, (float)swapChainExtent.width, (float)swapChainExtent.height, 0.0f, 1.0f));
     cmd.setScissor(0, vk::Rect2D({0, 0}, swapChainExtent));
     //
-    cmd.bindVertexBuffers(0, *vertexBuffer, {0});
+    if (PACKED_VERTICES) {
+        cmd.bindVertexBuffers(0, {*vertexBuffer, *vertexAttributeBuffer}, {0, 0});
+    } else {
+        cmd.bindVertexBuffers(0, *vertexBuffer, {0});
+    }
     cmd.bindIndexBuffer(*indexBuffer, 0, vk::IndexType::eUint32);
+    // previous positions for the motion vectors: static vertices do not move, deformed ones come from the last frame
+    const uint32_t previousFrame = (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+    cmd.bindVertexBuffers(PREVIOUS_POSITION_BINDING, *vertexBuffer, {0});
     //
     // Bind Graphics Descriptor Set (Set 0: MVP matrices)
     cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0, *descriptorSets[currentFrame], nullptr);
-    glm::mat4 spin = currentModelMatrix;
-    // Rotate -90 degrees on X to make Y-Up Bunny stand in Z-Up World
-    glm::mat4 standUp     = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    glm::mat4 bunnyMatrix = spin * standUp;
-    glm::mat4 wallMatrix  = glm::mat4(1.0f);
-
+    // one instanced draw per submesh, the vertex shader picks its model matrix by instance index
+    bool deformedBound = false;
     for (size_t i = 0; i < submeshes.size(); i++) {
-        MeshPushConstants constants;
-
-        // The Cornell Box is the LAST submesh (added in load_Model.cpp)
-        // Everything before it is part of the Bunny
-        bool isCornellBox = (i == submeshes.size() - 1);
-
-        if (!isCornellBox) {
-            constants.modelMatrix = bunnyMatrix;  // All bunny parts spin
-        } else {
-            constants.modelMatrix = wallMatrix;  // Box stays static
+        uint32_t firstInstance = submeshInstances[i].x;
+        uint32_t instanceCount = submeshInstances[i].y;
+        if (instanceCount == 0) continue;
+        // deformed submeshes read this frame's animated positions (binding 0 in both vertex layouts)
+        bool deformed = !deformedSubmeshes.empty() && deformedSlot[i] >= 0;
+        if (deformed != deformedBound) {
+            cmd.bindVertexBuffers(0, deformed ? *deformedVertexBuffers[currentFrame].buffer : *vertexBuffer, {0});
+            cmd.bindVertexBuffers(PREVIOUS_POSITION_BINDING, deformed ? *deformedVertexBuffers[previousFrame].buffer : *vertexBuffer, {0});
+            deformedBound = deformed;
         }
 
-        cmd.pushConstants<MeshPushConstants>(*pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, constants);
-        cmd.drawIndexed(submeshes[i].indexCount, 1, submeshes[i].indexOffset, 0, 0);
+        if (clusterCulling && submeshes[i].meshletCount > 0) {
+            // one command per meshlet, culled ones have instanceCount 0
+            cmd.drawIndexedIndirect(*meshletCommandBuffers[currentFrame].buffer,
+                                    submeshes[i].firstMeshlet * sizeof(vk::DrawIndexedIndirectCommand),
+                                    submeshes[i].meshletCount,
+                                    sizeof(vk::DrawIndexedIndirectCommand));
+            continue;
+        }
+        // all copies share one LOD, the finest any of them needs
+        uint32_t level = submeshes[i].lodCount - 1;
+        for (uint32_t instance = firstInstance; instance < firstInstance + instanceCount && level > 0; instance++) {
+            level = std::min(level, selectLod(submeshes[i], sceneInstanceMatrix(instance)));
+        }
+        MeshLod lod = submeshes[i].lod(level);
+        cmd.drawIndexed(lod.indexCount, instanceCount, lod.indexOffset, submeshes[i].vertexOffset, firstInstance);
     }
     cmd.endRendering();
     // --- PHASE 3: Synchronize and Transition G-Buffers for Compute Read ---
@@ -172,17 +208,64 @@ void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex) {
                                  vk::PipelineStageFlagBits2::eColorAttachmentOutput,
                                  vk::PipelineStageFlagBits2::eComputeShader,
                                  vk::ImageAspectFlagBits::eColor);
+    draw_transition_image_layout(*gBufferMotionImage[currentFrame],
+                                 vk::ImageLayout::eColorAttachmentOptimal,
+                                 vk::ImageLayout::eShaderReadOnlyOptimal,
+                                 vk::AccessFlagBits2::eColorAttachmentWrite,
+                                 vk::AccessFlagBits2::eShaderRead,
+                                 vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                                 vk::PipelineStageFlagBits2::eComputeShader,
+                                 vk::ImageAspectFlagBits::eColor);
+
+    // cull the lights into clusters from the G-buffer positions, restir.slang reads the lists
+    recordLightCulling(cmd);
 
     // --- PHASE 4: Compute Pass (Lighting / ReSTIR) ---
     cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *computePipeline);
 
     // Bind Compute Descriptor Set (Set 0: G-Buffers, Lights, Output Image)
     cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *computePipelineLayout, 0, *computeDescriptorSets[currentFrame], nullptr);
+    // temporal reuse merges the reservoirs the previous frame wrote (only when it wrote them)
+    bool temporal = restirEnabled && temporalReuse && restirHistoryValid;
+    // with spatial reuse restir.slang only writes the reservoirs, the last spatial pass shades
+    bool spatial = restirEnabled && !clusterHeatmap && spatialReuse.passes > 0;
+    RestirPushConstants restirConstants{.clusters               = clusterGrid(),
+                                        .previousCameraPosition = glm::vec4(previousCameraFrame.position, 1.0f),
+                                        .previousCameraForward  = glm::vec4(previousCameraFrame.forward, 0.0f),
+                                        .frameIndex             = frameIndex++,
+                                        .lightCount             = static_cast<uint32_t>(lights.size()),
+                                        .lightSampler           = static_cast<uint32_t>(lightSampler),
+                                        .debugView              = clusterHeatmap ? 1u : 0u,
+                                        .candidateCount         = restirEnabled ? RESTIR_CANDIDATES : 0u,
+                                        .temporalReuse          = temporal ? 1u : 0u,
+                                        .deferShading           = spatial ? 1u : 0u};
+    cmd.pushConstants<RestirPushConstants>(*computePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, restirConstants);
+    // the previous frame's ReSTIR pass wrote the reservoirs read here and read the ones written here
+    vk::MemoryBarrier2 reservoirBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                        .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                                        .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                        .dstAccessMask = vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &reservoirBarrier});
+    // the heatmap and the plain single sample leave the reservoirs alone
+    restirHistoryValid = restirEnabled && !clusterHeatmap;
 
     // Calculate Workgroup counts based on window size (assuming 16x16 local groups in shader)
     uint32_t groupCountX = (swapChainExtent.width + 15) / 16;
     uint32_t groupCountY = (swapChainExtent.height + 15) / 16;
     cmd.dispatch(groupCountX, groupCountY, 1);
+    if (spatial) recordSpatialReuse(cmd);
+    // one-bounce indirect light on top; a frame without it leaves no GI history
+    if (giEnabled && !clusterHeatmap) {
+        recordIndirectLighting(cmd);
+    } else {
+        giHistoryValid = false;
+    }
+    // the denoised image replaces the lit one; a frame without it leaves no denoiser history
+    if (denoiserEnabled && !clusterHeatmap) {
+        recordDenoiser(cmd);
+    } else {
+        denoiserHistoryValid = false;
+    }
 
     // --- PHASE 5: Transfer Compute Result (storageImage) to Swapchain ---
 
@@ -336,6 +419,7 @@ void HelloTriangleApplication::drawFrame() {
 
     // Store it in the class member
     currentModelMatrix = glm::rotate(glm::mat4(1.0f), time * glm::radians(10.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    animationTime      = time;
 
     // wait until the previous frame is finished
     auto [result, imageIndex] = swapChain.acquireNextImage(UINT64_MAX, *presentCompleteSemaphore[currentFrame], nullptr);
@@ -355,6 +439,8 @@ void HelloTriangleApplication::drawFrame() {
     commandBuffers[currentFrame].reset();
     recordCommandBuffer(imageIndex);
 
+    // uploads recorded since the last frame (e.g. by recreateSwapChain) execute before it
+    uploads.flush();
     // submit command buffer
     vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
     const vk::SubmitInfo submitInfo{.waitSemaphoreCount   = 1,
@@ -393,3 +479,27 @@ void HelloTriangleApplication::drawFrame() {
     // semaphoreIndex = (semaphoreIndex + 1) % presentCompleteSemaphore.size(); // No longer needed
     currentFrame   = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
+
+/**
+ * @brief coarsest LOD whose simplification error stays below LOD_ERROR_PIXELS on screen
+ *
+ * The bounding sphere gives the distance (to its nearest point) and the model matrix scale;
+ * inside the sphere we always draw full detail.
+ */
+uint32_t HelloTriangleApplication::selectLod(const SubMesh& submesh, const glm::mat4& modelMatrix) const {
+    if (submesh.lodCount <= 1) return 0;
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(glm::vec3(submesh.boundingSphere), 1.0f));
+    float scale      = std::max(
+        {glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))});
+    float distance = glm::distance(center, camera.pos) - submesh.boundingSphere.w * scale;
+    if (distance <= 0.0f) return 0;
+
+    // pixels covered by one world unit at that distance
+    float pixelsPerUnit = static_cast<float>(swapChainExtent.height) / (2.0f * std::tan(glm::radians(CAMERA_FOV_DEGREES) * 0.5f) * distance);
+    uint32_t level      = 0;
+    for (uint32_t l = 1; l < submesh.lodCount; l++) {
+        if (submesh.lods[l - 1].error * scale * pixelsPerUnit > LOD_ERROR_PIXELS) break;
+        level = l;
+    }
+    return level;
+}
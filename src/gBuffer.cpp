@@ -13,11 +13,15 @@ void HelloTriangleApplication::createGbufferResources() {
     gBufferAlbedoImage.clear();
     gBufferAlbedoImageMemory.clear();
     gBufferAlbedoImageView.clear();
+    //
+    gBufferMotionImage.clear();
+    gBufferMotionImageMemory.clear();
+    gBufferMotionImageView.clear();
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         // Position
-        vk::raii::Image posImage              = nullptr;
-        vk::raii::DeviceMemory posImageMemory = nullptr;
+        vk::raii::Image posImage     = nullptr;
+        GpuAllocation posImageMemory = nullptr;
         createImage(swapChainExtent.width, std::max(swapChainExtent.height, 1u), vk::Format::eR32G32B32A32Sfloat, vk::ImageTiling::eOptimal,
                     vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
                         vk::ImageUsageFlagBits::eStorage,
@@ -27,8 +31,8 @@ void HelloTriangleApplication::createGbufferResources() {
         gBufferPositionImageMemory.push_back(std::move(posImageMemory));
 
         // Normal
-        vk::raii::Image normImage              = nullptr;
-        vk::raii::DeviceMemory normImageMemory = nullptr;
+        vk::raii::Image normImage     = nullptr;
+        GpuAllocation normImageMemory = nullptr;
         createImage(swapChainExtent.width, std::max(swapChainExtent.height, 1u), vk::Format::eR32G32B32A32Sfloat, vk::ImageTiling::eOptimal,
                     vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
                         vk::ImageUsageFlagBits::eStorage,
@@ -38,8 +42,8 @@ void HelloTriangleApplication::createGbufferResources() {
         gBufferNormalImageMemory.push_back(std::move(normImageMemory));
 
         // Albedo
-        vk::raii::Image albedoImage              = nullptr;
-        vk::raii::DeviceMemory albedoImageMemory = nullptr;
+        vk::raii::Image albedoImage     = nullptr;
+        GpuAllocation albedoImageMemory = nullptr;
         createImage(swapChainExtent.width, std::max(swapChainExtent.height, 1u), vk::Format::eR32G32B32A32Sfloat, vk::ImageTiling::eOptimal,
                     vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
                         vk::ImageUsageFlagBits::eStorage,
@@ -47,6 +51,24 @@ void HelloTriangleApplication::createGbufferResources() {
         gBufferAlbedoImageView.push_back(createImageView(albedoImage, vk::Format::eR32G32B32A32Sfloat, vk::ImageAspectFlagBits::eColor));
         gBufferAlbedoImage.push_back(std::move(albedoImage));
         gBufferAlbedoImageMemory.push_back(std::move(albedoImageMemory));
+
+        // Motion vectors (uv offset to the previous frame, previous view depth)
+        vk::raii::Image motionImage     = nullptr;
+        GpuAllocation motionImageMemory = nullptr;
+        createImage(swapChainExtent.width, std::max(swapChainExtent.height, 1u), vk::Format::eR16G16B16A16Sfloat, vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
+                    vk::MemoryPropertyFlagBits::eDeviceLocal, motionImage, motionImageMemory);
+        gBufferMotionImageView.push_back(createImageView(motionImage, vk::Format::eR16G16B16A16Sfloat, vk::ImageAspectFlagBits::eColor));
+
+        // the next frame reads this frame's position and normal as its history, and the compute set expects
+        // them readable even before a frame has rendered into them
+        for (vk::Image image : {*gBufferPositionImage[i], *gBufferNormalImage[i], *motionImage}) {
+            transitionImageLayout(image, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits2::eNone,
+                                  vk::AccessFlagBits2::eShaderRead, vk::PipelineStageFlagBits2::eTopOfPipe,
+                                  vk::PipelineStageFlagBits2::eComputeShader, vk::ImageAspectFlagBits::eColor);
+        }
+        gBufferMotionImage.push_back(std::move(motionImage));
+        gBufferMotionImageMemory.push_back(std::move(motionImageMemory));
     }
 }
 /**
@@ -61,8 +83,8 @@ void HelloTriangleApplication::createStorageImage() {
     storageImageView.clear();
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vk::raii::Image img              = nullptr;
-        vk::raii::DeviceMemory imgMemory = nullptr;
+        vk::raii::Image img     = nullptr;
+        GpuAllocation imgMemory = nullptr;
 
         createImage(swapChainExtent.width, std::max(swapChainExtent.height, 1u), vk::Format::eR32G32B32A32Sfloat, vk::ImageTiling::eOptimal,
                     vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled,
@@ -78,6 +100,20 @@ void HelloTriangleApplication::createStorageImage() {
         storageImage.push_back(std::move(img));
         storageImageMemory.push_back(std::move(imgMemory));
     }
+
+    // ReSTIR reservoirs, one per pixel of the storage image, rewritten every frame by restir.slang (and copied back
+    // into after an odd spatial reuse chain); new ones hold no history
+    restirHistoryValid = false;
+    reservoirBuffers.clear();
+    reservoirBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        reservoirBuffers[i].size = sizeof(Reservoir) * swapChainExtent.width * std::max(swapChainExtent.height, 1u);
+        createBuffer(reservoirBuffers[i].size,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     reservoirBuffers[i].buffer,
+                     reservoirBuffers[i].memory);
+    }
     std::cout << "[Info] Storage Images created (Ready for Compute Shader output)" << std::endl;
 }
 
@@ -88,7 +124,8 @@ void HelloTriangleApplication::transitionImageLayout(vk::Image image, vk::ImageL
                                                      vk::PipelineStageFlags2 srcStageMask,
                                                      vk::PipelineStageFlags2 dstStageMask,
                                                      vk::ImageAspectFlags image_aspectMask) {
-    auto commandBuffer = beginSingleTimeCommands();
+    // recorded into the current upload batch, which is submitted before the next frame
+    const vk::raii::CommandBuffer& commandBuffer = uploads.commandBuffer();
 
     vk::ImageMemoryBarrier2 barrier = {.srcStageMask = srcStageMask,
                                        .srcAccessMask = srcAccessMask,
@@ -108,7 +145,5 @@ void HelloTriangleApplication::transitionImageLayout(vk::Image image, vk::ImageL
     vk::DependencyInfo dependencyInfo = {
         .dependencyFlags = {}, .imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &barrier};
 
-    commandBuffer->pipelineBarrier2(dependencyInfo);
-
-    endSingleTimeCommands(*commandBuffer);
+    commandBuffer.pipelineBarrier2(dependencyInfo);
 }
@@ -0,0 +1,243 @@
+#include "gpu_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+// images at least this share of a block get their own vk::DeviceMemory
+constexpr vk::DeviceSize DEDICATED_IMAGE_FRACTION = 2;
+
+const char* categoryName(GpuMemoryCategory category) {
+    switch (category) {
+        case GpuMemoryCategory::Buffer:
+            return "buffers";
+        case GpuMemoryCategory::Staging:
+            return "staging";
+        case GpuMemoryCategory::AccelerationStructure:
+            return "acceleration structures";
+        case GpuMemoryCategory::Image:
+            return "images";
+        default:
+            return "?";
+    }
+}
+
+double toMiB(vk::DeviceSize bytes) { return double(bytes) / double(1 << 20); }
+}  // namespace
+
+GpuAllocation& GpuAllocation::operator=(GpuAllocation&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+    owner        = std::exchange(other.owner, nullptr);
+    block        = std::exchange(other.block, nullptr);
+    id           = std::exchange(other.id, TlsfAllocator::INVALID);
+    category     = other.category;
+    deviceMemory = std::exchange(other.deviceMemory, nullptr);
+    memoryOffset = std::exchange(other.memoryOffset, 0);
+    memorySize   = std::exchange(other.memorySize, 0);
+    mapped       = std::exchange(other.mapped, nullptr);
+    return *this;
+}
+
+void* GpuAllocation::mapMemory(vk::DeviceSize offset, vk::DeviceSize size) const {
+    if (!mapped) throw std::runtime_error("GpuAllocation: memory is not host visible");
+    if (offset + size > memorySize && size != vk::WholeSize) throw std::runtime_error("GpuAllocation: map range out of bounds");
+    return mapped + offset;
+}
+
+void GpuAllocation::release() {
+    if (owner) owner->free(*this);
+    owner = nullptr;
+}
+
+void GpuAllocator::init(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& logicalDevice, bool bufferDeviceAddress) {
+    device           = &logicalDevice;
+    memoryProperties = physicalDevice.getMemoryProperties();
+    deviceAddress    = bufferDeviceAddress;
+    pools.clear();
+    pools.resize(size_t(memoryProperties.memoryTypeCount) * 2);
+    for (uint32_t i = 0; i < pools.size(); i++) {
+        pools[i].memoryType = i / 2;
+        pools[i].optimal    = (i & 1) != 0;
+    }
+    // small heaps (e.g. the 256 MiB BAR window) get smaller blocks so one block cannot exhaust them
+    for (uint32_t h = 0; h < memoryProperties.memoryHeapCount; h++) {
+        blockSizes[h] = std::min(DEFAULT_BLOCK_SIZE, memoryProperties.memoryHeaps[h].size / 8);
+    }
+}
+
+uint32_t GpuAllocator::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+GpuAllocation GpuAllocator::allocateBuffer(const vk::raii::Buffer& buffer,
+                                           vk::MemoryPropertyFlags properties,
+                                           GpuMemoryCategory category,
+                                           vk::DeviceSize minAlignment) {
+    vk::MemoryRequirements requirements = buffer.getMemoryRequirements();
+    requirements.alignment              = std::max(requirements.alignment, minAlignment);
+    GpuAllocation allocation            = allocate(requirements, properties, false, category, false, nullptr);
+    buffer.bindMemory(allocation.memory(), allocation.offset());
+    return allocation;
+}
+
+GpuAllocation GpuAllocator::allocateImage(const vk::raii::Image& image, vk::MemoryPropertyFlags properties, vk::ImageTiling tiling) {
+    auto requirements = device->getImageMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        vk::ImageMemoryRequirementsInfo2{.image = *image});
+    const vk::MemoryRequirements& memoryRequirements = requirements.get<vk::MemoryRequirements2>().memoryRequirements;
+    const vk::MemoryDedicatedRequirements& dedicated = requirements.get<vk::MemoryDedicatedRequirements>();
+
+    uint32_t memoryType      = findMemoryType(memoryRequirements.memoryTypeBits, properties);
+    vk::DeviceSize blockSize = blockSizes[memoryProperties.memoryTypes[memoryType].heapIndex];
+    bool useDedicated        = dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation ||
+                        memoryRequirements.size >= blockSize / DEDICATED_IMAGE_FRACTION;
+    vk::MemoryDedicatedAllocateInfo dedicatedInfo{.image = *image};
+
+    GpuAllocation allocation = allocate(memoryRequirements,
+                                        properties,
+                                        tiling == vk::ImageTiling::eOptimal,
+                                        GpuMemoryCategory::Image,
+                                        useDedicated,
+                                        useDedicated ? &dedicatedInfo : nullptr);
+    image.bindMemory(allocation.memory(), allocation.offset());
+    return allocation;
+}
+
+GpuAllocator::Block& GpuAllocator::createBlock(uint32_t pool,
+                                               vk::DeviceSize size,
+                                               bool dedicated,
+                                               const vk::MemoryDedicatedAllocateInfo* dedicatedInfo) {
+    const uint32_t memoryType = pools[pool].memoryType;
+    vk::MemoryAllocateInfo allocInfo{.allocationSize = size, .memoryTypeIndex = memoryType};
+    vk::MemoryAllocateFlagsInfo allocFlagsInfo{.flags = vk::MemoryAllocateFlagBits::eDeviceAddress};
+    if (dedicatedInfo) {
+        allocInfo.pNext = dedicatedInfo;
+    } else if (deviceAddress && !pools[pool].optimal) {
+        // any buffer placed in this block may ask for its device address
+        allocInfo.pNext = &allocFlagsInfo;
+    }
+
+    auto block       = std::make_unique<Block>();
+    block->memory    = vk::raii::DeviceMemory(*device, allocInfo);
+    block->pool      = pool;
+    block->dedicated = dedicated;
+    block->tlsf.reset(size);
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+        block->mapped = static_cast<uint8_t*>(block->memory.mapMemory(0, size));
+    }
+    pools[pool].blocks.push_back(std::move(block));
+    return *pools[pool].blocks.back();
+}
+
+GpuAllocation GpuAllocator::allocate(const vk::MemoryRequirements& requirements,
+                                     vk::MemoryPropertyFlags properties,
+                                     bool optimal,
+                                     GpuMemoryCategory category,
+                                     bool dedicated,
+                                     const vk::MemoryDedicatedAllocateInfo* dedicatedInfo) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const uint32_t memoryType      = findMemoryType(requirements.memoryTypeBits, properties);
+    const uint32_t pool            = memoryType * 2 + (optimal ? 1 : 0);
+    const vk::DeviceSize blockSize = blockSizes[memoryProperties.memoryTypes[memoryType].heapIndex];
+
+    Block* target = nullptr;
+    TlsfAllocator::Allocation range;
+    if (dedicated) {
+        target = &createBlock(pool, requirements.size, true, dedicatedInfo);
+        range  = target->tlsf.allocate(requirements.size, 1);
+    } else {
+        for (auto& block : pools[pool].blocks) {
+            if (block->dedicated) continue;
+            range = block->tlsf.allocate(requirements.size, requirements.alignment);
+            if (range.valid()) {
+                target = block.get();
+                break;
+            }
+        }
+        if (!target) {
+            // oversized requests get a block of their own size (plus alignment slack), rounded to 1 MiB
+            vk::DeviceSize fit  = requirements.size + requirements.alignment + (1 << 20) - 1;
+            vk::DeviceSize size = std::max(blockSize, fit & ~vk::DeviceSize((1 << 20) - 1));
+            target              = &createBlock(pool, size, false, nullptr);
+            range               = target->tlsf.allocate(requirements.size, requirements.alignment);
+        }
+    }
+    if (!range.valid()) throw std::runtime_error("GpuAllocator: allocation does not fit a new block");
+
+    GpuAllocation allocation;
+    allocation.owner        = this;
+    allocation.block        = target;
+    allocation.id           = range.id;
+    allocation.category     = category;
+    allocation.deviceMemory = *target->memory;
+    allocation.memoryOffset = range.offset;
+    allocation.memorySize   = requirements.size;
+    allocation.mapped       = target->mapped ? target->mapped + range.offset : nullptr;
+    categoryBytes[size_t(category)] += requirements.size;
+    return allocation;
+}
+
+void GpuAllocator::free(GpuAllocation& allocation) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Block* block = static_cast<Block*>(allocation.block);
+    block->tlsf.free(allocation.id);
+    categoryBytes[size_t(allocation.category)] -= allocation.memorySize;
+    if (!block->tlsf.empty()) return;
+
+    // release empty blocks, but keep one regular block per pool around to avoid reallocating every frame
+    auto& blocks                   = pools[block->pool].blocks;
+    const vk::DeviceSize blockSize = blockSizes[memoryProperties.memoryTypes[pools[block->pool].memoryType].heapIndex];
+    const bool regular             = !block->dedicated && block->tlsf.capacity() == blockSize;
+    const bool otherEmptyBlock     = std::any_of(blocks.begin(), blocks.end(), [&](const auto& other) {
+        return other.get() != block && !other->dedicated && other->tlsf.empty();
+    });
+    if (regular && !otherEmptyBlock) return;
+    blocks.erase(std::find_if(blocks.begin(), blocks.end(), [&](const auto& other) { return other.get() == block; }));
+}
+
+void GpuAllocator::printStats(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t blockCount = 0, dedicatedCount = 0, allocationCount = 0;
+    vk::DeviceSize blockBytes = 0, dedicatedBytes = 0;
+    for (const Pool& pool : pools) {
+        for (const auto& block : pool.blocks) {
+            (block->dedicated ? dedicatedCount : blockCount)++;
+            (block->dedicated ? dedicatedBytes : blockBytes) += block->tlsf.capacity();
+            allocationCount += block->tlsf.stats().allocationCount;
+        }
+    }
+    out << "[Info] GPU memory: " << allocationCount << " allocations in " << blockCount << " blocks (" << toMiB(blockBytes) << " MiB) + "
+        << dedicatedCount << " dedicated (" << toMiB(dedicatedBytes) << " MiB)" << std::endl;
+
+    for (const Pool& pool : pools) {
+        uint32_t blocks = 0, freeRanges = 0;
+        vk::DeviceSize capacity = 0, used = 0, freeBytes = 0, largestFree = 0;
+        for (const auto& block : pool.blocks) {
+            if (block->dedicated) continue;
+            TlsfAllocator::Stats stats = block->tlsf.stats();
+            blocks++;
+            capacity += stats.capacity;
+            used += stats.usedBytes;
+            freeBytes += stats.freeBytes;
+            freeRanges += stats.freeBlockCount;
+            largestFree = std::max(largestFree, stats.largestFreeBlock);
+        }
+        if (blocks == 0) continue;
+        float fragmentation = freeBytes ? 1.0f - float(largestFree) / float(freeBytes) : 0.0f;
+        out << "[Info]   memory type " << pool.memoryType << " (" << vk::to_string(memoryProperties.memoryTypes[pool.memoryType].propertyFlags)
+            << ") " << (pool.optimal ? "optimal" : "linear") << ": " << blocks << " blocks, " << toMiB(used) << " / " << toMiB(capacity)
+            << " MiB used, " << freeRanges << " free ranges, fragmentation " << fragmentation << std::endl;
+    }
+
+    out << "[Info]  ";
+    for (size_t c = 0; c < categoryBytes.size(); c++) {
+        out << " " << categoryName(GpuMemoryCategory(c)) << " " << toMiB(categoryBytes[c]) << " MiB" << (c + 1 < categoryBytes.size() ? "," : "");
+    }
+    out << std::endl;
+}
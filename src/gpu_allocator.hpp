@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "tlsf_allocator.hpp"
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULES)
+#include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+// what an allocation is used for, only for the stats
+enum class GpuMemoryCategory : uint32_t { Buffer, Staging, AccelerationStructure, Image, Count };
+
+class GpuAllocator;
+
+/**
+ * @brief a range of a vk::DeviceMemory block handed out by GpuAllocator, returned on destruction
+ *
+ * Stands in for vk::raii::DeviceMemory in resource structs: host-visible blocks are mapped once when
+ * they are created, so mapMemory() is just a pointer offset and unmapMemory() does nothing.
+ */
+class GpuAllocation {
+   public:
+    GpuAllocation() = default;
+    GpuAllocation(std::nullptr_t) {}
+    ~GpuAllocation() { release(); }
+    GpuAllocation(const GpuAllocation&)            = delete;
+    GpuAllocation& operator=(const GpuAllocation&) = delete;
+    GpuAllocation(GpuAllocation&& other) noexcept { *this = std::move(other); }
+    GpuAllocation& operator=(GpuAllocation&& other) noexcept;
+
+    vk::DeviceMemory memory() const { return deviceMemory; }
+    vk::DeviceSize offset() const { return memoryOffset; }
+    vk::DeviceSize size() const { return memorySize; }
+    explicit operator bool() const { return owner != nullptr; }
+
+    // pointer to [offset, offset + size) of this allocation; throws if the memory is not host visible
+    void* mapMemory(vk::DeviceSize offset, vk::DeviceSize size) const;
+    void unmapMemory() const {}
+
+   private:
+    friend class GpuAllocator;
+    void release();
+
+    GpuAllocator* owner           = nullptr;
+    void* block                   = nullptr;  // GpuAllocator::Block
+    uint32_t id                   = TlsfAllocator::INVALID;
+    GpuMemoryCategory category    = GpuMemoryCategory::Buffer;
+    vk::DeviceMemory deviceMemory = nullptr;
+    vk::DeviceSize memoryOffset   = 0;
+    vk::DeviceSize memorySize     = 0;
+    uint8_t* mapped               = nullptr;
+};
+
+/**
+ * @brief sub-allocates buffers and images from large vk::DeviceMemory blocks
+ *
+ * One pool per memory type and resource kind: linear resources (buffers, linear images) and optimal
+ * images never share a block, which keeps bufferImageGranularity out of the picture. Each block is
+ * managed by a TlsfAllocator. Only large images (or ones the driver asks for) get a dedicated allocation;
+ * a buffer larger than the block size gets a block of its own size that is released once empty.
+ */
+class GpuAllocator {
+   public:
+    static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+    GpuAllocator()                               = default;
+    GpuAllocator(const GpuAllocator&)            = delete;
+    GpuAllocator& operator=(const GpuAllocator&) = delete;
+
+    // bufferDeviceAddress: allocate linear blocks with eDeviceAddress so any buffer in them can use it
+    void init(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, bool bufferDeviceAddress);
+
+    // allocate memory for a buffer / image and bind it; minAlignment raises the buffer's own alignment requirement
+    GpuAllocation allocateBuffer(const vk::raii::Buffer& buffer,
+                                 vk::MemoryPropertyFlags properties,
+                                 GpuMemoryCategory category,
+                                 vk::DeviceSize minAlignment = 1);
+    GpuAllocation allocateImage(const vk::raii::Image& image, vk::MemoryPropertyFlags properties, vk::ImageTiling tiling);
+
+    void printStats(std::ostream& out) const;
+
+   private:
+    friend class GpuAllocation;
+
+    struct Block {
+        vk::raii::DeviceMemory memory = nullptr;
+        uint8_t* mapped               = nullptr;
+        TlsfAllocator tlsf;
+        uint32_t pool  = 0;
+        bool dedicated = false;
+    };
+    struct Pool {
+        std::vector<std::unique_ptr<Block>> blocks;
+        uint32_t memoryType = 0;
+        bool optimal        = false;
+    };
+
+    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+    GpuAllocation allocate(const vk::MemoryRequirements& requirements,
+                           vk::MemoryPropertyFlags properties,
+                           bool optimal,
+                           GpuMemoryCategory category,
+                           bool dedicated,
+                           const vk::MemoryDedicatedAllocateInfo* dedicatedInfo);
+    Block& createBlock(uint32_t pool, vk::DeviceSize size, bool dedicated, const vk::MemoryDedicatedAllocateInfo* dedicatedInfo);
+    void free(GpuAllocation& allocation);
+
+    const vk::raii::Device* device = nullptr;
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+    std::array<vk::DeviceSize, VK_MAX_MEMORY_HEAPS> blockSizes{};
+    bool deviceAddress = false;
+    std::vector<Pool> pools;  // [memoryType * 2 + optimal]
+    std::array<vk::DeviceSize, size_t(GpuMemoryCategory::Count)> categoryBytes{};
+    mutable std::mutex mutex;
+};
@@ -4,7 +4,7 @@
 /*create light buffer and move it to SSBO for compute shaders*/
 
 void HelloTriangleApplication::createLightBuffer() {
-    lights.resize(100);
+    lights.resize(LIGHT_COUNT);
 
     std::default_random_engine rndEngine(std::random_device{}());
 
@@ -16,25 +16,134 @@ void HelloTriangleApplication::createLightBuffer() {
 
     std::uniform_real_distribution<float> colorDist(0.5f, 1.0f);
 
-    for (auto& light : lights) {
-        light.position = glm::vec4(posDistXY(rndEngine),  // X
-                                   posDistXY(rndEngine),  // Y
-                                   posDistZ(rndEngine),   // Z (Height)
-                                   1.0f);
-        light.color    = glm::vec4(colorDist(rndEngine), colorDist(rndEngine), colorDist(rndEngine), 0.0f);
+    // cubed uniforms (mean 1/4) give a few bright lights among many dim ones; the scale keeps the total for any LIGHT_COUNT
+    std::uniform_real_distribution<float> intensityDist(0.0f, 1.0f);
+    const float intensityScale = 4.0f / static_cast<float>(lights.size());
+
+    // orbit speed in radians per second (either direction) and color pulse rate, both per light
+    std::uniform_real_distribution<float> speedDist(-1.5f, 1.5f);
+    std::uniform_real_distribution<float> phaseDist(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> pulseDist(0.5f, 3.0f);
+
+    lightMotion.resize(lights.size());
+    for (size_t i = 0; i < lights.size(); i++) {
+        float u                  = intensityDist(rndEngine);
+        lightMotion.centerX[i]   = posDistXY(rndEngine);  // X
+        lightMotion.centerY[i]   = posDistXY(rndEngine);  // Y
+        lightMotion.centerZ[i]   = posDistZ(rndEngine);   // Z (Height)
+        lightMotion.radius[i]    = ANIMATE_LIGHTS ? LIGHT_ORBIT_RADIUS : 0.0f;
+        lightMotion.red[i]       = colorDist(rndEngine);
+        lightMotion.green[i]     = colorDist(rndEngine);
+        lightMotion.blue[i]      = colorDist(rndEngine);
+        lightMotion.intensity[i] = intensityScale * 4.0f * u * u * u;
+        lightMotion.speed[i]     = speedDist(rndEngine);
+        lightMotion.phase[i]     = phaseDist(rndEngine);
+        lightMotion.pulse[i]     = pulseDist(rndEngine);
+    }
+    animateLights(0.0f);
+
+    // one buffer per frame in flight: a frame's host writes never touch lights the other frame may still be reading
+    lightBuffers.clear();
+    lightBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    lightMotionBuffers.clear();
+    lightMotionBuffers.resize(GPU_LIGHT_ANIMATION ? MAX_FRAMES_IN_FLIGHT : 0);
+    for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+        BufferResource& lightBuffer = lightBuffers[f];
+        lightBuffer.size            = sizeof(Light) * std::max<size_t>(1, lights.size());
+        createBuffer(lightBuffer.size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     lightBuffer.buffer,
+                     lightBuffer.memory);
+        /*zero copy*/
+        lightBuffer.mapped = lightBuffer.memory.mapMemory(0, lightBuffer.size);
+        memcpy(lightBuffer.mapped, lights.data(), sizeof(Light) * lights.size());
+
+        if (!GPU_LIGHT_ANIMATION) continue;
+        BufferResource& motionBuffer = lightMotionBuffers[f];
+        motionBuffer.size            = sizeof(LightMotion) * std::max<size_t>(1, lights.size());
+        createBuffer(motionBuffer.size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     motionBuffer.buffer,
+                     motionBuffer.memory);
+        motionBuffer.mapped = motionBuffer.memory.mapMemory(0, motionBuffer.size);
+        auto* motions       = static_cast<LightMotion*>(motionBuffer.mapped);
+        for (size_t i = 0; i < lights.size(); i++) motions[i] = lightMotion.motion(i);
     }
-    // create buffer
-    lightBufferResource.size = sizeof(Light) * lights.size();
+    lightDirty.resize(lights.size());
+    lightMotionDirty.resize(lights.size());
+    std::cout << "[Info] Light Buffer created with APU Optimization (" << lights.size() << " lights, "
+              << (ANIMATE_LIGHTS ? (GPU_LIGHT_ANIMATION ? "animated on the GPU" : "animated on the CPU") : "static") << ")" << std::endl;
 
-    createBuffer(lightBufferResource.size,
+    createLightAliasTable();
+    createLightTree();
+}
+
+/**
+ * @brief alias table over the light power (luminance * intensity), uploaded next to the light buffer
+ *
+ * restir.slang picks a light in O(1) from it and divides by the pdf stored in the picked entry.
+ */
+void HelloTriangleApplication::createLightAliasTable() {
+    std::vector<float> power(lights.size());
+    for (size_t i = 0; i < lights.size(); i++) power[i] = lightTreeLight(static_cast<uint32_t>(i)).power;
+    AliasTableStats stats;
+    std::vector<AliasEntry> table = buildAliasTable(power, &stats);
+
+    lightAliasBufferResource.size = sizeof(AliasEntry) * std::max<size_t>(1, table.size());
+    createBuffer(lightAliasBufferResource.size,
                  vk::BufferUsageFlagBits::eStorageBuffer,
                  vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                 lightBufferResource.buffer,
-                 lightBufferResource.memory);
-
-    /*zero copy*/
-    void* data = lightBufferResource.memory.mapMemory(0, lightBufferResource.size);
-    memcpy(data, lights.data(), static_cast<size_t>(lightBufferResource.size));
-    lightBufferResource.memory.unmapMemory();
-    std::cout << "[Info] Light Buffer created with APU Optimization (" << lights.size() << " lights)" << std::endl;
-}
\ No newline at end of file
+                 lightAliasBufferResource.buffer,
+                 lightAliasBufferResource.memory);
+    void* data = lightAliasBufferResource.memory.mapMemory(0, lightAliasBufferResource.size);
+    memcpy(data, table.data(), table.size() * sizeof(AliasEntry));
+    lightAliasBufferResource.memory.unmapMemory();
+    std::cout << "[Info] Light alias table: " << table.size() << " entries, total power " << stats.totalWeight << ", built in "
+              << stats.buildMs << " ms" << (stats.uniform ? " (all lights dark, sampling uniformly)" : "") << std::endl;
+}
+/**
+ * @brief light tree over the same power as the alias table, one copy per frame in flight
+ *
+ * restir.slang walks it from the root, picking a child by its importance for the shading point, so lights
+ * behind the surface or far away are rarely drawn. Each leaf bounds its light's whole orbit, so animation
+ * never touches the tree; moveLight() and setLightColor() refit it and queue the touched nodes.
+ */
+void HelloTriangleApplication::createLightTree() {
+    lightTreeLights.resize(lights.size());
+    for (size_t i = 0; i < lights.size(); i++) lightTreeLights[i] = lightTreeLight(static_cast<uint32_t>(i));
+    lightTree.build(lightTreeLights);
+    const std::vector<LightTreeNode>& nodes = lightTree.nodes();
+
+    lightTreeBuffers.clear();
+    lightTreeBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (BufferResource& treeBuffer : lightTreeBuffers) {
+        treeBuffer.size = sizeof(LightTreeNode) * std::max<size_t>(1, nodes.size());
+        createBuffer(treeBuffer.size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     treeBuffer.buffer,
+                     treeBuffer.memory);
+        treeBuffer.mapped = treeBuffer.memory.mapMemory(0, treeBuffer.size);
+        memcpy(treeBuffer.mapped, nodes.data(), nodes.size() * sizeof(LightTreeNode));
+    }
+    lightTreeDirty.resize(nodes.size());
+    std::cout << "[Info] Light tree: " << nodes.size() << " nodes, depth " << lightTree.stats().depth << ", built in " << lightTree.stats().buildMs
+              << " ms" << std::endl;
+}
+
+/**
+ * @brief what the light tree and the alias table know about a light: its orbit and its base power
+ *
+ * The color pulse only dims a light (factor 0.5 to 1), so the base power is an upper bound.
+ */
+LightTreeLight HelloTriangleApplication::lightTreeLight(uint32_t index) const {
+    const LightMotionStreams& m = lightMotion;
+    float luminance             = 0.2126f * m.red[index] + 0.7152f * m.green[index] + 0.0722f * m.blue[index];
+    return LightTreeLight{.position = glm::vec3(m.centerX[index], m.centerY[index], m.centerZ[index]),
+                          .power    = luminance * m.intensity[index],
+                          .axis     = glm::vec3(0.0f, 0.0f, 1.0f),
+                          .cosTheta = -1.0f,  // point lights emit in every direction
+                          .radius   = m.radius[index]};
+}
@@ -0,0 +1,175 @@
+#include "parallel.hpp"
+#include "tutorial.hpp"
+
+/*
+light animation (ANIMATE_LIGHTS): every light circles its center on a tilted orbit and pulses its color.
+The lights, their light tree and (on the GPU path) their motion parameters live in one persistently mapped
+buffer per frame in flight. Changes are tracked per element in FrameDirtyRanges and written into the frame's
+own copy when that frame is recorded, so the CPU never writes a buffer the GPU may still be reading and only
+the changed ranges are touched. Small light counts are animated on the CPU (one contiguous range per frame);
+from LIGHT_GPU_ANIMATION_THRESHOLD lights on, light_animation.slang writes the lights instead and the CPU
+only uploads edited motion parameters.
+*/
+
+namespace {
+// lights evaluated per CPU task
+constexpr size_t LIGHT_ANIMATION_CHUNK = 4096;
+
+// copies [begin, end) ranges of src into a persistently mapped buffer of the same element layout
+template <typename T>
+void writeRanges(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, const T* src, void* mapped) {
+    for (auto [begin, end] : ranges) memcpy(static_cast<T*>(mapped) + begin, src + begin, sizeof(T) * (end - begin));
+}
+}  // namespace
+
+void HelloTriangleApplication::createLightAnimationPipeline() {
+    if (!GPU_LIGHT_ANIMATION) return;
+
+    // Binding 0: motion parameters, 1: this frame's lights (output)
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings;
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i] = vk::DescriptorSetLayoutBinding{.binding         = i,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .descriptorCount = 1,
+                                                     .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    }
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
+    lightAnimationSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::PushConstantRange pushConstantRange{
+        .stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(LightAnimationPushConstants)};
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+        .setLayoutCount = 1, .pSetLayouts = &*lightAnimationSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
+    lightAnimationPipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+
+    vk::raii::ShaderModule shaderModule = createShaderModule(readFile("shaders/light_animation.spv"));
+    vk::PipelineShaderStageCreateInfo stageInfo{.stage = vk::ShaderStageFlagBits::eCompute, .module = shaderModule, .pName = "main"};
+    vk::ComputePipelineCreateInfo pipelineInfo{.stage = stageInfo, .layout = lightAnimationPipelineLayout};
+    lightAnimationPipeline = vk::raii::Pipeline(device, nullptr, pipelineInfo);
+}
+
+void HelloTriangleApplication::createLightAnimationDescriptorSets() {
+    if (!GPU_LIGHT_ANIMATION) return;
+
+    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *lightAnimationSetLayout);
+    vk::DescriptorSetAllocateInfo allocInfo{
+        .descriptorPool = descriptorPool, .descriptorSetCount = static_cast<uint32_t>(layouts.size()), .pSetLayouts = layouts.data()};
+    lightAnimationDescriptorSets = device.allocateDescriptorSets(allocInfo);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        std::array<vk::DescriptorBufferInfo, 2> bufferInfos{
+            vk::DescriptorBufferInfo{.buffer = *lightMotionBuffers[i].buffer, .offset = 0, .range = lightMotionBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *lightBuffers[i].buffer, .offset = 0, .range = lightBuffers[i].size}};
+        std::array<vk::WriteDescriptorSet, 2> descriptorWrites;
+        for (uint32_t b = 0; b < descriptorWrites.size(); b++) {
+            descriptorWrites[b] = vk::WriteDescriptorSet{.dstSet          = *lightAnimationDescriptorSets[i],
+                                                         .dstBinding      = b,
+                                                         .dstArrayElement = 0,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                         .pBufferInfo     = &bufferInfos[b]};
+        }
+        device.updateDescriptorSets(descriptorWrites, {});
+    }
+}
+
+/**
+ * @brief evaluate every light at time into lights, one stream per parameter (light_animation.slang does the same)
+ */
+void HelloTriangleApplication::animateLights(float time) {
+    const LightMotionStreams& m = lightMotion;
+    parallelFor(
+        lights.size(),
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                // tilted orbit: the offset never leaves the radius the light tree bounds the light with
+                float angle = m.speed[i] * time + m.phase[i];
+                float r     = m.radius[i];
+                float pulse = 0.75f + 0.25f * std::sin(m.pulse[i] * time + m.phase[i]);
+                glm::vec3 offset(0.8f * r * std::cos(angle), 0.8f * r * std::sin(angle), 0.6f * r * std::sin(2.0f * angle));
+                lights[i].position = glm::vec4(m.centerX[i] + offset.x, m.centerY[i] + offset.y, m.centerZ[i] + offset.z, m.intensity[i]);
+                lights[i].color    = glm::vec4(m.red[i] * pulse, m.green[i] * pulse, m.blue[i] * pulse, 0.0f);
+            }
+        },
+        LIGHT_ANIMATION_CHUNK);
+}
+
+/**
+ * @brief bring this frame's lights and light tree up to date, recorded before anything reads them
+ *
+ * Host writes go straight into the frame's mapped buffers and are visible to the submit, so only the GPU
+ * animation needs a barrier (its writes against the ReSTIR pass's reads).
+ */
+void HelloTriangleApplication::updateLights(const vk::raii::CommandBuffer& cmd) {
+    if (ANIMATE_LIGHTS && !GPU_LIGHT_ANIMATION) {
+        animateLights(animationTime);
+        lightDirty.markAll();
+    }
+    writeRanges(lightDirty.take(currentFrame), lights.data(), lightBuffers[currentFrame].mapped);
+    writeRanges(lightTreeDirty.take(currentFrame), lightTree.nodes().data(), lightTreeBuffers[currentFrame].mapped);
+    if (!GPU_LIGHT_ANIMATION) return;
+
+    auto* motions = static_cast<LightMotion*>(lightMotionBuffers[currentFrame].mapped);
+    for (auto [begin, end] : lightMotionDirty.take(currentFrame)) {
+        for (uint32_t i = begin; i < end; i++) motions[i] = lightMotion.motion(i);
+    }
+    LightAnimationPushConstants constants{.time = animationTime, .lightCount = static_cast<uint32_t>(lights.size())};
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *lightAnimationPipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *lightAnimationPipelineLayout, 0, *lightAnimationDescriptorSets[currentFrame], nullptr);
+    cmd.pushConstants<LightAnimationPushConstants>(*lightAnimationPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+    cmd.dispatch((constants.lightCount + 63) / 64, 1, 1);
+
+    vk::MemoryBarrier2 lightBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                    .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                                    .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                    .dstAccessMask = vk::AccessFlagBits2::eShaderRead};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &lightBarrier});
+}
+
+/**
+ * @brief move a light's orbit center; the light tree refits the nodes above it
+ *
+ * Lights are plain host data until the next updateLights() of each frame writes the dirty ranges.
+ */
+void HelloTriangleApplication::moveLight(uint32_t index, const glm::vec3& center) {
+    lightMotion.centerX[index] = center.x;
+    lightMotion.centerY[index] = center.y;
+    lightMotion.centerZ[index] = center.z;
+    if (!ANIMATE_LIGHTS) {
+        lights[index].position = glm::vec4(center, lights[index].position.w);
+        lightDirty.mark(index);
+    }
+    if (GPU_LIGHT_ANIMATION) lightMotionDirty.mark(index);
+
+    lightTreeLights[index] = lightTreeLight(index);
+    std::vector<uint32_t> touched;
+    uint32_t changed[] = {index};
+    if (lightTree.update(lightTreeLights, changed, &touched)) {
+        lightTreeDirty.markAll();
+    } else {
+        for (uint32_t node : touched) lightTreeDirty.mark(node);
+    }
+}
+
+/**
+ * @brief change a light's base color and intensity; the tree refits its power, the alias table keeps the
+ *  power it was built with (its pdfs stay exact, only the importance gets worse)
+ */
+void HelloTriangleApplication::setLightColor(uint32_t index, const glm::vec3& color, float intensity) {
+    lightMotion.red[index]       = color.r;
+    lightMotion.green[index]     = color.g;
+    lightMotion.blue[index]      = color.b;
+    lightMotion.intensity[index] = intensity;
+    if (!ANIMATE_LIGHTS) {
+        lights[index].position.w = intensity;
+        lights[index].color      = glm::vec4(color, 0.0f);
+        lightDirty.mark(index);
+    }
+    if (GPU_LIGHT_ANIMATION) lightMotionDirty.mark(index);
+
+    lightTreeLights[index] = lightTreeLight(index);
+    std::vector<uint32_t> touched;
+    uint32_t changed[] = {index};
+    lightTree.refit(lightTreeLights, changed, &touched);
+    for (uint32_t node : touched) lightTreeDirty.mark(node);
+}
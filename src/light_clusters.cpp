@@ -0,0 +1,188 @@
+#include <cmath>
+
+#include "tutorial.hpp"
+
+/*
+clustered light culling: cluster_cull.slang runs one workgroup per CLUSTER_TILE_SIZE pixel tile after the G-buffer
+pass. Each pixel falls into one of CLUSTER_SLICES exponential slices of its distance to the camera, and every slice
+of a tile is bounded by the box around its pixels' world positions, so empty space never collects lights. Lights
+whose influence sphere (LIGHT_INFLUENCE_CUTOFF) touches a box are appended to one compact index list per frame;
+each cluster keeps its (offset, count) range. restir.slang looks up its pixel's cluster the same way and only ever
+visits those lights.
+*/
+
+void HelloTriangleApplication::createClusterCullPipeline() {
+    // Binding 0: G-buffer position, 1: lights, 2: cluster ranges, 3: cluster light indices, 4: index counter
+    std::array<vk::DescriptorSetLayoutBinding, 5> bindings;
+    bindings[0] = vk::DescriptorSetLayoutBinding{.binding         = 0,
+                                                 .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                                                 .descriptorCount = 1,
+                                                 .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    for (uint32_t i = 1; i < bindings.size(); i++) {
+        bindings[i] = vk::DescriptorSetLayoutBinding{.binding         = i,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .descriptorCount = 1,
+                                                     .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    }
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
+    clusterCullSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::PushConstantRange pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(ClusterCullPushConstants)};
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+        .setLayoutCount = 1, .pSetLayouts = &*clusterCullSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
+    clusterCullPipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+
+    vk::raii::ShaderModule shaderModule = createShaderModule(readFile("shaders/cluster_cull.spv"));
+    vk::PipelineShaderStageCreateInfo stageInfo{.stage = vk::ShaderStageFlagBits::eCompute, .module = shaderModule, .pName = "main"};
+    vk::ComputePipelineCreateInfo pipelineInfo{.stage = stageInfo, .layout = clusterCullPipelineLayout};
+    clusterCullPipeline = vk::raii::Pipeline(device, nullptr, pipelineInfo);
+}
+
+/**
+ * @brief per frame cluster ranges for the current swapchain extent, index lists and counters
+ *
+ * Called again by recreateSwapChain(), the grid follows the extent.
+ */
+void HelloTriangleApplication::createClusterResources() {
+    ClusterGrid grid      = clusterGrid();
+    uint32_t clusterCount = grid.size.x * grid.size.y * grid.size.z;
+
+    clusterRangeBuffers.clear();
+    clusterIndexBuffers.clear();
+    clusterCounterBuffers.clear();
+    clusterRangeBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    clusterIndexBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    clusterCounterBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+        clusterRangeBuffers[f].size = sizeof(glm::uvec2) * clusterCount;
+        createBuffer(clusterRangeBuffers[f].size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     clusterRangeBuffers[f].buffer,
+                     clusterRangeBuffers[f].memory);
+        clusterIndexBuffers[f].size = sizeof(uint32_t) * CLUSTER_INDEX_CAPACITY;
+        createBuffer(clusterIndexBuffers[f].size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     clusterIndexBuffers[f].buffer,
+                     clusterIndexBuffers[f].memory);
+        // reset with fillBuffer before every cull, read back through the mapping once the frame's fence signalled
+        clusterCounterBuffers[f].size = sizeof(uint32_t);
+        createBuffer(clusterCounterBuffers[f].size,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     clusterCounterBuffers[f].buffer,
+                     clusterCounterBuffers[f].memory);
+        clusterCounterBuffers[f].mapped = clusterCounterBuffers[f].memory.mapMemory(0, clusterCounterBuffers[f].size);
+    }
+    clusterResultsPending.fill(false);
+    clusterStats = ClusterStats{.clusters = clusterCount};
+
+    if (clusterTimestampQueries.empty() && physicalDevice.getQueueFamilyProperties()[queueIndex].timestampValidBits != 0) {
+        for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+            clusterTimestampQueries.emplace_back(device, vk::QueryPoolCreateInfo{.queryType = vk::QueryType::eTimestamp, .queryCount = 2});
+        }
+    }
+}
+
+/**
+ * @brief allocated once, rewritten whenever the G-buffer or the cluster buffers were recreated
+ */
+void HelloTriangleApplication::createClusterDescriptorSets() {
+    if (clusterCullDescriptorSets.empty()) {
+        std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *clusterCullSetLayout);
+        vk::DescriptorSetAllocateInfo allocInfo{
+            .descriptorPool = descriptorPool, .descriptorSetCount = static_cast<uint32_t>(layouts.size()), .pSetLayouts = layouts.data()};
+        clusterCullDescriptorSets = device.allocateDescriptorSets(allocInfo);
+    }
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        vk::DescriptorImageInfo posInfo{.sampler     = *viking_room.textureSampler,
+                                        .imageView   = *gBufferPositionImageView[i],
+                                        .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+        std::array<vk::DescriptorBufferInfo, 4> bufferInfos{
+            vk::DescriptorBufferInfo{.buffer = *lightBuffers[i].buffer, .offset = 0, .range = lightBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *clusterRangeBuffers[i].buffer, .offset = 0, .range = clusterRangeBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *clusterIndexBuffers[i].buffer, .offset = 0, .range = clusterIndexBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *clusterCounterBuffers[i].buffer, .offset = 0, .range = clusterCounterBuffers[i].size}};
+
+        std::array<vk::WriteDescriptorSet, 5> descriptorWrites;
+        descriptorWrites[0] = vk::WriteDescriptorSet{.dstSet          = *clusterCullDescriptorSets[i],
+                                                     .dstBinding      = 0,
+                                                     .dstArrayElement = 0,
+                                                     .descriptorCount = 1,
+                                                     .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                                                     .pImageInfo      = &posInfo};
+        for (uint32_t b = 1; b < descriptorWrites.size(); b++) {
+            descriptorWrites[b] = vk::WriteDescriptorSet{.dstSet          = *clusterCullDescriptorSets[i],
+                                                         .dstBinding      = b,
+                                                         .dstArrayElement = 0,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                         .pBufferInfo     = &bufferInfos[b - 1]};
+        }
+        device.updateDescriptorSets(descriptorWrites, {});
+    }
+}
+
+ClusterGrid HelloTriangleApplication::clusterGrid() const {
+    return ClusterGrid{.cameraPosition = glm::vec4(camera.pos, CLUSTER_NEAR),
+                       .params         = glm::vec4(float(CLUSTER_SLICES) / std::log(CLUSTER_FAR / CLUSTER_NEAR), LIGHT_INFLUENCE_CUTOFF, 0.0f, 0.0f),
+                       .size           = glm::uvec4((swapChainExtent.width + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE,
+                                          (swapChainExtent.height + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE,
+                                          CLUSTER_SLICES,
+                                          CLUSTER_INDEX_CAPACITY)};
+}
+
+/**
+ * @brief cull this frame's lights into its clusters, recorded once the G-buffer is readable
+ *
+ * The index count and GPU time of the frame's previous cull are read first, its fence has signalled by now.
+ */
+void HelloTriangleApplication::recordLightCulling(const vk::raii::CommandBuffer& cmd) {
+    bool timestamps = !clusterTimestampQueries.empty() && tlasTimestampMask != 0;
+    if (clusterResultsPending[currentFrame]) {
+        uint32_t used           = *static_cast<const uint32_t*>(clusterCounterBuffers[currentFrame].mapped);
+        clusterStats.indices    = std::min(used, CLUSTER_INDEX_CAPACITY);
+        clusterStats.overflowed = used > CLUSTER_INDEX_CAPACITY;
+        if (timestamps) {
+            auto [result, ticks] = clusterTimestampQueries[currentFrame].getResults<uint64_t>(
+                0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+            if (result == vk::Result::eSuccess) clusterStats.gpuMs = double((ticks[1] - ticks[0]) & tlasTimestampMask) * tlasTimestampPeriod * 1e-6;
+        }
+        clusterResultsPending[currentFrame] = false;
+    }
+    if (timestamps) {
+        cmd.resetQueryPool(*clusterTimestampQueries[currentFrame], 0, 2);
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *clusterTimestampQueries[currentFrame], 0);
+    }
+
+    cmd.fillBuffer(*clusterCounterBuffers[currentFrame].buffer, 0, sizeof(uint32_t), 0);
+    vk::MemoryBarrier2 resetBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eClear,
+                                    .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                                    .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                    .dstAccessMask = vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &resetBarrier});
+
+    ClusterCullPushConstants constants{.clusters = clusterGrid(), .lightCount = static_cast<uint32_t>(lights.size())};
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *clusterCullPipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *clusterCullPipelineLayout, 0, *clusterCullDescriptorSets[currentFrame], nullptr);
+    cmd.pushConstants<ClusterCullPushConstants>(*clusterCullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+    cmd.dispatch(constants.clusters.size.x, constants.clusters.size.y, 1);
+
+    // the ReSTIR pass reads the ranges and lists, the host reads the counter after the fence
+    vk::MemoryBarrier2 cullBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                   .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                                   .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eHost,
+                                   .dstAccessMask = vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eHostRead};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &cullBarrier});
+    if (timestamps) cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eComputeShader, *clusterTimestampQueries[currentFrame], 1);
+    clusterResultsPending[currentFrame] = true;
+}
+
+void HelloTriangleApplication::printClusterStats() const {
+    std::cout << "[Info] Light clusters: " << clusterStats.clusters << " clusters (" << CLUSTER_TILE_SIZE << " px tiles x " << CLUSTER_SLICES
+              << " slices), " << clusterStats.indices << " light indices"
+              << (clusterStats.overflowed ? " (index list full, clusters cut short)" : "") << ", cull " << clusterStats.gpuMs << " ms GPU"
+              << std::endl;
+}
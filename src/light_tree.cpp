@@ -0,0 +1,326 @@
+#include "light_tree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#include "parallel.hpp"
+
+namespace {
+constexpr float PI = 3.14159265358979f;
+
+// subtrees over fewer lights than this are built on the thread that reached them
+constexpr size_t PARALLEL_SUBTREE_LIGHTS = 16384;
+
+float sanitizedPower(float p) { return std::isfinite(p) && p > 0.0f ? p : 0.0f; }
+
+// spread the low 10 bits of v so there are two zero bits between each of them
+uint32_t expandBits(uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+uint32_t mortonCode(const glm::vec3& unit) {
+    glm::vec3 q = glm::clamp(unit * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+    return (expandBits(uint32_t(q.x)) << 2) | (expandBits(uint32_t(q.y)) << 1) | expandBits(uint32_t(q.z));
+}
+
+/**
+ * @brief smallest cone around both cones (Conty Estevez & Kulla 2018, Alg. 1), cosTheta -1 is the full sphere
+ */
+void unionCone(const glm::vec3& axisA, float cosA, const glm::vec3& axisB, float cosB, glm::vec3& axis, float& cosTheta) {
+    if (cosA <= -1.0f || cosB <= -1.0f) {
+        axis     = glm::vec3(0.0f, 0.0f, 1.0f);
+        cosTheta = -1.0f;
+        return;
+    }
+    glm::vec3 a  = axisA;
+    glm::vec3 b  = axisB;
+    float thetaA = std::acos(std::clamp(cosA, -1.0f, 1.0f));
+    float thetaB = std::acos(std::clamp(cosB, -1.0f, 1.0f));
+    if (thetaB > thetaA) {
+        std::swap(a, b);
+        std::swap(thetaA, thetaB);
+    }
+    float cosD   = std::clamp(glm::dot(a, b), -1.0f, 1.0f);
+    float thetaD = std::acos(cosD);
+    if (std::min(thetaD + thetaB, PI) <= thetaA) {
+        axis     = a;
+        cosTheta = std::cos(thetaA);
+        return;
+    }
+    float thetaO       = 0.5f * (thetaA + thetaD + thetaB);
+    glm::vec3 ortho    = b - a * cosD;
+    float orthoLength2 = glm::dot(ortho, ortho);
+    if (thetaO >= PI || orthoLength2 <= 1e-12f) {
+        axis     = glm::vec3(0.0f, 0.0f, 1.0f);
+        cosTheta = -1.0f;
+        return;
+    }
+    // rotate a towards b until the new cone touches the far side of both
+    float thetaR = thetaO - thetaA;
+    axis         = a * std::cos(thetaR) + ortho * (std::sin(thetaR) / std::sqrt(orthoLength2));
+    cosTheta     = std::cos(thetaO);
+}
+
+LightTreeNode leafNode(const LightTreeLight& light, uint32_t lightIndex) {
+    float axisLength = glm::length(light.axis);
+    bool omni        = light.cosTheta <= -1.0f || !(axisLength > 0.0f);
+    glm::vec3 extent = glm::vec3(std::max(light.radius, 0.0f));
+    return LightTreeNode{.boundsMin    = light.position - extent,
+                         .power        = sanitizedPower(light.power),
+                         .boundsMax    = light.position + extent,
+                         .childOrLight = LIGHT_TREE_LEAF | lightIndex,
+                         .axis         = omni ? glm::vec3(0.0f, 0.0f, 1.0f) : light.axis / axisLength,
+                         .cosTheta     = omni ? -1.0f : std::min(light.cosTheta, 1.0f)};
+}
+
+// bounds, power and cone of an internal node from its two children; the child link stays as it is
+void aggregateNode(LightTreeNode& node, const LightTreeNode& left, const LightTreeNode& right) {
+    // a dark child is never picked, so it must not widen the bounds or the cone the importance is estimated from
+    if (left.power <= 0.0f || right.power <= 0.0f) {
+        const LightTreeNode& lit = right.power > 0.0f ? right : left;
+        node.boundsMin           = lit.boundsMin;
+        node.boundsMax           = lit.boundsMax;
+        node.power               = left.power + right.power;
+        node.axis                = lit.axis;
+        node.cosTheta            = lit.cosTheta;
+        return;
+    }
+    node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+    node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+    node.power     = left.power + right.power;
+    unionCone(left.axis, left.cosTheta, right.axis, right.cosTheta, node.axis, node.cosTheta);
+}
+
+// last index of the left half of [first, last]: the last code that still agrees with codes[first] on the highest differing bit
+size_t findSplit(const std::vector<uint64_t>& keys, size_t first, size_t last) {
+    uint32_t firstCode = uint32_t(keys[first] >> 32);
+    uint32_t lastCode  = uint32_t(keys[last] >> 32);
+    // equal codes (coincident lights) split in the middle, which keeps the tree balanced
+    if (firstCode == lastCode) return (first + last) / 2;
+
+    int commonPrefix = std::countl_zero(firstCode ^ lastCode);
+    size_t split     = first;
+    size_t step      = last - first;
+    do {
+        step             = (step + 1) / 2;
+        size_t candidate = split + step;
+        if (candidate < last && std::countl_zero(firstCode ^ uint32_t(keys[candidate] >> 32)) > commonPrefix) split = candidate;
+    } while (step > 1);
+    return split;
+}
+
+struct BuildContext {
+    std::span<const LightTreeLight> lights;
+    const std::vector<uint64_t>& keys;  // morton code << 32 | light index, sorted
+    std::vector<LightTreeNode>& nodes;
+    std::vector<uint32_t>& parents;
+    std::vector<uint32_t>& leafOfLight;
+};
+
+/**
+ * @brief build the subtree over sorted lights [first, last] into nodes[nodeIndex, nodeIndex + 2 * count - 1)
+ *
+ * @return depth of the subtree
+ */
+uint32_t buildSubtree(BuildContext& context, size_t first, size_t last, uint32_t nodeIndex, uint32_t parent, uint32_t spawnLevels) {
+    context.parents[nodeIndex] = parent;
+    if (first == last) {
+        uint32_t lightIndex             = uint32_t(context.keys[first]);
+        context.nodes[nodeIndex]        = leafNode(context.lights[lightIndex], lightIndex);
+        context.leafOfLight[lightIndex] = nodeIndex;
+        return 1;
+    }
+    size_t split        = findSplit(context.keys, first, last);
+    uint32_t leftIndex  = nodeIndex + 1;
+    uint32_t rightIndex = nodeIndex + uint32_t(2 * (split - first + 1));
+    context.nodes[nodeIndex].childOrLight = rightIndex;
+
+    uint32_t leftDepth  = 0;
+    uint32_t rightDepth = 0;
+    if (spawnLevels > 0 && last - first + 1 >= PARALLEL_SUBTREE_LIGHTS) {
+        std::thread leftThread([&] { leftDepth = buildSubtree(context, first, split, leftIndex, nodeIndex, spawnLevels - 1); });
+        rightDepth = buildSubtree(context, split + 1, last, rightIndex, nodeIndex, spawnLevels - 1);
+        leftThread.join();
+    } else {
+        leftDepth  = buildSubtree(context, first, split, leftIndex, nodeIndex, 0);
+        rightDepth = buildSubtree(context, split + 1, last, rightIndex, nodeIndex, 0);
+    }
+    aggregateNode(context.nodes[nodeIndex], context.nodes[leftIndex], context.nodes[rightIndex]);
+    return 1 + std::max(leftDepth, rightDepth);
+}
+}  // namespace
+
+void LightTree::build(std::span<const LightTreeLight> lights) {
+    auto start     = std::chrono::steady_clock::now();
+    const size_t n = lights.size();
+    nodeArray.clear();
+    parents.clear();
+    leafOfLight.assign(n, 0);
+    changedSinceBuild = 0;
+    treeStats         = LightTreeStats{.rebuilt = true};
+    if (n == 0) return;
+
+    // bounds of the light positions, per chunk and then merged
+    const size_t chunkCount = std::min(workerCount(), (n + 65535) / 65536);
+    std::vector<glm::vec3> chunkMin(std::max<size_t>(1, chunkCount), glm::vec3(std::numeric_limits<float>::max()));
+    std::vector<glm::vec3> chunkMax(chunkMin.size(), glm::vec3(-std::numeric_limits<float>::max()));
+    parallelForChunks(n, chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            chunkMin[chunk] = glm::min(chunkMin[chunk], lights[i].position);
+            chunkMax[chunk] = glm::max(chunkMax[chunk], lights[i].position);
+        }
+    });
+    glm::vec3 sceneMin = chunkMin[0];
+    glm::vec3 sceneMax = chunkMax[0];
+    for (size_t c = 1; c < chunkMin.size(); c++) {
+        sceneMin = glm::min(sceneMin, chunkMin[c]);
+        sceneMax = glm::max(sceneMax, chunkMax[c]);
+    }
+    glm::vec3 extent = glm::max(sceneMax - sceneMin, glm::vec3(1e-6f));
+
+    // morton code in the high word, light index in the low one: sorting the keys sorts the lights
+    std::vector<uint64_t> keys(n);
+    parallelFor(n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) keys[i] = uint64_t(mortonCode((lights[i].position - sceneMin) / extent)) << 32 | uint64_t(i);
+    });
+
+    // LSD radix sort over the 30 code bits, 3 passes of 10; stable, so equal codes keep index order
+    std::vector<uint64_t> sorted(n);
+    for (uint32_t shift = 32; shift < 62; shift += 10) {
+        std::array<size_t, 1024> offsets{};
+        for (uint64_t key : keys) offsets[(key >> shift) & 1023]++;
+        size_t sum = 0;
+        for (size_t& offset : offsets) {
+            size_t count = offset;
+            offset       = sum;
+            sum += count;
+        }
+        for (uint64_t key : keys) sorted[offsets[(key >> shift) & 1023]++] = key;
+        keys.swap(sorted);
+    }
+
+    nodeArray.resize(2 * n - 1);
+    parents.resize(2 * n - 1);
+    uint32_t spawnLevels = 0;
+    while ((size_t(1) << spawnLevels) < workerCount()) spawnLevels++;
+    BuildContext context{lights, keys, nodeArray, parents, leafOfLight};
+    treeStats.depth   = buildSubtree(context, 0, n - 1, 0, 0, spawnLevels);
+    treeStats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LightTree::refit(std::span<const LightTreeLight> lights, std::span<const uint32_t> changed, std::vector<uint32_t>* touchedNodes) {
+    treeStats.rebuilt    = false;
+    treeStats.refitNodes = 0;
+    if (touchedNodes) touchedNodes->clear();
+    if (nodeArray.empty() || lights.size() != leafOfLight.size()) return;
+
+    // every ancestor of a changed leaf once; the walk stops at the first node another leaf already marked
+    std::vector<uint8_t> marked(nodeArray.size(), 0);
+    std::vector<uint32_t> dirty;
+    for (uint32_t lightIndex : changed) {
+        if (lightIndex >= lights.size()) continue;
+        uint32_t node   = leafOfLight[lightIndex];
+        nodeArray[node] = leafNode(lights[lightIndex], lightIndex);
+        if (!marked[node]) {
+            marked[node] = 1;
+            dirty.push_back(node);
+        }
+        while (node != 0) {
+            node = parents[node];
+            if (marked[node]) break;
+            marked[node] = 1;
+            dirty.push_back(node);
+        }
+    }
+    changedSinceBuild += changed.size();
+
+    // depth-first order puts every child after its parent, so recomputing from the back sees finished children
+    std::sort(dirty.begin(), dirty.end(), std::greater<uint32_t>());
+    for (uint32_t node : dirty) {
+        LightTreeNode& entry = nodeArray[node];
+        if (entry.childOrLight & LIGHT_TREE_LEAF) continue;
+        aggregateNode(entry, nodeArray[node + 1], nodeArray[entry.childOrLight]);
+    }
+    treeStats.refitNodes = static_cast<uint32_t>(dirty.size());
+    if (touchedNodes) *touchedNodes = std::move(dirty);
+}
+
+bool LightTree::update(std::span<const LightTreeLight> lights,
+                       std::span<const uint32_t> changed,
+                       std::vector<uint32_t>* touchedNodes,
+                       float rebuildFraction) {
+    // refitted bounds grow as lights wander away from their Morton neighbours, which blunts the importance estimate
+    bool rebuild = lights.size() != leafOfLight.size() || float(changedSinceBuild + changed.size()) > rebuildFraction * float(lights.size());
+    if (!rebuild) {
+        refit(lights, changed, touchedNodes);
+        return false;
+    }
+    build(lights);
+    if (touchedNodes) {
+        touchedNodes->resize(nodeArray.size());
+        for (size_t i = 0; i < nodeArray.size(); i++) (*touchedNodes)[i] = static_cast<uint32_t>(i);
+    }
+    return true;
+}
+
+std::vector<double> LightTree::lightProbabilities(const glm::vec3& position, const glm::vec3& normal) const {
+    std::vector<double> probabilities(leafOfLight.size(), 0.0);
+    if (nodeArray.empty()) return probabilities;
+
+    std::vector<std::pair<uint32_t, double>> stack{{0u, 1.0}};
+    while (!stack.empty()) {
+        auto [node, probability] = stack.back();
+        stack.pop_back();
+        const LightTreeNode& entry = nodeArray[node];
+        if (entry.childOrLight & LIGHT_TREE_LEAF) {
+            probabilities[entry.childOrLight & ~LIGHT_TREE_LEAF] += probability;
+            continue;
+        }
+        double left  = lightTreeImportance(nodeArray[node + 1], position, normal);
+        double right = lightTreeImportance(nodeArray[entry.childOrLight], position, normal);
+        if (left + right <= 0.0) continue;
+        stack.push_back({node + 1, probability * left / (left + right)});
+        stack.push_back({entry.childOrLight, probability * right / (left + right)});
+    }
+    return probabilities;
+}
+
+float lightTreeImportance(const LightTreeNode& node, const glm::vec3& position, const glm::vec3& normal) {
+    if (!(node.power > 0.0f)) return 0.0f;
+    glm::vec3 center   = 0.5f * (node.boundsMin + node.boundsMax);
+    glm::vec3 toCenter = center - position;
+    float radius       = 0.5f * glm::length(node.boundsMax - node.boundsMin);
+    float distance2    = glm::dot(toCenter, toCenter);
+    // the shading point is inside the bounds: no useful angle bounds, distance clamped to the bounds' size
+    if (distance2 <= radius * radius) return node.power / std::max(radius * radius, 1e-8f);
+
+    float distance = std::sqrt(distance2);
+    glm::vec3 dir  = toCenter / distance;
+    float sinBox   = radius / distance;
+    float cosBox   = std::sqrt(std::max(0.0f, 1.0f - sinBox * sinBox));
+
+    // receiver: cos of the smallest angle between the normal and any direction into the bounds
+    float cosI        = glm::dot(normal, dir);
+    float sinI        = std::sqrt(std::max(0.0f, 1.0f - cosI * cosI));
+    float cosReceiver = cosI >= cosBox ? 1.0f : cosI * cosBox + sinI * sinBox;
+    if (cosReceiver <= 0.0f) return 0.0f;
+
+    // emitter: the cone, widened by its own half angle and the bounds' angular radius, has to face the point
+    float cosEmitter = 1.0f;
+    if (node.cosTheta > -1.0f) {
+        float theta      = std::acos(std::clamp(-glm::dot(node.axis, dir), -1.0f, 1.0f));
+        float thetaPrime = std::max(0.0f, theta - std::acos(std::clamp(node.cosTheta, -1.0f, 1.0f)) - std::asin(std::min(sinBox, 1.0f)));
+        if (thetaPrime >= 0.5f * PI) return 0.0f;
+        cosEmitter = std::cos(thetaPrime);
+    }
+    return node.power * cosReceiver * cosEmitter / std::max(distance2, 1e-8f);
+}
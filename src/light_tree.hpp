@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// a light as the tree sees it
+struct LightTreeLight {
+    glm::vec3 position;
+    float power;     // luminance * intensity, same weight as the alias table
+    glm::vec3 axis;  // emission cone, ignored when cosTheta <= -1
+    float cosTheta;  // -1 for omnidirectional (point) lights
+    float radius;    // the light stays within this distance of position (animated lights), its leaf bounds the sphere
+};
+
+constexpr uint32_t LIGHT_TREE_LEAF = 0x80000000u;
+
+/**
+ * @brief one node of the flattened tree, depth first: the left child of an internal node is the next node
+ *
+ * Layout matches LightTreeNode in restir.slang (std430, 48 bytes).
+ */
+struct LightTreeNode {
+    glm::vec3 boundsMin;
+    float power;  // sum over the lights below
+    glm::vec3 boundsMax;
+    uint32_t childOrLight;  // internal: index of the right child; leaf: LIGHT_TREE_LEAF | light index
+    glm::vec3 axis;         // cone around every emission direction below
+    float cosTheta;
+};
+static_assert(sizeof(LightTreeNode) == 48, "std430 layout of LightTreeNode in restir.slang");
+
+struct LightTreeStats {
+    uint32_t depth      = 0;
+    double buildMs      = 0.0;
+    uint32_t refitNodes = 0;  // nodes recomputed by the last refit
+    bool rebuilt        = false;
+};
+
+/**
+ * @brief light BVH for many-light sampling (Conty Estevez & Kulla 2018), built as a Morton-sorted LBVH
+ *
+ * Lights are sorted by the 30-bit Morton code of their position (radix sort) and split top-down at the
+ * highest differing code bit, one light per leaf. A subtree over k lights always has 2k - 1 nodes, so
+ * both halves know where they go in the depth-first array and the upper levels build in parallel.
+ * Every node holds the bounds, power and emission cone of its lights; the shader walks down picking a
+ * child by an importance estimate relative to the shading point, the pdf is the product of the picks.
+ *
+ * No Vulkan types, so the builder can be exercised on the CPU alone.
+ */
+class LightTree {
+   public:
+    void build(std::span<const LightTreeLight> lights);
+    /**
+     * @brief the lights listed in changed moved or changed power: recompute them and every node above them
+     *
+     * Topology stays as built, so the cost is O(changed * depth). touchedNodes receives the recomputed nodes.
+     */
+    void refit(std::span<const LightTreeLight> lights, std::span<const uint32_t> changed, std::vector<uint32_t>* touchedNodes = nullptr);
+    /**
+     * @brief refit, or rebuild once more than rebuildFraction of the lights changed since the last build
+     *
+     * @return true if the tree was rebuilt (every node changed)
+     */
+    bool update(std::span<const LightTreeLight> lights,
+                std::span<const uint32_t> changed,
+                std::vector<uint32_t>* touchedNodes = nullptr,
+                float rebuildFraction              = 0.125f);
+
+    const std::vector<LightTreeNode>& nodes() const { return nodeArray; }
+    const LightTreeStats& stats() const { return treeStats; }
+
+    /**
+     * @brief probability that the shader-side traversal picks every light at a shading point, for checking
+     *  the pdfs on the CPU (the same importance as restir.slang)
+     */
+    std::vector<double> lightProbabilities(const glm::vec3& position, const glm::vec3& normal) const;
+
+   private:
+    std::vector<LightTreeNode> nodeArray;
+    std::vector<uint32_t> parents;      // per node, root points at itself
+    std::vector<uint32_t> leafOfLight;  // node index of every light's leaf
+    size_t changedSinceBuild = 0;
+    LightTreeStats treeStats;
+};
+
+/**
+ * @brief importance of a node for a shading point: power over squared distance, times bounds on the
+ *  receiver cosine and the emission cone. Zero only if no light below can reach the point's hemisphere.
+ */
+float lightTreeImportance(const LightTreeNode& node, const glm::vec3& position, const glm::vec3& normal);
@@ -0,0 +1,365 @@
+#include "tutorial.hpp"
+
+#include <tiny_gltf.h>
+
+#include <cctype>
+#include <functional>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+/**
+ * @brief first byte of an accessor inside its buffer, after checking the whole range is in bounds
+ */
+const uint8_t* accessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor, size_t& stride) {
+    if (accessor.bufferView < 0 || accessor.sparse.isSparse) {
+        throw std::runtime_error("glTF: sparse accessors and accessors without buffer view are not supported");
+    }
+    const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+    const tinygltf::Buffer& buffer   = model.buffers[view.buffer];
+    int byteStride                   = accessor.ByteStride(view);
+    if (byteStride <= 0) {
+        throw std::runtime_error("glTF: invalid accessor stride");
+    }
+    stride = static_cast<size_t>(byteStride);
+
+    size_t elementSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(accessor.componentType)) *
+                         static_cast<size_t>(tinygltf::GetNumComponentsInType(accessor.type));
+    size_t begin = view.byteOffset + accessor.byteOffset;
+    size_t end   = accessor.count ? begin + (accessor.count - 1) * stride + elementSize : begin;
+    if (end > view.byteOffset + view.byteLength || view.byteOffset + view.byteLength > buffer.data.size()) {
+        throw std::runtime_error("glTF: accessor reads past the end of its buffer");
+    }
+    return buffer.data.data() + begin;
+}
+
+float readComponent(const uint8_t* p, int componentType, bool normalized) {
+    switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+            float v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return normalized ? *p / 255.0f : float(*p);
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+            return normalized ? std::max(int8_t(*p) / 127.0f, -1.0f) : float(int8_t(*p));
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t v;
+            memcpy(&v, p, sizeof(v));
+            return normalized ? v / 65535.0f : float(v);
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT: {
+            int16_t v;
+            memcpy(&v, p, sizeof(v));
+            return normalized ? std::max(v / 32767.0f, -1.0f) : float(v);
+        }
+        default:
+            throw std::runtime_error("glTF: unsupported vertex attribute component type");
+    }
+}
+
+/**
+ * @brief copy `components` floats per vertex from an accessor into one field of the interleaved vertex layout
+ *
+ * @param dst first vertex's field, advanced by sizeof(Vertex) per vertex
+ */
+void copyAttribute(const tinygltf::Model& model, const tinygltf::Accessor& accessor, uint8_t* dst, uint32_t components) {
+    size_t stride;
+    const uint8_t* src        = accessorData(model, accessor, stride);
+    const uint32_t available  = static_cast<uint32_t>(tinygltf::GetNumComponentsInType(accessor.type));
+    const uint32_t copyCount  = std::min(components, available);
+    const size_t componentSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(accessor.componentType));
+
+    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
+        // the common case: plain floats, one small memcpy per vertex
+        for (size_t i = 0; i < accessor.count; i++) {
+            memcpy(dst + i * sizeof(Vertex), src + i * stride, copyCount * sizeof(float));
+        }
+        return;
+    }
+    for (size_t i = 0; i < accessor.count; i++) {
+        float values[4];
+        for (uint32_t c = 0; c < copyCount; c++) {
+            values[c] = readComponent(src + i * stride + c * componentSize, accessor.componentType, accessor.normalized);
+        }
+        memcpy(dst + i * sizeof(Vertex), values, copyCount * sizeof(float));
+    }
+}
+
+const tinygltf::Accessor* findAttribute(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const char* name) {
+    auto it = primitive.attributes.find(name);
+    return it == primitive.attributes.end() ? nullptr : &model.accessors[it->second];
+}
+
+/**
+ * @brief a primitive can be uploaded with one memcpy if its buffer view is already an array of Vertex:
+ * interleaved with stride sizeof(Vertex), float POSITION/COLOR_0/TEXCOORD_0/NORMAL at the Vertex field offsets
+ * and no material color to apply on top
+ */
+const uint8_t* matchingInterleavedView(const tinygltf::Model& model, const tinygltf::Primitive& primitive, glm::vec3 baseColor) {
+    if (baseColor != glm::vec3(1.0f)) return nullptr;
+    struct Field {
+        const char* name;
+        size_t offset;
+        int type;
+    };
+    const Field fields[] = {{"POSITION", offsetof(Vertex, pos), TINYGLTF_TYPE_VEC3},
+                            {"COLOR_0", offsetof(Vertex, color), TINYGLTF_TYPE_VEC3},
+                            {"TEXCOORD_0", offsetof(Vertex, texCoord), TINYGLTF_TYPE_VEC2},
+                            {"NORMAL", offsetof(Vertex, normal), TINYGLTF_TYPE_VEC3}};
+    const uint8_t* base = nullptr;
+    int view            = -1;
+    size_t count        = 0;
+    for (const Field& field : fields) {
+        const tinygltf::Accessor* accessor = findAttribute(model, primitive, field.name);
+        if (!accessor || accessor->componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor->type != field.type) return nullptr;
+        size_t stride;
+        const uint8_t* data = accessorData(model, *accessor, stride);
+        if (stride != sizeof(Vertex)) return nullptr;
+        if (view == -1) {
+            view  = accessor->bufferView;
+            count = accessor->count;
+            base  = data - field.offset;
+        } else if (accessor->bufferView != view || accessor->count != count || data - field.offset != base) {
+            return nullptr;
+        }
+    }
+    // POSITION sits at offset 0, so base is its (bounds-checked) data and NORMAL's check covers the last vertex
+    return base;
+}
+
+glm::mat4 nodeLocalMatrix(const tinygltf::Node& node) {
+    if (node.matrix.size() == 16) {
+        return glm::mat4(glm::make_mat4(node.matrix.data()));
+    }
+    glm::mat4 t(1.0f), r(1.0f), s(1.0f);
+    if (node.translation.size() == 3) {
+        t = glm::translate(glm::mat4(1.0f), glm::vec3(glm::make_vec3(node.translation.data())));
+    }
+    if (node.rotation.size() == 4) {
+        // glTF stores quaternions as (x, y, z, w)
+        glm::quat q(float(node.rotation[3]), float(node.rotation[0]), float(node.rotation[1]), float(node.rotation[2]));
+        r = glm::mat4_cast(q);
+    }
+    if (node.scale.size() == 3) {
+        s = glm::scale(glm::mat4(1.0f), glm::vec3(glm::make_vec3(node.scale.data())));
+    }
+    return t * r * s;
+}
+
+// case-insensitive extension check, ext in lower case
+bool hasExtension(const std::string& path, const char* ext) {
+    size_t n = strlen(ext);
+    auto sameChar = [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; };
+    return path.size() >= n && std::equal(path.end() - n, path.end(), ext, sameChar);
+}
+}  // namespace
+
+/**
+ * @brief true for .gltf and .glb files
+ */
+bool HelloTriangleApplication::isGltfPath(const std::string& path) { return hasExtension(path, ".gltf") || hasExtension(path, ".glb"); }
+
+/**
+ * @brief Load a glTF 2.0 scene with tinygltf
+ *
+ * Only the layout is decided here: every triangle primitive gets a range in the shared vertex and
+ * index buffers, and every node instance of a mesh becomes a SubMesh carrying the node's world
+ * transform. The attribute data itself is copied by createVertexBuffer()/createIndexBuffer()
+ * directly from the glTF buffers into the staging memory (see writeGltfVertices/writeGltfIndices).
+ */
+void HelloTriangleApplication::loadGltfModel(const std::string& path) {
+    auto model = std::make_shared<tinygltf::Model>();
+    tinygltf::TinyGLTF loader;
+    // geometry only: skip image decoding, textures are not consumed by the renderer
+    loader.SetImageLoader([](tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*) { return true; },
+                          nullptr);
+    std::string warn, err;
+    bool ok = hasExtension(path, ".glb") ? loader.LoadBinaryFromFile(model.get(), &err, &warn, path)
+                                         : loader.LoadASCIIFromFile(model.get(), &err, &warn, path);
+    if (!warn.empty()) {
+        std::cerr << "[Warning] glTF: " << warn << std::endl;
+    }
+    if (!ok) {
+        throw std::runtime_error("failed to load glTF " + path + ": " + err);
+    }
+
+    // 1. one vertex/index range per triangle primitive
+    std::vector<std::vector<int>> primitiveRange(model->meshes.size());  // [mesh][primitive] -> gltfPrimitives index
+    gltfPrimitives.clear();
+    gltfVertexCount = 0;
+    gltfIndexCount  = 0;
+    for (size_t m = 0; m < model->meshes.size(); m++) {
+        const tinygltf::Mesh& mesh = model->meshes[m];
+        primitiveRange[m].assign(mesh.primitives.size(), -1);
+        for (size_t p = 0; p < mesh.primitives.size(); p++) {
+            const tinygltf::Primitive& primitive = mesh.primitives[p];
+            const tinygltf::Accessor* position   = findAttribute(*model, primitive, "POSITION");
+            if (primitive.mode != TINYGLTF_MODE_TRIANGLES || !position || primitive.indices < 0) {
+                std::cerr << "[Warning] glTF: skipping primitive " << p << " of mesh '" << mesh.name << "' (needs indexed triangles)" << std::endl;
+                continue;
+            }
+            glm::vec3 baseColor(1.0f);
+            if (primitive.material >= 0) {
+                const auto& factor = model->materials[primitive.material].pbrMetallicRoughness.baseColorFactor;
+                baseColor          = glm::vec3(factor[0], factor[1], factor[2]);
+            }
+            GltfPrimitiveRange range{.mesh        = static_cast<int>(m),
+                                     .primitive   = static_cast<int>(p),
+                                     .firstVertex = gltfVertexCount,
+                                     .vertexCount = static_cast<uint32_t>(position->count),
+                                     .firstIndex  = gltfIndexCount,
+                                     .indexCount  = static_cast<uint32_t>(model->accessors[primitive.indices].count),
+                                     .baseColor   = baseColor};
+            primitiveRange[m][p] = static_cast<int>(gltfPrimitives.size());
+            gltfPrimitives.push_back(range);
+            gltfVertexCount += range.vertexCount;
+            gltfIndexCount += range.indexCount;
+        }
+    }
+
+    // 2. walk the default scene, every (node, primitive) pair becomes a SubMesh
+    std::function<void(int, const glm::mat4&)> visit = [&](int nodeIndex, const glm::mat4& parent) {
+        const tinygltf::Node& node = model->nodes[nodeIndex];
+        glm::mat4 world            = parent * nodeLocalMatrix(node);
+        if (node.mesh >= 0) {
+            const tinygltf::Mesh& mesh = model->meshes[node.mesh];
+            for (size_t p = 0; p < mesh.primitives.size(); p++) {
+                int rangeIndex = primitiveRange[node.mesh][p];
+                if (rangeIndex < 0) continue;
+                const GltfPrimitiveRange& range      = gltfPrimitives[rangeIndex];
+                const tinygltf::Primitive& primitive = mesh.primitives[p];
+
+                SubMesh submesh{};
+                submesh.indexOffset   = range.firstIndex;
+                submesh.indexCount    = range.indexCount;
+                submesh.maxVertex     = range.vertexCount - 1;
+                submesh.vertexOffset  = static_cast<int32_t>(range.firstVertex);
+                submesh.materialIndex = primitive.material;
+                submesh.alphaCut      = primitive.material >= 0 && model->materials[primitive.material].alphaMode == "MASK";
+                submesh.transform     = world;
+                submeshes.push_back(submesh);
+            }
+        }
+        for (int child : node.children) visit(child, world);
+    };
+    if (!model->scenes.empty()) {
+        const tinygltf::Scene& scene = model->scenes[model->defaultScene >= 0 ? model->defaultScene : 0];
+        for (int root : scene.nodes) visit(root, glm::mat4(1.0f));
+    } else {
+        // no scene graph: place every mesh once at the origin
+        for (size_t m = 0; m < model->meshes.size(); m++) {
+            tinygltf::Node node;
+            node.mesh = static_cast<int>(m);
+            model->nodes.push_back(node);
+            visit(static_cast<int>(model->nodes.size() - 1), glm::mat4(1.0f));
+        }
+    }
+    // the AS cache key: every byte the vertex/index buffers are filled from
+    geometryHash = MESH_CACHE_VERSION;
+    for (const tinygltf::Buffer& buffer : model->buffers) {
+        geometryHash = hash64(buffer.data.data(), buffer.data.size(), geometryHash);
+    }
+    gltfModel = std::move(model);
+
+    // the Cornell box goes after the glTF data, with its own vertex offset
+    appendCornellBox(gltfVertexCount, gltfIndexCount);
+    vertexView = vertices;
+    indexView  = indices;
+    std::cout << "[Info] loadGltfModel: " << gltfPrimitives.size() << " primitives, " << submeshes.size() - 1 << " instances, "
+              << gltfVertexCount << " vertices, " << gltfIndexCount << " indices" << std::endl;
+}
+
+/**
+ * @brief write all glTF primitives into the interleaved vertex layout
+ *
+ * @param dst start of the vertex buffer staging memory (gltfVertexCount * sizeof(Vertex) bytes)
+ */
+void HelloTriangleApplication::writeGltfVertices(uint8_t* dst) const {
+    const tinygltf::Model& model = *gltfModel;
+    for (const GltfPrimitiveRange& range : gltfPrimitives) {
+        const tinygltf::Primitive& primitive = model.meshes[range.mesh].primitives[range.primitive];
+        uint8_t* first                       = dst + size_t(range.firstVertex) * sizeof(Vertex);
+
+        // baked assets: the buffer view already is a Vertex array
+        if (const uint8_t* interleaved = matchingInterleavedView(model, primitive, range.baseColor)) {
+            memcpy(first, interleaved, size_t(range.vertexCount) * sizeof(Vertex));
+            continue;
+        }
+
+        // attributes the primitive does not provide stay zero (color defaults to the material color)
+        memset(first, 0, size_t(range.vertexCount) * sizeof(Vertex));
+        for (uint32_t i = 0; i < range.vertexCount; i++) {
+            memcpy(first + i * sizeof(Vertex) + offsetof(Vertex, color), &range.baseColor, sizeof(glm::vec3));
+        }
+        auto copy = [&](const char* name, size_t offset, uint32_t components) {
+            const tinygltf::Accessor* accessor = findAttribute(model, primitive, name);
+            if (!accessor) return;
+            if (accessor->count != range.vertexCount) {
+                throw std::runtime_error(std::string("glTF: attribute ") + name + " has a different vertex count than POSITION");
+            }
+            copyAttribute(model, *accessor, first + offset, components);
+        };
+        copy("POSITION", offsetof(Vertex, pos), 3);
+        copy("NORMAL", offsetof(Vertex, normal), 3);
+        copy("TEXCOORD_0", offsetof(Vertex, texCoord), 2);
+        if (findAttribute(model, primitive, "COLOR_0")) {
+            copy("COLOR_0", offsetof(Vertex, color), 3);
+            // vertex colors modulate the material color
+            if (range.baseColor != glm::vec3(1.0f)) {
+                for (uint32_t i = 0; i < range.vertexCount; i++) {
+                    glm::vec3 color;
+                    uint8_t* field = first + i * sizeof(Vertex) + offsetof(Vertex, color);
+                    memcpy(&color, field, sizeof(color));
+                    color *= range.baseColor;
+                    memcpy(field, &color, sizeof(color));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief write all glTF index buffers as uint32, local to their primitive (SubMesh::vertexOffset rebases them)
+ *
+ * @param dst start of the index buffer staging memory (gltfIndexCount indices)
+ */
+void HelloTriangleApplication::writeGltfIndices(uint32_t* dst) const {
+    const tinygltf::Model& model = *gltfModel;
+    for (const GltfPrimitiveRange& range : gltfPrimitives) {
+        const tinygltf::Primitive& primitive = model.meshes[range.mesh].primitives[range.primitive];
+        const tinygltf::Accessor& accessor   = model.accessors[primitive.indices];
+        size_t stride;
+        const uint8_t* src = accessorData(model, accessor, stride);
+        uint32_t* out      = dst + range.firstIndex;
+
+        switch (accessor.componentType) {
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+                if (stride == sizeof(uint32_t)) {
+                    memcpy(out, src, size_t(range.indexCount) * sizeof(uint32_t));  // already in the GPU format
+                } else {
+                    for (uint32_t i = 0; i < range.indexCount; i++) memcpy(&out[i], src + i * stride, sizeof(uint32_t));
+                }
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                for (uint32_t i = 0; i < range.indexCount; i++) {
+                    uint16_t v;
+                    memcpy(&v, src + i * stride, sizeof(v));
+                    out[i] = v;
+                }
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                for (uint32_t i = 0; i < range.indexCount; i++) out[i] = src[i * stride];
+                break;
+            default:
+                throw std::runtime_error("glTF: unsupported index component type");
+        }
+        // an out-of-range index would make the BLAS build read past the vertex buffer
+        for (uint32_t i = 0; i < range.indexCount; i++) {
+            if (out[i] >= range.vertexCount) {
+                throw std::runtime_error("glTF: index out of range");
+            }
+        }
+    }
+}
@@ -1,4 +1,39 @@
+#include "mesh_optimizer.hpp"
+#include "mesh_simplify.hpp"
+#include "meshlet.hpp"
+#include "parallel.hpp"
 #include "tutorial.hpp"
+#include "vertex_weld.hpp"
+
+namespace {
+// mixed into the .vkmesh source hash: bump whenever loadModel() changes what it does to the OBJ
+// (welding rules, the Cornell box, post-processing passes), so stale caches get rebuilt
+constexpr uint64_t MESH_BAKE_REVISION = 4;
+// settings that change the baked bytes are part of the key as well
+constexpr uint64_t MESH_BAKE_SEED =
+    MESH_BAKE_REVISION | (OPTIMIZE_MESHES ? 1ull << 32 : 0) | (GENERATE_MESH_LODS ? 1ull << 33 : 0) | (BUILD_MESHLETS ? 1ull << 34 : 0);
+static_assert(MESH_CACHE_MAX_LODS == MAX_MESH_LODS - 1, "the .vkmesh submesh record has to hold every simplified level");
+
+using Clock = std::chrono::steady_clock;
+double elapsedMs(Clock::time_point from, Clock::time_point to) { return std::chrono::duration<double, std::milli>(to - from).count(); }
+
+/**
+ * @brief build the vertex referenced by one OBJ index (same attributes the loader has always used)
+ */
+Vertex makeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index) {
+    Vertex vertex{};
+    // load vertex position
+    vertex.pos = {attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1], attrib.vertices[3 * index.vertex_index + 2]};
+    // load vertex normal
+    vertex.normal = {attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1], attrib.normals[3 * index.normal_index + 2]};
+    // load vertex texture coordinate
+    // vertex.texCoord = {attrib.texcoords[2 * index.texcoord_index + 0], 1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
+    vertex.texCoord = {0.0f, 0.0f};
+    vertex.color    = {0.8f, 0.8f, 0.8f};  // set default color to gray
+    return vertex;
+}
+}  // namespace
+
 /**
  * @brief Load model from file using tinyobjloader
  *
@@ -9,51 +44,65 @@ void HelloTriangleApplication::loadModel() {
     std::vector<tinyobj::material_t> materials;
     std::string warn, err;
 
+    // glTF/GLB scenes take their own path and are uploaded straight from the parsed buffers
+    if (isGltfPath(MODEL_PATH)) {
+        loadGltfModel(MODEL_PATH);
+        return;
+    }
+
+    // fast path: a baked .vkmesh for this exact OBJ
+    auto parseStart           = Clock::now();
+    const uint64_t sourceHash = hashFile(MODEL_PATH, MESH_BAKE_SEED);
+    geometryHash              = sourceHash;
+    if (sourceHash != 0 && loadMeshCache(sourceHash)) {
+        std::cout << "[Info] loadModel: mapped " << MESH_CACHE_PATH << " (" << vertexView.size() << " vertices, " << indexView.size()
+                  << " indices) in " << elapsedMs(parseStart, Clock::now()) << " ms" << std::endl;
+        return;
+    }
+
     // error check
     if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str())) {
         throw std::runtime_error(warn + err);
     }
+    auto parseEnd = Clock::now();
+    std::cout << "[Info] loadModel: parse " << elapsedMs(parseStart, parseEnd) << " ms" << std::endl;
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-    uint32_t globalIndexOffset = 0;
-
-    for (const auto& shape : shapes) {
-        uint32_t shapeStartIndex = globalIndexOffset;
-        uint32_t localMaxV       = 0;
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
-            // load vertex position
-            vertex.pos = {attrib.vertices[3 * index.vertex_index + 0],
-                          attrib.vertices[3 * index.vertex_index + 1],
-                          attrib.vertices[3 * index.vertex_index + 2]};
-            // load vertex normal
-            vertex.normal = {
-                attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1], attrib.normals[3 * index.normal_index + 2]};
-            // load vertex texture coordinate
-            // vertex.texCoord = {attrib.texcoords[2 * index.texcoord_index + 0], 1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
-            vertex.texCoord = {0.0f, 0.0f};
-            vertex.color    = {0.8f, 0.8f, 0.8f};  // set default color to gray
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
+    if (PARALLEL_MODEL_LOADING) {
+        weldShapesParallel(attrib, shapes);
+    } else {
+        weldShapesSerial(attrib, shapes);
+    }
+    std::cout << "[Info] loadModel: " << vertices.size() << " unique vertices, " << indices.size() << " indices, weld total "
+              << elapsedMs(parseEnd, Clock::now()) << " ms" << std::endl;
 
-            uint32_t currentVertexIndex = uniqueVertices[vertex];
-            indices.push_back(currentVertexIndex);
-            // update  counters
-            globalIndexOffset++;
-            localMaxV = std::max(localMaxV, currentVertexIndex);
-        }
-        // store submesh info
-        SubMesh submesh{};
-        submesh.indexOffset = shapeStartIndex;
-        submesh.indexCount  = globalIndexOffset - shapeStartIndex;
-        submesh.maxVertex   = localMaxV;
-        submeshes.push_back(submesh);
+    appendCornellBox(0, 0);
+    if (OPTIMIZE_MESHES) {
+        optimizeMeshes();
+    }
+    if (GENERATE_MESH_LODS) {
+        generateMeshLods();
     }
+    if (BUILD_MESHLETS) {
+        buildMeshlets();
+    }
+
+    vertexView          = vertices;
+    indexView           = indices;
+    meshletView         = meshlets;
+    meshletVertexView   = meshletVertices;
+    meshletTriangleView = meshletTriangles;
+    writeMeshCache(sourceHash);
+}
+
+/**
+ * @brief append the hard-coded Cornell box to vertices/indices as the last submesh
+ *
+ * @param vertexBase vertices already placed in front of the vectors in the vertex buffer (glTF path)
+ * @param indexBase  indices already placed in front of the vectors in the index buffer (glTF path)
+ */
+void HelloTriangleApplication::appendCornellBox(uint32_t vertexBase, uint32_t indexBase) {
     // Cornell Box hard encode
     uint32_t boxStartIndex   = indices.size();   // Indices
-    uint32_t boxVertexStart  = vertices.size();  // Vertex
     uint32_t tempIndexOffset = vertices.size();  // addQuad
 
     glm::vec3 white(0.9f, 0.9f, 0.9f);
@@ -73,8 +122,373 @@ void HelloTriangleApplication::loadModel() {
 
     //
     SubMesh boxMesh{};
-    boxMesh.indexOffset = boxStartIndex;
-    boxMesh.indexCount  = indices.size() - boxStartIndex;
-    boxMesh.maxVertex   = vertices.size() - 1;
+    boxMesh.indexOffset  = indexBase + boxStartIndex;
+    boxMesh.indexCount   = indices.size() - boxStartIndex;
+    boxMesh.maxVertex    = vertices.size() - 1;
+    boxMesh.vertexOffset = static_cast<int32_t>(vertexBase);
     submeshes.push_back(boxMesh);
 }
+
+/**
+ * @brief map a baked .vkmesh and point vertexView/indexView into the mapping
+ *
+ * @param sourceHash expected hash of the OBJ (and bake revision)
+ * @return false if there is no usable cache for this source
+ */
+bool HelloTriangleApplication::loadMeshCache(uint64_t sourceHash) {
+    if (!meshCache.open(MESH_CACHE_PATH, sourceHash, sizeof(Vertex))) {
+        return false;
+    }
+    vertexView          = {static_cast<const Vertex*>(meshCache.vertexData()), meshCache.vertexCount()};
+    indexView           = {meshCache.indexData(), meshCache.indexCount()};
+    meshletView         = {meshCache.meshletData(), meshCache.meshletCount()};
+    meshletVertexView   = {meshCache.meshletVertexData(), meshCache.meshletVertexCount()};
+    meshletTriangleView = {meshCache.meshletTriangleData(), meshCache.meshletTriangleBytes()};
+
+    const MeshCacheSubMesh* records = meshCache.submeshData();
+    submeshes.resize(meshCache.submeshCount());
+    for (uint32_t i = 0; i < meshCache.submeshCount(); i++) {
+        submeshes[i].indexOffset = records[i].indexOffset;
+        submeshes[i].indexCount  = records[i].indexCount;
+        submeshes[i].maxVertex   = records[i].maxVertex;
+        submeshes[i].alphaCut    = (records[i].flags & MESH_CACHE_FLAG_ALPHA_CUT) != 0;
+        submeshes[i].boundingSphere =
+            glm::vec4(records[i].boundingSphere[0], records[i].boundingSphere[1], records[i].boundingSphere[2], records[i].boundingSphere[3]);
+        submeshes[i].lodCount = records[i].lodCount + 1;
+        for (uint32_t l = 0; l < records[i].lodCount; l++) {
+            submeshes[i].lods[l] = {records[i].lods[l].indexOffset, records[i].lods[l].indexCount, records[i].lods[l].error};
+        }
+        submeshes[i].firstMeshlet = records[i].firstMeshlet;
+        submeshes[i].meshletCount = records[i].meshletCount;
+    }
+    return true;
+}
+
+/**
+ * @brief bake vertexView/indexView/submeshes into MESH_CACHE_PATH for the next launch
+ *  a cache that cannot be written only costs startup time, so failures are reported and ignored
+ */
+void HelloTriangleApplication::writeMeshCache(uint64_t sourceHash) {
+    if (sourceHash == 0) return;
+    std::vector<MeshCacheSubMesh> records(submeshes.size());
+    for (size_t i = 0; i < submeshes.size(); i++) {
+        const glm::vec4& sphere = submeshes[i].boundingSphere;
+        records[i]              = {.indexOffset    = submeshes[i].indexOffset,
+                                   .indexCount     = submeshes[i].indexCount,
+                                   .maxVertex      = submeshes[i].maxVertex,
+                                   .flags          = submeshes[i].alphaCut ? MESH_CACHE_FLAG_ALPHA_CUT : 0u,
+                                   .boundingSphere = {sphere.x, sphere.y, sphere.z, sphere.w},
+                                   .lodCount       = submeshes[i].lodCount - 1,
+                                   .lods           = {},
+                                   .firstMeshlet   = submeshes[i].firstMeshlet,
+                                   .meshletCount   = submeshes[i].meshletCount};
+        for (uint32_t l = 1; l < submeshes[i].lodCount; l++) {
+            const MeshLod& lod     = submeshes[i].lods[l - 1];
+            records[i].lods[l - 1] = {.indexOffset = lod.indexOffset, .indexCount = lod.indexCount, .error = lod.error};
+        }
+    }
+    try {
+        MeshCache::write(MESH_CACHE_PATH,
+                         sourceHash,
+                         {.vertices             = vertexView.data(),
+                          .vertexStride         = sizeof(Vertex),
+                          .vertexCount          = static_cast<uint32_t>(vertexView.size()),
+                          .indices              = indexView.data(),
+                          .indexCount           = static_cast<uint32_t>(indexView.size()),
+                          .submeshes            = records.data(),
+                          .submeshCount         = static_cast<uint32_t>(records.size()),
+                          .meshlets             = meshletView.data(),
+                          .meshletCount         = static_cast<uint32_t>(meshletView.size()),
+                          .meshletVertices      = meshletVertexView.data(),
+                          .meshletVertexCount   = static_cast<uint32_t>(meshletVertexView.size()),
+                          .meshletTriangles     = meshletTriangleView.data(),
+                          .meshletTriangleBytes = static_cast<uint32_t>(meshletTriangleView.size())});
+        std::cout << "[Info] loadModel: baked " << MESH_CACHE_PATH << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "[Warning] " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief reference welding path: one thread, one hash map lookup per index
+ */
+void HelloTriangleApplication::weldShapesSerial(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes) {
+    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    uint32_t globalIndexOffset = static_cast<uint32_t>(indices.size());
+
+    for (const auto& shape : shapes) {
+        uint32_t shapeStartIndex = globalIndexOffset;
+        uint32_t localMaxV       = 0;
+        for (const auto& index : shape.mesh.indices) {
+            Vertex vertex = makeVertex(attrib, index);
+            // try_emplace does the lookup and the insertion in one probe
+            auto [it, inserted] = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(vertices.size()));
+            if (inserted) {
+                vertices.push_back(vertex);
+            }
+
+            uint32_t currentVertexIndex = it->second;
+            indices.push_back(currentVertexIndex);
+            // update  counters
+            globalIndexOffset++;
+            localMaxV = std::max(localMaxV, currentVertexIndex);
+        }
+        // store submesh info
+        SubMesh submesh{};
+        submesh.indexOffset = shapeStartIndex;
+        submesh.indexCount  = globalIndexOffset - shapeStartIndex;
+        submesh.maxVertex   = localMaxV;
+        submeshes.push_back(submesh);
+    }
+}
+
+/**
+ * @brief multi-threaded welding path, produces the same vertices/indices/submeshes as weldShapesSerial
+ *
+ * 1. gather: build every referenced Vertex and its hash, in parallel over the flat index stream
+ * 2. weld:   insert all positions into a ConcurrentWeldTable, each slot keeps its first occurrence
+ * 3. number: a position that is its own first occurrence becomes a new vertex; a chunked prefix sum
+ *            hands out ids in file order, which is the order the serial path creates them in
+ * 4. scatter: write vertices, indices and per-shape maxVertex
+ */
+void HelloTriangleApplication::weldShapesParallel(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes) {
+    // flat index stream: shape s owns positions [shapeStart[s], shapeStart[s + 1])
+    std::vector<size_t> shapeStart(shapes.size() + 1, 0);
+    for (size_t s = 0; s < shapes.size(); s++) {
+        shapeStart[s + 1] = shapeStart[s] + shapes[s].mesh.indices.size();
+    }
+    const size_t total = shapeStart.back();
+    if (total >= ConcurrentWeldTable<Vertex>::EMPTY) {
+        throw std::runtime_error("model has too many indices for 32-bit welding");
+    }
+
+    // 1. gather
+    auto gatherStart = Clock::now();
+    std::vector<Vertex> flatVertices(total);
+    std::vector<uint64_t> hashes(total);
+    parallelFor(total, [&](size_t begin, size_t end) {
+        size_t s = std::upper_bound(shapeStart.begin(), shapeStart.end(), begin) - shapeStart.begin() - 1;
+        for (size_t p = begin; p < end; p++) {
+            while (p >= shapeStart[s + 1]) s++;
+            flatVertices[p] = makeVertex(attrib, shapes[s].mesh.indices[p - shapeStart[s]]);
+            hashes[p]       = flatVertices[p].hash();
+        }
+    });
+
+    // 2. weld
+    auto weldStart = Clock::now();
+    ConcurrentWeldTable<Vertex> table(total);
+    std::vector<uint32_t> firstPos(total);
+    parallelFor(total, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) {
+            firstPos[p] = table.insert(flatVertices.data(), hashes.data(), static_cast<uint32_t>(p));
+        }
+    });
+    // slot -> first occurrence, once every insert has landed
+    parallelFor(total, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) firstPos[p] = table.firstOccurrence(firstPos[p]);
+    });
+
+    // 3. number unique vertices in first-occurrence order (two-pass chunked prefix sum)
+    auto compactStart        = Clock::now();
+    const size_t chunkCount  = std::min(workerCount(), std::max<size_t>(1, total / 4096));
+    const uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+    std::vector<uint32_t> chunkUnique(chunkCount + 1, 0);
+    parallelForChunks(total, chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+        uint32_t count = 0;
+        for (size_t p = begin; p < end; p++) count += (firstPos[p] == p);
+        chunkUnique[chunk + 1] = count;
+    });
+    for (size_t c = 0; c < chunkCount; c++) chunkUnique[c + 1] += chunkUnique[c];
+
+    // vertexId[p] is only meaningful where p is a first occurrence
+    std::vector<uint32_t> vertexId(total);
+    vertices.resize(baseVertex + chunkUnique[chunkCount]);
+    parallelForChunks(total, chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+        uint32_t next = baseVertex + chunkUnique[chunk];
+        for (size_t p = begin; p < end; p++) {
+            if (firstPos[p] == p) {
+                vertexId[p]    = next;
+                vertices[next] = flatVertices[p];
+                next++;
+            }
+        }
+    });
+
+    // 4. scatter indices and build the submesh table
+    const size_t baseIndex = indices.size();
+    indices.resize(baseIndex + total);
+    parallelFor(total, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) indices[baseIndex + p] = vertexId[firstPos[p]];
+    });
+
+    size_t firstSubmesh = submeshes.size();
+    submeshes.resize(firstSubmesh + shapes.size());
+    parallelForEach(shapes.size(), [&](size_t s) {
+        uint32_t localMaxV = 0;
+        for (size_t p = shapeStart[s]; p < shapeStart[s + 1]; p++) localMaxV = std::max(localMaxV, indices[baseIndex + p]);
+        SubMesh& submesh    = submeshes[firstSubmesh + s];
+        submesh.indexOffset = static_cast<uint32_t>(baseIndex + shapeStart[s]);
+        submesh.indexCount  = static_cast<uint32_t>(shapeStart[s + 1] - shapeStart[s]);
+        submesh.maxVertex   = localMaxV;
+    });
+    auto end = Clock::now();
+
+    std::cout << "[Info] loadModel (parallel, " << workerCount() << " threads): gather " << elapsedMs(gatherStart, weldStart) << " ms, weld "
+              << elapsedMs(weldStart, compactStart) << " ms, compact " << elapsedMs(compactStart, end) << " ms" << std::endl;
+}
+
+/**
+ * @brief reorder vertices/indices for the GPU before they are baked
+ *
+ * 1. every submesh index range: Tipsify for the post-transform cache, then outside-in cluster order against overdraw
+ * 2. the vertex array is rewritten in first-use order of the new index stream (fetch locality); vertices no
+ *    index references are dropped and maxVertex is recomputed
+ * Submesh ranges keep their offsets and counts, only the order inside them changes.
+ */
+void HelloTriangleApplication::optimizeMeshes() {
+    auto start                       = Clock::now();
+    meshopt::VertexCacheStats before = meshopt::analyzeVertexCache(indices.data(), indices.size());
+
+    const float* positions = &vertices[0].pos.x;
+    parallelForEach(submeshes.size(), [&](size_t i) {
+        meshopt::optimizeIndexRange(indices.data() + submeshes[i].indexOffset, submeshes[i].indexCount, positions, sizeof(Vertex));
+    });
+
+    std::vector<uint32_t> remap;
+    uint32_t usedVertices  = meshopt::buildVertexFetchRemap(remap, indices.data(), indices.size(), vertices.size());
+    size_t droppedVertices = vertices.size() - usedVertices;
+    std::vector<Vertex> reordered(usedVertices);
+    for (size_t v = 0; v < vertices.size(); v++) {
+        if (remap[v] != std::numeric_limits<uint32_t>::max()) reordered[remap[v]] = vertices[v];
+    }
+    vertices.swap(reordered);
+    for (uint32_t& index : indices) index = remap[index];
+    for (SubMesh& submesh : submeshes) {
+        const uint32_t* first = indices.data() + submesh.indexOffset;
+        submesh.maxVertex     = submesh.indexCount ? *std::max_element(first, first + submesh.indexCount) : 0;
+    }
+
+    meshopt::VertexCacheStats after = meshopt::analyzeVertexCache(indices.data(), indices.size());
+    std::cout << "[Info] loadModel: optimized " << submeshes.size() << " submeshes in " << elapsedMs(start, Clock::now()) << " ms, ACMR "
+              << before.acmr() << " -> " << after.acmr() << ", ATVR " << before.atvr() << " -> " << after.atvr() << ", "
+              << droppedVertices << " unused vertices dropped" << std::endl;
+}
+
+/**
+ * @brief build the LOD chain of every submesh and its bounding sphere
+ *
+ * Each level aims for half the triangles of the previous one and is simplified from it, so the
+ * stored error adds up the errors along the chain (conservative). The chain stops early once a
+ * level saves less than 10%, e.g. for the Cornell box whose quads are all border vertices.
+ * Simplified ranges are appended behind all full-detail ranges and reordered like them.
+ */
+void HelloTriangleApplication::generateMeshLods() {
+    auto start             = Clock::now();
+    const float* positions = &vertices[0].pos.x;
+
+    std::vector<std::vector<uint32_t>> lodIndices(submeshes.size());
+    parallelForEach(submeshes.size(), [&](size_t i) {
+        SubMesh& submesh = submeshes[i];
+        float sphere[4];
+        meshopt::computeBoundingSphere(indices.data() + submesh.indexOffset, submesh.indexCount, positions, sizeof(Vertex), sphere);
+        submesh.boundingSphere = glm::vec4(sphere[0], sphere[1], sphere[2], sphere[3]);
+
+        std::vector<uint32_t>& out = lodIndices[i];
+        std::vector<uint32_t> source(indices.begin() + submesh.indexOffset, indices.begin() + submesh.indexOffset + submesh.indexCount);
+        std::vector<uint32_t> simplified(source.size());
+        float error      = 0.0f;
+        submesh.lodCount = 1;
+        while (submesh.lodCount < MAX_MESH_LODS) {
+            float levelError = 0.0f;
+            size_t target    = source.size() / 6 * 3;
+            size_t count     = meshopt::simplify(simplified.data(), source.data(), source.size(), positions, sizeof(Vertex), target,
+                                                 std::numeric_limits<float>::max(), &levelError);
+            if (count == 0 || count > source.size() * 9 / 10) break;
+            if (OPTIMIZE_MESHES) {
+                meshopt::optimizeIndexRange(simplified.data(), count, positions, sizeof(Vertex));
+            }
+            error += levelError;
+            // offsets are relative to this submesh's block for now, rebased below
+            submesh.lods[submesh.lodCount - 1] = {static_cast<uint32_t>(out.size()), static_cast<uint32_t>(count), error};
+            submesh.lodCount++;
+            out.insert(out.end(), simplified.begin(), simplified.begin() + count);
+            source.assign(simplified.begin(), simplified.begin() + count);
+        }
+    });
+
+    size_t lodIndexCount = 0;
+    for (size_t i = 0; i < submeshes.size(); i++) {
+        uint32_t base = static_cast<uint32_t>(indices.size());
+        for (uint32_t l = 1; l < submeshes[i].lodCount; l++) submeshes[i].lods[l - 1].indexOffset += base;
+        indices.insert(indices.end(), lodIndices[i].begin(), lodIndices[i].end());
+        lodIndexCount += lodIndices[i].size();
+    }
+    std::cout << "[Info] loadModel: LODs for " << submeshes.size() << " submeshes, +" << lodIndexCount << " indices in "
+              << elapsedMs(start, Clock::now()) << " ms" << std::endl;
+}
+
+/**
+ * @brief split the full-detail range of every submesh into meshlets with bounds and normal cones
+ *
+ * The submesh index range is rewritten in meshlet order (same triangles), so each meshlet is a
+ * contiguous index range that the cluster culling mode can draw with its own indirect command.
+ */
+void HelloTriangleApplication::buildMeshlets() {
+    auto start             = Clock::now();
+    const float* positions = &vertices[0].pos.x;
+
+    struct SubmeshMeshlets {
+        std::vector<meshopt::Meshlet> meshlets;
+        std::vector<uint32_t> vertices;
+        std::vector<uint8_t> triangles;
+    };
+    std::vector<SubmeshMeshlets> built(submeshes.size());
+    parallelForEach(submeshes.size(), [&](size_t i) {
+        const SubMesh& submesh = submeshes[i];
+        SubmeshMeshlets& out   = built[i];
+        meshopt::buildMeshlets(out.meshlets, out.vertices, out.triangles, indices.data() + submesh.indexOffset, submesh.indexCount);
+
+        // the range in meshlet order
+        uint32_t* range = indices.data() + submesh.indexOffset;
+        for (const meshopt::Meshlet& m : out.meshlets) {
+            for (uint32_t k = 0; k < m.triangleCount * 3; k++) *range++ = out.vertices[m.vertexOffset + out.triangles[m.triangleOffset + k]];
+        }
+    });
+
+    meshlets.clear();
+    meshletVertices.clear();
+    meshletTriangles.clear();
+    std::vector<meshopt::Meshlet> all;
+    for (size_t i = 0; i < submeshes.size(); i++) {
+        SubMesh& submesh     = submeshes[i];
+        submesh.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+        submesh.meshletCount = static_cast<uint32_t>(built[i].meshlets.size());
+
+        uint32_t firstIndex = submesh.indexOffset;
+        for (meshopt::Meshlet m : built[i].meshlets) {
+            meshopt::MeshletBounds bounds =
+                meshopt::computeMeshletBounds(m, built[i].vertices.data(), built[i].triangles.data(), positions, sizeof(Vertex));
+            m.vertexOffset += static_cast<uint32_t>(meshletVertices.size());
+            m.triangleOffset += static_cast<uint32_t>(meshletTriangles.size());
+            meshlets.push_back({.boundingSphere = {bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius},
+                                .cone           = {bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2], bounds.coneCutoff},
+                                .firstIndex     = firstIndex,
+                                .triangleCount  = m.triangleCount,
+                                .vertexOffset   = m.vertexOffset,
+                                .vertexCount    = m.vertexCount,
+                                .triangleOffset = m.triangleOffset,
+                                .submesh        = static_cast<uint32_t>(i),
+                                .baseVertex     = submesh.vertexOffset,
+                                .reserved       = 0});
+            all.push_back(m);
+            firstIndex += m.triangleCount * 3;
+        }
+        meshletVertices.insert(meshletVertices.end(), built[i].vertices.begin(), built[i].vertices.end());
+        meshletTriangles.insert(meshletTriangles.end(), built[i].triangles.begin(), built[i].triangles.end());
+    }
+
+    meshopt::MeshletStats stats = meshopt::analyzeMeshlets(all.data(), all.size());
+    std::cout << "[Info] loadModel: " << stats.meshletCount << " meshlets in " << elapsedMs(start, Clock::now()) << " ms, vertex fill "
+              << stats.vertexFill() * 100.0f << "%, triangle fill " << stats.triangleFill() * 100.0f << "%" << std::endl;
+}
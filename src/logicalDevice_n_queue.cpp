@@ -25,7 +25,7 @@ void HelloTriangleApplication::createLogicalDevice() {
 
         featureChain(
             // 1. Features2
-            vk::PhysicalDeviceFeatures2{.features = {.samplerAnisotropy = true}},
+            vk::PhysicalDeviceFeatures2{.features = {.multiDrawIndirect = true, .samplerAnisotropy = true}},
             
             // 2. Vulkan 1.1
             vk::PhysicalDeviceVulkan11Features{.shaderDrawParameters = true},
@@ -61,4 +61,6 @@ void HelloTriangleApplication::createLogicalDevice() {
 
     device = vk::raii::Device(physicalDevice, deviceCreateInfo);
     queue  = vk::raii::Queue(device, queueIndex, 0);
+    gpuAllocator.init(physicalDevice, device, featureChain.get<vk::PhysicalDeviceVulkan12Features>().bufferDeviceAddress);
+    uploads.init(device, queue, queueIndex, gpuAllocator);
 }
@@ -0,0 +1,192 @@
+#include "mesh_cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "hash.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        bytes  = std::exchange(other.bytes, nullptr);
+        length = std::exchange(other.length, 0);
+#ifdef _WIN32
+        fileHandle    = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(f, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(f);
+        return false;
+    }
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) {
+        CloseHandle(f);
+        return false;
+    }
+    void* view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+    fileHandle    = f;
+    mappingHandle = m;
+    bytes         = static_cast<const uint8_t*>(view);
+    length        = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps its own reference to the file
+    if (view == MAP_FAILED) return false;
+    // we read the whole file front to back right away (hash or upload), let the kernel prefetch
+    madvise(view, static_cast<size_t>(st.st_size), MADV_WILLNEED);
+    bytes  = static_cast<const uint8_t*>(view);
+    length = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+    if (!bytes) return;
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle    = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+    bytes  = nullptr;
+    length = 0;
+}
+
+uint64_t hashFile(const std::string& path, uint64_t seed) {
+    MappedFile file;
+    if (!file.open(path)) return 0;
+    return hash64(file.data(), file.size(), seed);
+}
+
+bool MeshCache::open(const std::string& path, uint64_t sourceHash, uint32_t vertexStride) {
+    if (!file.open(path)) return false;
+    if (file.size() < sizeof(MeshCacheHeader)) {
+        file.close();
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    // a section is valid if it is aligned for its element type and lies completely inside the file
+    auto sectionFits = [&](uint64_t offset, uint64_t count, uint64_t stride) {
+        return offset % 16 == 0 && offset <= file.size() && count <= (file.size() - offset) / stride;
+    };
+    bool valid = header.magic == MESH_CACHE_MAGIC && header.version == MESH_CACHE_VERSION && header.sourceHash == sourceHash &&
+                 header.vertexStride == vertexStride && sectionFits(header.vertexOffset, header.vertexCount, vertexStride) &&
+                 sectionFits(header.indexOffset, header.indexCount, sizeof(uint32_t)) &&
+                 sectionFits(header.submeshOffset, header.submeshCount, sizeof(MeshCacheSubMesh)) &&
+                 sectionFits(header.meshletOffset, header.meshletCount, sizeof(MeshCacheMeshlet)) &&
+                 sectionFits(header.meshletVertexOffset, header.meshletVertexCount, sizeof(uint32_t)) &&
+                 sectionFits(header.meshletTriangleOffset, header.meshletTriangleBytes, 1);
+    if (valid) {
+        // every submesh range has to address existing indices/vertices, otherwise we would upload garbage to the BLAS build
+        const MeshCacheSubMesh* records = submeshData();
+        for (uint32_t i = 0; i < header.submeshCount && valid; i++) {
+            valid = uint64_t(records[i].indexOffset) + records[i].indexCount <= header.indexCount && records[i].maxVertex < header.vertexCount &&
+                    records[i].lodCount <= MESH_CACHE_MAX_LODS;
+            for (uint32_t l = 0; l < records[i].lodCount && valid; l++) {
+                valid = uint64_t(records[i].lods[l].indexOffset) + records[i].lods[l].indexCount <= header.indexCount;
+            }
+            valid = valid && uint64_t(records[i].firstMeshlet) + records[i].meshletCount <= header.meshletCount;
+        }
+        const MeshCacheMeshlet* meshlets = meshletData();
+        for (uint32_t i = 0; i < header.meshletCount && valid; i++) {
+            const MeshCacheMeshlet& m = meshlets[i];
+            valid = uint64_t(m.firstIndex) + 3 * uint64_t(m.triangleCount) <= header.indexCount &&
+                    uint64_t(m.vertexOffset) + m.vertexCount <= header.meshletVertexCount &&
+                    uint64_t(m.triangleOffset) + 3 * uint64_t(m.triangleCount) <= header.meshletTriangleBytes && m.submesh < header.submeshCount;
+        }
+    }
+    if (!valid) {
+        file.close();
+    }
+    return valid;
+}
+
+void MeshCache::write(const std::string& path, uint64_t sourceHash, const MeshCacheContents& contents) {
+    auto align16 = [](uint64_t v) { return (v + 15) & ~uint64_t(15); };
+
+    const uint64_t vertexOffset          = align16(sizeof(MeshCacheHeader));
+    const uint64_t indexOffset           = align16(vertexOffset + uint64_t(contents.vertexCount) * contents.vertexStride);
+    const uint64_t submeshOffset         = align16(indexOffset + uint64_t(contents.indexCount) * sizeof(uint32_t));
+    const uint64_t meshletOffset         = align16(submeshOffset + uint64_t(contents.submeshCount) * sizeof(MeshCacheSubMesh));
+    const uint64_t meshletVertexOffset   = align16(meshletOffset + uint64_t(contents.meshletCount) * sizeof(MeshCacheMeshlet));
+    const uint64_t meshletTriangleOffset = align16(meshletVertexOffset + uint64_t(contents.meshletVertexCount) * sizeof(uint32_t));
+    MeshCacheHeader header{.magic                 = MESH_CACHE_MAGIC,
+                           .version               = MESH_CACHE_VERSION,
+                           .sourceHash            = sourceHash,
+                           .vertexStride          = contents.vertexStride,
+                           .vertexCount           = contents.vertexCount,
+                           .indexCount            = contents.indexCount,
+                           .submeshCount          = contents.submeshCount,
+                           .vertexOffset          = vertexOffset,
+                           .indexOffset           = indexOffset,
+                           .submeshOffset         = submeshOffset,
+                           .meshletCount          = contents.meshletCount,
+                           .meshletVertexCount    = contents.meshletVertexCount,
+                           .meshletTriangleBytes  = contents.meshletTriangleBytes,
+                           .reserved              = 0,
+                           .meshletOffset         = meshletOffset,
+                           .meshletVertexOffset   = meshletVertexOffset,
+                           .meshletTriangleOffset = meshletTriangleOffset};
+
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("failed to create mesh cache " + tmpPath);
+
+        const char zeros[16] = {};
+        auto writeAt = [&](uint64_t offset, const void* src, uint64_t size) {
+            uint64_t pos = static_cast<uint64_t>(out.tellp());
+            out.write(zeros, static_cast<std::streamsize>(offset - pos));  // alignment padding
+            if (size > 0) out.write(static_cast<const char*>(src), static_cast<std::streamsize>(size));
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.vertexOffset, contents.vertices, uint64_t(contents.vertexCount) * contents.vertexStride);
+        writeAt(header.indexOffset, contents.indices, uint64_t(contents.indexCount) * sizeof(uint32_t));
+        writeAt(header.submeshOffset, contents.submeshes, uint64_t(contents.submeshCount) * sizeof(MeshCacheSubMesh));
+        writeAt(header.meshletOffset, contents.meshlets, uint64_t(contents.meshletCount) * sizeof(MeshCacheMeshlet));
+        writeAt(header.meshletVertexOffset, contents.meshletVertices, uint64_t(contents.meshletVertexCount) * sizeof(uint32_t));
+        writeAt(header.meshletTriangleOffset, contents.meshletTriangles, contents.meshletTriangleBytes);
+        if (!out) throw std::runtime_error("failed to write mesh cache " + tmpPath);
+    }
+    std::filesystem::rename(tmpPath, path);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+/**
+ * @brief Read-only memory mapping of a whole file (mmap / MapViewOfFile)
+ *
+ */
+class MappedFile {
+   public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // returns false if the file does not exist, is empty or cannot be mapped
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr; }
+
+   private:
+    const uint8_t* bytes = nullptr;
+    size_t length        = 0;
+#ifdef _WIN32
+    void* fileHandle    = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+/**
+ * @brief .vkmesh: baked output of loadModel() that can be uploaded straight from a file mapping
+ *
+ * Layout (little endian, every section 16-byte aligned):
+ *   MeshCacheHeader
+ *   Vertex[vertexCount]             (vertexStride bytes each, same layout as the GPU vertex buffer)
+ *   uint32_t[indexCount]
+ *   MeshCacheSubMesh[submeshCount]
+ *   MeshCacheMeshlet[meshletCount]  (same layout as the meshlet SSBO)
+ *   uint32_t[meshletVertexCount]    (global vertex ids of every meshlet)
+ *   uint8_t[meshletTriangleBytes]   (3 meshlet-local indices per triangle)
+ *
+ * sourceHash covers the OBJ bytes and the loader settings that shaped the output; any mismatch
+ * (or a different magic/version/stride) makes the file stale and loadModel() rebuilds it.
+ */
+constexpr uint32_t MESH_CACHE_MAGIC   = 0x484D4B56;  // "VKMH"
+constexpr uint32_t MESH_CACHE_VERSION = 3;
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t submeshOffset;
+    uint32_t meshletCount;
+    uint32_t meshletVertexCount;
+    uint32_t meshletTriangleBytes;
+    uint32_t reserved;
+    uint64_t meshletOffset;
+    uint64_t meshletVertexOffset;
+    uint64_t meshletTriangleOffset;
+};
+
+constexpr uint32_t MESH_CACHE_MAX_LODS = 3;  // simplified levels per submesh, on top of the full-detail range
+
+struct MeshCacheLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error;
+};
+
+struct MeshCacheSubMesh {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t maxVertex;
+    uint32_t flags;  // bit 0: alphaCut
+    float boundingSphere[4];
+    uint32_t lodCount;  // simplified levels in lods[]
+    MeshCacheLod lods[MESH_CACHE_MAX_LODS];
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+};
+
+/**
+ * @brief one meshlet of the full-detail range of a submesh, also the element of the meshlet SSBO (meshlet_cull.slang)
+ *
+ * The submesh index range is stored in meshlet order, so every meshlet is the contiguous
+ * range [firstIndex, firstIndex + 3 * triangleCount) of the index buffer and can be drawn directly.
+ */
+struct MeshCacheMeshlet {
+    float boundingSphere[4];  // xyz center, w radius (submesh space)
+    float cone[4];            // xyz axis, w cutoff (1 = never back-facing)
+    uint32_t firstIndex;
+    uint32_t triangleCount;
+    uint32_t vertexOffset;    // into the meshlet vertex array
+    uint32_t vertexCount;
+    uint32_t triangleOffset;  // into the meshlet triangle array (bytes)
+    uint32_t submesh;
+    int32_t baseVertex;       // vertexOffset of the submesh
+    uint32_t reserved;
+};
+static_assert(sizeof(MeshCacheMeshlet) == 64, "MeshCacheMeshlet is an std430 array element");
+
+/**
+ * @brief everything a .vkmesh file holds, as pointers into the caller's arrays
+ */
+struct MeshCacheContents {
+    const void* vertices;
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    const uint32_t* indices;
+    uint32_t indexCount;
+    const MeshCacheSubMesh* submeshes;
+    uint32_t submeshCount;
+    const MeshCacheMeshlet* meshlets;
+    uint32_t meshletCount;
+    const uint32_t* meshletVertices;
+    uint32_t meshletVertexCount;
+    const uint8_t* meshletTriangles;
+    uint32_t meshletTriangleBytes;
+};
+constexpr uint32_t MESH_CACHE_FLAG_ALPHA_CUT = 1u << 0;
+
+/**
+ * @brief validated view into a mapped .vkmesh file, pointers stay valid while the MeshCache is alive
+ *
+ */
+class MeshCache {
+   public:
+    /**
+     * @brief map path and check it against the expected source hash and vertex stride
+     *
+     * @return false if the file is missing, truncated or stale
+     */
+    bool open(const std::string& path, uint64_t sourceHash, uint32_t vertexStride);
+    void close() { file.close(); }
+
+    const void* vertexData() const { return file.data() + header.vertexOffset; }
+    const uint32_t* indexData() const { return reinterpret_cast<const uint32_t*>(file.data() + header.indexOffset); }
+    const MeshCacheSubMesh* submeshData() const { return reinterpret_cast<const MeshCacheSubMesh*>(file.data() + header.submeshOffset); }
+    const MeshCacheMeshlet* meshletData() const { return reinterpret_cast<const MeshCacheMeshlet*>(file.data() + header.meshletOffset); }
+    const uint32_t* meshletVertexData() const { return reinterpret_cast<const uint32_t*>(file.data() + header.meshletVertexOffset); }
+    const uint8_t* meshletTriangleData() const { return file.data() + header.meshletTriangleOffset; }
+    uint32_t vertexCount() const { return header.vertexCount; }
+    uint32_t indexCount() const { return header.indexCount; }
+    uint32_t submeshCount() const { return header.submeshCount; }
+    uint32_t meshletCount() const { return header.meshletCount; }
+    uint32_t meshletVertexCount() const { return header.meshletVertexCount; }
+    uint32_t meshletTriangleBytes() const { return header.meshletTriangleBytes; }
+
+    /**
+     * @brief write a .vkmesh file (through a temporary file, so a crash never leaves a torn cache behind)
+     */
+    static void write(const std::string& path, uint64_t sourceHash, const MeshCacheContents& contents);
+
+   private:
+    MappedFile file;
+    MeshCacheHeader header{};
+};
+
+/**
+ * @brief content hash of a file (mapped, hashed with hash64), 0 if it cannot be read
+ */
+uint64_t hashFile(const std::string& path, uint64_t seed = 0);
@@ -0,0 +1,264 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace meshopt {
+
+namespace {
+struct Float3 {
+    float x, y, z;
+};
+Float3 operator-(Float3 a, Float3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+Float3 operator+(Float3 a, Float3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+Float3 operator*(Float3 a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+Float3 cross(Float3 a, Float3 b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+float dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+Float3 loadPosition(const float* positions, size_t stride, uint32_t v) {
+    Float3 p;
+    memcpy(&p, reinterpret_cast<const uint8_t*>(positions) + size_t(v) * stride, sizeof(p));
+    return p;
+}
+
+/**
+ * @brief FIFO cache approximation with timestamps: a vertex is resident if it was loaded in the last cacheSize misses
+ */
+struct CacheSimulator {
+    std::vector<uint32_t> loadedAt;
+    uint32_t timestamp;
+    uint32_t cacheSize;
+    CacheSimulator(size_t vertexCount, uint32_t size) : loadedAt(vertexCount, 0), timestamp(size + 1), cacheSize(size) {}
+    // returns 1 on a miss
+    uint32_t access(uint32_t v) {
+        if (timestamp - loadedAt[v] > cacheSize) {
+            loadedAt[v] = timestamp++;
+            return 1;
+        }
+        return 0;
+    }
+    // forget everything (start of a new cluster)
+    void flush() { timestamp += cacheSize + 1; }
+};
+}  // namespace
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t cacheSize) {
+    VertexCacheStats stats{};
+    if (indexCount == 0) return stats;
+    // true FIFO here (not the timestamp approximation) since this is what we report
+    std::vector<uint32_t> unique(indices, indices + indexCount);
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+    std::vector<uint32_t> fifo(cacheSize, std::numeric_limits<uint32_t>::max());
+    size_t head = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t v = indices[i];
+        if (std::find(fifo.begin(), fifo.end(), v) == fifo.end()) {
+            fifo[head] = v;
+            head       = (head + 1) % cacheSize;
+            stats.transformedVertices++;
+        }
+    }
+    stats.uniqueVertices = static_cast<uint32_t>(unique.size());
+    stats.triangles      = static_cast<uint32_t>(indexCount / 3);
+    return stats;
+}
+
+void tipsify(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>& clusters) {
+    const size_t triangleCount = indexCount / 3;
+    clusters.assign(1, 0);
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    // vertex -> triangle adjacency (CSR) and live triangle count per vertex
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++) live[indices[i]]++;
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] = adjacencyOffset[v] + live[v];
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t i = 0; i < indexCount; i++) adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    deadEnd.reserve(indexCount);
+    output.reserve(indexCount);
+
+    uint32_t timestamp = cacheSize + 1;
+    size_t scanCursor  = 0;  // next vertex to try when the dead-end stack runs dry
+    int64_t fan        = 0;
+
+    while (fan >= 0) {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t a = adjacencyOffset[fan]; a < adjacencyOffset[fan + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = indices[3 * size_t(t) + c];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (timestamp - cacheTime[v] > cacheSize) cacheTime[v] = timestamp++;
+            }
+            emitted[t] = 1;
+        }
+
+        // next fanning vertex: the oldest candidate that will still be in cache after its own fan
+        int64_t next     = -1;
+        int64_t priority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t p = 0;
+            if (int64_t(timestamp - cacheTime[v]) + 2 * int64_t(live[v]) <= int64_t(cacheSize)) p = timestamp - cacheTime[v];
+            if (p > priority) {
+                priority = p;
+                next     = v;
+            }
+        }
+        if (next == -1) {
+            // dead end: recently used vertices first, then scan the input order
+            while (!deadEnd.empty() && next == -1) {
+                uint32_t d = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[d] > 0) next = d;
+            }
+            while (next == -1 && scanCursor < vertexCount) {
+                if (live[scanCursor] > 0) next = static_cast<int64_t>(scanCursor);
+                scanCursor++;
+            }
+            // the cache locality is broken here, which makes it a cluster boundary for the overdraw pass
+            if (next != -1 && output.size() < indexCount) clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+        }
+        fan = next;
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t* indices,
+                      size_t indexCount,
+                      const float* positions,
+                      size_t positionStride,
+                      const std::vector<uint32_t>& clusters,
+                      uint32_t cacheSize,
+                      float threshold) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+    uint32_t vertexCount = 0;
+    for (size_t i = 0; i < indexCount; i++) vertexCount = std::max(vertexCount, indices[i] + 1);
+
+    // 1. soft boundaries: split every hard cluster wherever the running ACMR is already within threshold of the cluster's ACMR
+    std::vector<uint32_t> boundaries;
+    CacheSimulator cache(vertexCount, cacheSize);
+    std::vector<uint32_t> hard(clusters);
+    if (hard.empty() || hard.front() != 0) hard.insert(hard.begin(), 0);
+    hard.push_back(static_cast<uint32_t>(triangleCount));
+    for (size_t c = 0; c + 1 < hard.size(); c++) {
+        uint32_t begin = hard[c], end = hard[c + 1];
+        if (begin >= end) continue;
+        cache.flush();
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; t++) {
+            for (int k = 0; k < 3; k++) clusterMisses += cache.access(indices[3 * size_t(t) + k]);
+        }
+        const float limit = threshold * float(clusterMisses) / float(end - begin);
+
+        cache.flush();
+        boundaries.push_back(begin);
+        uint32_t start = begin, misses = 0;
+        for (uint32_t t = begin; t < end; t++) {
+            for (int k = 0; k < 3; k++) misses += cache.access(indices[3 * size_t(t) + k]);
+            if (t + 1 < end && float(misses) / float(t + 1 - start) <= limit) {
+                boundaries.push_back(t + 1);
+                start  = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+    boundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+    // 2. per cluster: area-weighted centroid and normal
+    const size_t clusterCount = boundaries.size() - 1;
+    std::vector<Float3> centroid(clusterCount), normal(clusterCount);
+    Float3 meshCentroid{0, 0, 0};
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++) {
+        Float3 center{0, 0, 0}, n{0, 0, 0};
+        float area = 0.0f;
+        for (uint32_t t = boundaries[c]; t < boundaries[c + 1]; t++) {
+            Float3 p0 = loadPosition(positions, positionStride, indices[3 * size_t(t) + 0]);
+            Float3 p1 = loadPosition(positions, positionStride, indices[3 * size_t(t) + 1]);
+            Float3 p2 = loadPosition(positions, positionStride, indices[3 * size_t(t) + 2]);
+            Float3 fn = cross(p1 - p0, p2 - p0);
+            float a   = std::sqrt(dot(fn, fn));
+            center    = center + (p0 + p1 + p2) * (a / 3.0f);
+            n         = n + fn;
+            area += a;
+        }
+        meshCentroid = meshCentroid + center;
+        meshArea += area;
+        centroid[c]  = area > 0.0f ? center * (1.0f / area) : loadPosition(positions, positionStride, indices[3 * size_t(boundaries[c])]);
+        float length = std::sqrt(dot(n, n));
+        normal[c]    = length > 0.0f ? n * (1.0f / length) : Float3{0, 0, 0};
+    }
+    if (meshArea > 0.0f) meshCentroid = meshCentroid * (1.0f / meshArea);
+
+    // 3. outside-in: clusters facing away from the centroid first
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) sortKey[c] = dot(centroid[c] - meshCentroid, normal[c]);
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (uint32_t c : order) {
+        result.insert(result.end(), indices + 3 * size_t(boundaries[c]), indices + 3 * size_t(boundaries[c + 1]));
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void optimizeIndexRange(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride) {
+    if (indexCount < 3 || indexCount % 3 != 0) return;
+
+    // compact to local ids so the per-vertex arrays only cover this range
+    std::vector<uint32_t> unique(indices, indices + indexCount);
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    std::vector<uint32_t> local(indexCount);
+    for (size_t i = 0; i < indexCount; i++) {
+        local[i] = static_cast<uint32_t>(std::lower_bound(unique.begin(), unique.end(), indices[i]) - unique.begin());
+    }
+    std::vector<float> localPositions(unique.size() * 3);
+    for (size_t v = 0; v < unique.size(); v++) {
+        memcpy(&localPositions[3 * v], reinterpret_cast<const uint8_t*>(positions) + size_t(unique[v]) * positionStride, 3 * sizeof(float));
+    }
+
+    std::vector<uint32_t> clusters;
+    tipsify(local.data(), indexCount, unique.size(), VERTEX_CACHE_SIZE, clusters);
+    optimizeOverdraw(local.data(), indexCount, localPositions.data(), 3 * sizeof(float), clusters, VERTEX_CACHE_SIZE);
+
+    for (size_t i = 0; i < indexCount; i++) indices[i] = unique[local[i]];
+}
+
+uint32_t buildVertexFetchRemap(std::vector<uint32_t>& remap, const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    remap.assign(vertexCount, std::numeric_limits<uint32_t>::max());
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t& slot = remap[indices[i]];
+        if (slot == std::numeric_limits<uint32_t>::max()) slot = next++;
+    }
+    return next;
+}
+
+}  // namespace meshopt
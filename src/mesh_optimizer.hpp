@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief CPU-side index/vertex reordering for GPU vertex reuse and overdraw
+ *
+ * Everything here works on plain index arrays and a strided float3 position array, so it
+ * does not depend on the Vertex layout or on Vulkan.
+ */
+namespace meshopt {
+
+// post-transform cache size the reordering targets (FIFO model)
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    uint32_t transformedVertices = 0;  // cache misses in the FIFO simulation
+    uint32_t uniqueVertices      = 0;
+    uint32_t triangles           = 0;
+    // average cache miss ratio: transformed vertices per triangle (0.5 is ideal for large grids, 3 is worst)
+    float acmr() const { return triangles ? float(transformedVertices) / float(triangles) : 0.0f; }
+    // average transform to vertex ratio: 1.0 means every vertex is transformed exactly once
+    float atvr() const { return uniqueVertices ? float(transformedVertices) / float(uniqueVertices) : 0.0f; }
+};
+
+/**
+ * @brief simulate a FIFO post-transform cache over a triangle list
+ */
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+/**
+ * @brief Tipsify (Sander, Nehab, Barczak 2007) vertex cache reordering of a triangle list
+ *
+ * @param indices     triangle list over vertices [0, vertexCount), reordered in place
+ * @param clusters    receives the first triangle of every cluster (points where the cache was flushed)
+ */
+void tipsify(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>& clusters);
+
+/**
+ * @brief overdraw-aware cluster reordering after tipsify
+ *
+ * Clusters are split further wherever that does not hurt cache efficiency by more than
+ * `threshold` (1.05 = 5% more transforms), then sorted so that clusters facing away from the
+ * mesh centroid are drawn first (outside-in), which front-loads occluders.
+ *
+ * @param positions strided float3 positions, indexed by the values in indices
+ */
+void optimizeOverdraw(uint32_t* indices,
+                      size_t indexCount,
+                      const float* positions,
+                      size_t positionStride,
+                      const std::vector<uint32_t>& clusters,
+                      uint32_t cacheSize,
+                      float threshold = 1.05f);
+
+/**
+ * @brief run tipsify + optimizeOverdraw on an index range that references arbitrary (global) vertex ids
+ *
+ * The range is compacted to local ids first, so cost depends on the range size only.
+ */
+void optimizeIndexRange(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride);
+
+/**
+ * @brief build a vertex remap in first-use order over the given index ranges
+ *
+ * @param remap   resized to vertexCount, remap[old] = new id, or UINT32_MAX for vertices no range uses
+ * @return number of vertices that are still referenced
+ */
+uint32_t buildVertexFetchRemap(std::vector<uint32_t>& remap, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+}  // namespace meshopt
@@ -0,0 +1,286 @@
+#include "mesh_simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.hpp"
+
+namespace meshopt {
+
+namespace {
+struct Vec3 {
+    double x, y, z;
+};
+Vec3 operator-(Vec3 a, Vec3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+Vec3 cross(Vec3 a, Vec3 b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+double dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+/**
+ * @brief symmetric 4x4 quadric Q(p) = p^T A p + 2 b.p + c, accumulated with area weights
+ */
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c      = 0;
+    double weight = 0;
+
+    static Quadric fromPlane(Vec3 n, double d, double w) {
+        Quadric q;
+        q.a00    = w * n.x * n.x;
+        q.a01    = w * n.x * n.y;
+        q.a02    = w * n.x * n.z;
+        q.a11    = w * n.y * n.y;
+        q.a12    = w * n.y * n.z;
+        q.a22    = w * n.z * n.z;
+        q.b0     = w * n.x * d;
+        q.b1     = w * n.y * d;
+        q.b2     = w * n.z * d;
+        q.c      = w * d * d;
+        q.weight = w;
+        return q;
+    }
+    Quadric& operator+=(const Quadric& o) {
+        a00 += o.a00, a01 += o.a01, a02 += o.a02, a11 += o.a11, a12 += o.a12, a22 += o.a22;
+        b0 += o.b0, b1 += o.b1, b2 += o.b2;
+        c += o.c;
+        weight += o.weight;
+        return *this;
+    }
+    double evaluate(Vec3 p) const {
+        double r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+                   2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return std::max(r, 0.0);
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;   // area weighted quadric error, used for ordering
+    double error;  // quadric error per unit area, squared distance
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) { return (uint64_t(a) << 32) | b; }
+
+Vec3 loadVec3(const float* positions, size_t stride, uint32_t v) {
+    float p[3];
+    memcpy(p, reinterpret_cast<const uint8_t*>(positions) + size_t(v) * stride, sizeof(p));
+    return {p[0], p[1], p[2]};
+}
+}  // namespace
+
+size_t simplify(uint32_t* destination,
+                const uint32_t* indices,
+                size_t indexCount,
+                const float* positions,
+                size_t positionStride,
+                size_t targetIndexCount,
+                float targetError,
+                float* resultError) {
+    if (resultError) *resultError = 0.0f;
+    if (indexCount % 3 != 0) return 0;
+
+    // local ids, so all per-vertex arrays only cover this range
+    std::vector<uint32_t> vertexIds(indices, indices + indexCount);
+    std::sort(vertexIds.begin(), vertexIds.end());
+    vertexIds.erase(std::unique(vertexIds.begin(), vertexIds.end()), vertexIds.end());
+    const size_t vertexCount = vertexIds.size();
+    std::vector<uint32_t> local(indexCount);
+    for (size_t i = 0; i < indexCount; i++) {
+        local[i] = static_cast<uint32_t>(std::lower_bound(vertexIds.begin(), vertexIds.end(), indices[i]) - vertexIds.begin());
+    }
+    std::vector<Vec3> pos(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) pos[v] = loadVec3(positions, positionStride, vertexIds[v]);
+
+    // position groups: vertices that only differ in their attributes share a group (and a quadric)
+    std::vector<uint32_t> group(vertexCount);
+    std::vector<uint32_t> wedgeCount(vertexCount, 0);
+    {
+        std::unordered_map<uint64_t, uint32_t> byPosition;
+        for (size_t v = 0; v < vertexCount; v++) {
+            float p[3];
+            memcpy(p, reinterpret_cast<const uint8_t*>(positions) + size_t(vertexIds[v]) * positionStride, sizeof(p));
+            uint32_t candidate  = static_cast<uint32_t>(v);
+            auto [it, inserted] = byPosition.try_emplace(hash64(p, sizeof(p)), candidate);
+            // a hash collision between different positions just keeps the vertex in its own group
+            if (!inserted && pos[it->second].x == pos[v].x && pos[it->second].y == pos[v].y && pos[it->second].z == pos[v].z) {
+                candidate = it->second;
+            }
+            group[v] = candidate;
+            wedgeCount[candidate]++;
+        }
+    }
+
+    // lock everything that cannot move without opening a crack: borders, seams, non-manifold edges
+    std::vector<uint8_t> locked(vertexCount, 0);
+    {
+        std::unordered_map<uint64_t, uint32_t> directedEdges;
+        directedEdges.reserve(indexCount);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = group[local[i + e]], b = group[local[i + (e + 1) % 3]];
+                directedEdges[edgeKey(a, b)]++;
+            }
+        }
+        std::vector<uint8_t> groupLocked(vertexCount, 0);
+        for (auto [key, count] : directedEdges) {
+            uint32_t a = static_cast<uint32_t>(key >> 32), b = static_cast<uint32_t>(key);
+            auto twin = directedEdges.find(edgeKey(b, a));
+            if (count != 1 || twin == directedEdges.end() || twin->second != 1) {
+                groupLocked[a] = groupLocked[b] = 1;
+            }
+        }
+        for (size_t v = 0; v < vertexCount; v++) locked[v] = groupLocked[group[v]] || wedgeCount[group[v]] > 1;
+    }
+
+    // per-group quadrics from the triangle planes
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        Vec3 p0     = pos[local[i]], p1 = pos[local[i + 1]], p2 = pos[local[i + 2]];
+        Vec3 n      = cross(p1 - p0, p2 - p0);
+        double area = std::sqrt(dot(n, n));
+        if (area <= 0.0) continue;
+        n         = {n.x / area, n.y / area, n.z / area};
+        Quadric q = Quadric::fromPlane(n, -dot(n, p0), area * 0.5);
+        for (int k = 0; k < 3; k++) quadrics[group[local[i + k]]] += q;
+    }
+
+    const double maxError = double(targetError) * double(targetError);
+    double achieved       = 0.0;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    while (local.size() > targetIndexCount) {
+        // vertex -> triangles of the current mesh
+        std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+        for (uint32_t v : local) adjacencyOffset[v + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] += adjacencyOffset[v];
+        adjacency.resize(local.size());
+        {
+            std::vector<uint32_t> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < local.size(); i++) adjacency[cursor[local[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // every half edge (a, b) with a movable proposes a -> b, evaluated at b since vertices never move freely
+        collapses.clear();
+        for (size_t i = 0; i < local.size(); i += 3) {
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = local[i + e], b = local[i + (e + 1) % 3];
+                if (locked[a] || group[a] == group[b]) continue;
+                Quadric q = quadrics[group[a]];
+                q += quadrics[group[b]];
+                double cost = q.evaluate(pos[b]);
+                collapses.push_back({a, b, cost, q.weight > 0.0 ? cost / q.weight : 0.0});
+            }
+        }
+        if (collapses.empty()) break;
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+        // apply the cheapest independent collapses; every collapse removes about two triangles
+        const size_t trianglesToRemove = (local.size() - targetIndexCount) / 3;
+        size_t removed                 = 0;
+        for (size_t v = 0; v < vertexCount; v++) remap[v] = static_cast<uint32_t>(v);
+        std::fill(touched.begin(), touched.end(), 0);
+        for (const Collapse& c : collapses) {
+            if (removed >= trianglesToRemove || c.error > maxError) break;
+            if (touched[c.from] || touched[c.to]) continue;
+
+            // reject collapses that flip a triangle around `from`
+            bool flips   = false;
+            size_t faces = 0;
+            for (uint32_t a = adjacencyOffset[c.from]; a < adjacencyOffset[c.from + 1] && !flips; a++) {
+                const uint32_t* tri = &local[3 * size_t(adjacency[a])];
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+                    faces++;
+                    continue;
+                }
+                Vec3 before[3], after[3];
+                for (int k = 0; k < 3; k++) {
+                    before[k] = pos[tri[k]];
+                    after[k]  = tri[k] == c.from ? pos[c.to] : pos[tri[k]];
+                }
+                Vec3 n0 = cross(before[1] - before[0], before[2] - before[0]);
+                Vec3 n1 = cross(after[1] - after[0], after[2] - after[0]);
+                flips   = dot(n0, n1) <= 0.0;
+            }
+            if (flips) continue;
+
+            remap[c.from] = c.to;
+            quadrics[group[c.to]] += quadrics[group[c.from]];
+            touched[c.from] = touched[c.to] = 1;
+            achieved                        = std::max(achieved, c.error);
+            removed += std::max<size_t>(faces, 1);
+        }
+        if (removed == 0) break;
+
+        // rewrite the triangle list, dropping triangles that collapsed to a line
+        size_t write = 0;
+        for (size_t i = 0; i < local.size(); i += 3) {
+            uint32_t a = remap[local[i]], b = remap[local[i + 1]], c = remap[local[i + 2]];
+            if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c]) continue;
+            local[write++] = a;
+            local[write++] = b;
+            local[write++] = c;
+        }
+        local.resize(write);
+    }
+
+    for (size_t i = 0; i < local.size(); i++) destination[i] = vertexIds[local[i]];
+    if (resultError) *resultError = static_cast<float>(std::sqrt(achieved));
+    return local.size();
+}
+
+void computeBoundingSphere(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, float sphere[4]) {
+    sphere[0] = sphere[1] = sphere[2] = sphere[3] = 0.0f;
+    if (indexCount == 0) return;
+
+    // Ritter: start from the most distant pair along the axis with the widest spread, then grow
+    auto at = [&](size_t i) { return loadVec3(positions, positionStride, indices[i]); };
+    size_t minIndex[3] = {0, 0, 0}, maxIndex[3] = {0, 0, 0};
+    Vec3 first         = at(0);
+    double minValue[3] = {first.x, first.y, first.z}, maxValue[3] = {first.x, first.y, first.z};
+    for (size_t i = 1; i < indexCount; i++) {
+        Vec3 p      = at(i);
+        double v[3] = {p.x, p.y, p.z};
+        for (int axis = 0; axis < 3; axis++) {
+            if (v[axis] < minValue[axis]) minValue[axis] = v[axis], minIndex[axis] = i;
+            if (v[axis] > maxValue[axis]) maxValue[axis] = v[axis], maxIndex[axis] = i;
+        }
+    }
+    int widest        = 0;
+    double widestDist = -1.0;
+    for (int axis = 0; axis < 3; axis++) {
+        Vec3 d   = at(maxIndex[axis]) - at(minIndex[axis]);
+        double s = dot(d, d);
+        if (s > widestDist) {
+            widestDist = s;
+            widest     = axis;
+        }
+    }
+    Vec3 lo = at(minIndex[widest]), hi = at(maxIndex[widest]);
+    Vec3 center{(lo.x + hi.x) * 0.5, (lo.y + hi.y) * 0.5, (lo.z + hi.z) * 0.5};
+    double radius = std::sqrt(widestDist) * 0.5;
+
+    for (size_t i = 0; i < indexCount; i++) {
+        Vec3 d      = at(i) - center;
+        double dist = std::sqrt(dot(d, d));
+        if (dist > radius) {
+            double grow = (dist - radius) * 0.5;
+            radius += grow;
+            double t = grow / dist;
+            center   = {center.x + d.x * t, center.y + d.y * t, center.z + d.z * t};
+        }
+    }
+    sphere[0] = static_cast<float>(center.x);
+    sphere[1] = static_cast<float>(center.y);
+    sphere[2] = static_cast<float>(center.z);
+    sphere[3] = static_cast<float>(radius);
+}
+
+}  // namespace meshopt
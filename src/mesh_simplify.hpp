@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief quadric error metric simplification for LOD chains
+ *
+ * Like mesh_optimizer.hpp this only sees index arrays and strided float3 positions. The
+ * simplifier never creates vertices: an edge collapse moves one vertex onto a neighbour, so
+ * every LOD indexes the same vertex buffer as the full-detail range.
+ */
+namespace meshopt {
+
+/**
+ * @brief simplify a triangle list to about targetIndexCount indices (Garland & Heckbert 1997)
+ *
+ * Vertices on open borders, on attribute seams (several vertices at one position) or on
+ * non-manifold edges are never moved, so LODs stay crack free; a mesh made only of those
+ * stops early.
+ *
+ * @param destination  receives the simplified triangle list, must hold indexCount indices
+ * @param indices      triangle list over arbitrary vertex ids
+ * @param positions    strided float3 positions, indexed by the values in indices
+ * @param targetError  stop before any collapse whose error exceeds this distance (object space)
+ * @param resultError  receives the largest error of the collapses that were done (object space distance)
+ * @return number of indices written to destination
+ */
+size_t simplify(uint32_t* destination,
+                const uint32_t* indices,
+                size_t indexCount,
+                const float* positions,
+                size_t positionStride,
+                size_t targetIndexCount,
+                float targetError,
+                float* resultError);
+
+/**
+ * @brief bounding sphere of the vertices an index range references (Ritter, about 5% larger than optimal)
+ *
+ * @param sphere receives center xyz and radius
+ */
+void computeBoundingSphere(const uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, float sphere[4]);
+
+}  // namespace meshopt
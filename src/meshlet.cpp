@@ -0,0 +1,181 @@
+#include "meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "mesh_simplify.hpp"
+
+namespace meshopt {
+
+namespace {
+constexpr uint8_t NOT_IN_MESHLET = 0xFF;
+
+void loadPosition(const float* positions, size_t stride, uint32_t v, float out[3]) {
+    memcpy(out, reinterpret_cast<const uint8_t*>(positions) + size_t(v) * stride, 3 * sizeof(float));
+}
+}  // namespace
+
+size_t buildMeshlets(std::vector<Meshlet>& meshlets,
+                     std::vector<uint32_t>& meshletVertices,
+                     std::vector<uint8_t>& meshletTriangles,
+                     const uint32_t* indices,
+                     size_t indexCount,
+                     size_t maxVertices,
+                     size_t maxTriangles) {
+    const size_t firstMeshlet  = meshlets.size();
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || maxVertices < 3 || maxTriangles < 1) return 0;
+    maxVertices = std::min<size_t>(maxVertices, NOT_IN_MESHLET);  // local indices are 8 bit
+
+    // local ids and vertex -> triangle adjacency
+    std::vector<uint32_t> vertexIds(indices, indices + indexCount);
+    std::sort(vertexIds.begin(), vertexIds.end());
+    vertexIds.erase(std::unique(vertexIds.begin(), vertexIds.end()), vertexIds.end());
+    const size_t vertexCount = vertexIds.size();
+    std::vector<uint32_t> local(indexCount);
+    for (size_t i = 0; i < indexCount; i++) {
+        local[i] = static_cast<uint32_t>(std::lower_bound(vertexIds.begin(), vertexIds.end(), indices[i]) - vertexIds.begin());
+    }
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) adjacencyOffset[local[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] += adjacencyOffset[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) adjacency[cursor[local[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint8_t> slot(vertexCount, NOT_IN_MESHLET);  // position of a vertex in the open meshlet
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> openVertices;
+    std::vector<uint8_t> openTriangles;
+    size_t scanCursor = 0;
+
+    auto newVertices = [&](uint32_t t) {
+        return (slot[local[3 * t]] == NOT_IN_MESHLET) + (slot[local[3 * t + 1]] == NOT_IN_MESHLET) + (slot[local[3 * t + 2]] == NOT_IN_MESHLET);
+    };
+    auto flush = [&]() {
+        if (openTriangles.empty()) return;
+        Meshlet meshlet{.vertexOffset   = static_cast<uint32_t>(meshletVertices.size()),
+                        .triangleOffset = static_cast<uint32_t>(meshletTriangles.size()),
+                        .vertexCount    = static_cast<uint32_t>(openVertices.size()),
+                        .triangleCount  = static_cast<uint32_t>(openTriangles.size() / 3)};
+        for (uint32_t v : openVertices) {
+            meshletVertices.push_back(vertexIds[v]);
+            slot[v] = NOT_IN_MESHLET;
+        }
+        meshletTriangles.insert(meshletTriangles.end(), openTriangles.begin(), openTriangles.end());
+        meshlets.push_back(meshlet);
+        openVertices.clear();
+        openTriangles.clear();
+    };
+
+    uint32_t last = std::numeric_limits<uint32_t>::max();
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        // best neighbour of the last triangle: fewest vertices that are not in the meshlet yet
+        uint32_t next = std::numeric_limits<uint32_t>::max();
+        int bestCost  = 4;
+        auto consider = [&](uint32_t v) {
+            for (uint32_t a = adjacencyOffset[v]; a < adjacencyOffset[v + 1]; a++) {
+                uint32_t t = adjacency[a];
+                if (emitted[t]) continue;
+                int cost = newVertices(t);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    next     = t;
+                }
+            }
+        };
+        if (last != std::numeric_limits<uint32_t>::max()) {
+            for (int k = 0; k < 3 && bestCost > 0; k++) consider(local[3 * size_t(last) + k]);
+            // a triangle that closes a gap anywhere in the meshlet (no new vertices) beats growing the front
+            for (size_t k = 0; k < openVertices.size() && bestCost > 0; k++) consider(openVertices[k]);
+        }
+        if (next == std::numeric_limits<uint32_t>::max()) {
+            while (emitted[scanCursor]) scanCursor++;
+            next = static_cast<uint32_t>(scanCursor);
+        }
+
+        if (openVertices.size() + newVertices(next) > maxVertices || openTriangles.size() / 3 + 1 > maxTriangles) {
+            flush();
+        }
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = local[3 * size_t(next) + k];
+            if (slot[v] == NOT_IN_MESHLET) {
+                slot[v] = static_cast<uint8_t>(openVertices.size());
+                openVertices.push_back(v);
+            }
+            openTriangles.push_back(slot[v]);
+        }
+        emitted[next] = 1;
+        last          = next;
+    }
+    flush();
+    return meshlets.size() - firstMeshlet;
+}
+
+MeshletBounds computeMeshletBounds(const Meshlet& meshlet,
+                                   const uint32_t* meshletVertices,
+                                   const uint8_t* meshletTriangles,
+                                   const float* positions,
+                                   size_t positionStride) {
+    MeshletBounds bounds{};
+    std::vector<uint32_t> triangles(size_t(meshlet.triangleCount) * 3);
+    for (size_t i = 0; i < triangles.size(); i++) {
+        triangles[i] = meshletVertices[meshlet.vertexOffset + meshletTriangles[meshlet.triangleOffset + i]];
+    }
+    float sphere[4];
+    computeBoundingSphere(triangles.data(), triangles.size(), positions, positionStride, sphere);
+    memcpy(bounds.center, sphere, sizeof(bounds.center));
+    bounds.radius = sphere[3];
+
+    // normal cone: average normal, opening angle from the normal that deviates most
+    std::vector<float> normals;
+    normals.reserve(triangles.size());
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        float p0[3], p1[3], p2[3];
+        loadPosition(positions, positionStride, triangles[i], p0);
+        loadPosition(positions, positionStride, triangles[i + 1], p1);
+        loadPosition(positions, positionStride, triangles[i + 2], p2);
+        float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        float n[3]  = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        float area  = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (area == 0.0f) continue;
+        for (int k = 0; k < 3; k++) {
+            normals.push_back(n[k] / area);
+            axis[k] += n[k] / area;
+        }
+    }
+    float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    bounds.coneCutoff = 1.0f;
+    if (normals.empty() || axisLength == 0.0f) return bounds;
+    for (int k = 0; k < 3; k++) bounds.coneAxis[k] = axis[k] / axisLength;
+
+    float minDot = 1.0f;
+    for (size_t i = 0; i < normals.size(); i += 3) {
+        minDot = std::min(minDot, normals[i] * bounds.coneAxis[0] + normals[i + 1] * bounds.coneAxis[1] + normals[i + 2] * bounds.coneAxis[2]);
+    }
+    // a cone wider than ~84 degrees can always be seen from somewhere in front: never cull it
+    if (minDot > 0.1f) {
+        // normal cone half angle a has cos(a) = minDot; the back-facing cone of view directions opens to a + 90 degrees,
+        // whose negated cosine is sin(a)
+        bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+    return bounds;
+}
+
+MeshletStats analyzeMeshlets(const Meshlet* meshlets, size_t meshletCount) {
+    MeshletStats stats;
+    stats.meshletCount = meshletCount;
+    for (size_t i = 0; i < meshletCount; i++) {
+        stats.vertexCount += meshlets[i].vertexCount;
+        stats.triangleCount += meshlets[i].triangleCount;
+    }
+    return stats;
+}
+
+}  // namespace meshopt
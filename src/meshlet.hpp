@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief meshlet (cluster) partitioning of triangle lists
+ *
+ * Same conventions as mesh_optimizer.hpp: plain index arrays and strided float3 positions,
+ * no Vertex or Vulkan types, so the builder can be exercised on the CPU alone.
+ */
+namespace meshopt {
+
+// limits commonly used for mesh shading (NVIDIA recommends 64/126, 124 keeps the triangle list 4-byte aligned)
+constexpr size_t MESHLET_MAX_VERTICES  = 64;
+constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+
+/**
+ * @brief one cluster: its vertices are meshletVertices[vertexOffset, +vertexCount) (global vertex ids),
+ *  its triangles are 3 local (8-bit) indices each at meshletTriangles[triangleOffset, +3 * triangleCount)
+ */
+struct Meshlet {
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+/**
+ * @brief culling data of one meshlet
+ *
+ * The cluster is back-facing for a viewer at `eye` if
+ *   dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+ * coneCutoff == 1 means the normals spread too far and the cone test never rejects.
+ */
+struct MeshletBounds {
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;
+};
+
+struct MeshletStats {
+    size_t meshletCount  = 0;
+    size_t vertexCount   = 0;  // sum over meshlets (vertices on cluster borders count more than once)
+    size_t triangleCount = 0;
+    // average fill of the per-meshlet limits, 1.0 = every meshlet is full
+    float vertexFill(size_t maxVertices = MESHLET_MAX_VERTICES) const {
+        return meshletCount ? float(vertexCount) / float(meshletCount * maxVertices) : 0.0f;
+    }
+    float triangleFill(size_t maxTriangles = MESHLET_MAX_TRIANGLES) const {
+        return meshletCount ? float(triangleCount) / float(meshletCount * maxTriangles) : 0.0f;
+    }
+};
+
+/**
+ * @brief split a triangle list into meshlets and append them to the output arrays
+ *
+ * Greedy: a meshlet grows through triangles adjacent to its vertices, preferring those that
+ * add the fewest new vertices (the last triangle's neighbours first), and falls back to the next
+ * unused triangle in index order (spatially coherent after tipsify). Input triangle order is not preserved.
+ *
+ * @return number of meshlets appended
+ */
+size_t buildMeshlets(std::vector<Meshlet>& meshlets,
+                     std::vector<uint32_t>& meshletVertices,
+                     std::vector<uint8_t>& meshletTriangles,
+                     const uint32_t* indices,
+                     size_t indexCount,
+                     size_t maxVertices  = MESHLET_MAX_VERTICES,
+                     size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+/**
+ * @brief bounding sphere and normal cone of one meshlet
+ */
+MeshletBounds computeMeshletBounds(const Meshlet& meshlet,
+                                   const uint32_t* meshletVertices,
+                                   const uint8_t* meshletTriangles,
+                                   const float* positions,
+                                   size_t positionStride);
+
+MeshletStats analyzeMeshlets(const Meshlet* meshlets, size_t meshletCount);
+
+}  // namespace meshopt
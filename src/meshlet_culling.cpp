@@ -0,0 +1,145 @@
+#include "tutorial.hpp"
+
+/*
+cluster culling mode: meshlet_cull.slang tests every meshlet against the frustum and its normal
+cone and writes one vk::DrawIndexedIndirectCommand per meshlet (instanceCount 0 when culled).
+The graphics pass then draws each submesh with a single drawIndexedIndirect over its meshlets.
+A command draws every scene instance of the meshlet's submesh, so only submeshes placed once are culled;
+meshlets of instanced submeshes are always drawn.
+*/
+
+void HelloTriangleApplication::createMeshletCullPipeline() {
+    // Binding 0: meshlets, 1: per instance model matrices, 2: indirect commands (output), 3: instance range per submesh
+    std::array<vk::DescriptorSetLayoutBinding, 4> bindings;
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i] = vk::DescriptorSetLayoutBinding{.binding         = i,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .descriptorCount = 1,
+                                                     .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    }
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
+    meshletCullSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::PushConstantRange pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(MeshletCullPushConstants)};
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+        .setLayoutCount = 1, .pSetLayouts = &*meshletCullSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
+    meshletCullPipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+
+    vk::raii::ShaderModule shaderModule = createShaderModule(readFile("shaders/meshlet_cull.spv"));
+    vk::PipelineShaderStageCreateInfo stageInfo{.stage = vk::ShaderStageFlagBits::eCompute, .module = shaderModule, .pName = "main"};
+    vk::ComputePipelineCreateInfo pipelineInfo{.stage = stageInfo, .layout = meshletCullPipelineLayout};
+    meshletCullPipeline = vk::raii::Pipeline(device, nullptr, pipelineInfo);
+}
+
+void HelloTriangleApplication::createMeshletBuffers() {
+    if (meshletView.empty()) return;
+
+    meshletBufferResource.size = meshletView.size_bytes();
+    createDeviceLocalBuffer(meshletView.data(),
+                            meshletBufferResource.size,
+                            vk::BufferUsageFlagBits::eStorageBuffer,
+                            meshletBufferResource.buffer,
+                            meshletBufferResource.memory);
+    meshletVertexBufferResource.size = meshletVertexView.size_bytes();
+    createDeviceLocalBuffer(meshletVertexView.data(),
+                            meshletVertexBufferResource.size,
+                            vk::BufferUsageFlagBits::eStorageBuffer,
+                            meshletVertexBufferResource.buffer,
+                            meshletVertexBufferResource.memory);
+    // 8-bit local indices, padded to whole uints for StructuredBuffer<uint> access
+    std::vector<uint8_t> triangles(meshletTriangleView.begin(), meshletTriangleView.end());
+    triangles.resize((triangles.size() + 3) & ~size_t(3), 0);
+    meshletTriangleBufferResource.size = triangles.size();
+    createDeviceLocalBuffer(triangles.data(),
+                            meshletTriangleBufferResource.size,
+                            vk::BufferUsageFlagBits::eStorageBuffer,
+                            meshletTriangleBufferResource.buffer,
+                            meshletTriangleBufferResource.memory);
+
+    meshletCommandBuffers.clear();
+    meshletCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        BufferResource& commands = meshletCommandBuffers[i];
+        commands.size            = sizeof(vk::DrawIndexedIndirectCommand) * meshletView.size();
+        createBuffer(commands.size,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     commands.buffer,
+                     commands.memory);
+    }
+    std::cout << "[Info] Meshlet buffers: " << meshletView.size() << " meshlets, "
+              << (meshletBufferResource.size + meshletVertexBufferResource.size + meshletTriangleBufferResource.size) / 1024 << " KiB" << std::endl;
+}
+
+void HelloTriangleApplication::createMeshletDescriptorSets() {
+    if (meshletView.empty()) return;
+
+    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *meshletCullSetLayout);
+    vk::DescriptorSetAllocateInfo allocInfo{
+        .descriptorPool = descriptorPool, .descriptorSetCount = static_cast<uint32_t>(layouts.size()), .pSetLayouts = layouts.data()};
+    meshletCullDescriptorSets = device.allocateDescriptorSets(allocInfo);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        std::array<vk::DescriptorBufferInfo, 4> bufferInfos{
+            vk::DescriptorBufferInfo{.buffer = *meshletBufferResource.buffer, .offset = 0, .range = meshletBufferResource.size},
+            vk::DescriptorBufferInfo{.buffer = *instanceTransformBuffers[i].buffer, .offset = 0, .range = instanceTransformBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *meshletCommandBuffers[i].buffer, .offset = 0, .range = meshletCommandBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *submeshInstanceBuffer.buffer, .offset = 0, .range = submeshInstanceBuffer.size}};
+        std::array<vk::WriteDescriptorSet, 4> descriptorWrites;
+        for (uint32_t b = 0; b < descriptorWrites.size(); b++) {
+            descriptorWrites[b] = vk::WriteDescriptorSet{.dstSet          = *meshletCullDescriptorSets[i],
+                                                         .dstBinding      = b,
+                                                         .dstArrayElement = 0,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                         .pBufferInfo     = &bufferInfos[b]};
+        }
+        device.updateDescriptorSets(descriptorWrites, {});
+    }
+}
+
+/**
+ * @brief record the cull dispatch, after updateTLAS() has written this frame's instance transforms
+ *
+ * Must be recorded outside of dynamic rendering; the barrier makes the commands visible to drawIndexedIndirect.
+ */
+void HelloTriangleApplication::recordMeshletCulling(const vk::raii::CommandBuffer& cmd) {
+    // Gribb/Hartmann plane extraction from the rows of proj * view; Vulkan depth is 0..1 so near is row 2 alone
+    glm::mat4 m = projectionMatrix() * camera.getViewMatrix();
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; r++) rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+    MeshletCullPushConstants constants{.frustumPlanes =
+                                           {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2]},
+                                       .cameraPosition = glm::vec4(camera.pos, 1.0f),
+                                       .meshletCount   = static_cast<uint32_t>(meshletView.size()),
+                                       .coneCulling    = 1};
+    for (glm::vec4& plane : constants.frustumPlanes) plane /= glm::length(glm::vec3(plane));
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *meshletCullPipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *meshletCullPipelineLayout, 0, *meshletCullDescriptorSets[currentFrame], nullptr);
+    cmd.pushConstants<MeshletCullPushConstants>(*meshletCullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+    cmd.dispatch((constants.meshletCount + 63) / 64, 1, 1);
+
+    vk::MemoryBarrier2 barrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                               .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                               .dstStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect,
+                               .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+}
+
+/**
+ * @brief model matrix of a submesh: the Cornell box (last submesh) is static, the bunny parts spin
+ */
+glm::mat4 HelloTriangleApplication::submeshModelMatrix(size_t index) const {
+    if (index == submeshes.size() - 1) return glm::mat4(1.0f);
+    // Rotate 90 degrees on X to make Y-Up Bunny stand in Z-Up World
+    static const glm::mat4 standUp = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    return currentModelMatrix * standUp * submeshes[index].transform;
+}
+
+glm::mat4 HelloTriangleApplication::projectionMatrix() const {
+    glm::mat4 proj = glm::perspective(
+        glm::radians(CAMERA_FOV_DEGREES), static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height), 0.1f, 100.0f);
+    proj[1][1] *= -1;
+    return proj;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief number of worker threads used by the CPU-side asset/scene builders
+ */
+inline size_t workerCount() { return std::max<size_t>(1, std::thread::hardware_concurrency()); }
+
+/**
+ * @brief split [0, count) into chunkCount contiguous chunks and run fn(chunkIndex, begin, end) for each one
+ *
+ * Chunk boundaries only depend on count and chunkCount, so passes that need a stable
+ * partition (e.g. a two-pass prefix sum) can call this twice with the same arguments.
+ */
+template <typename Fn>
+void parallelForChunks(size_t count, size_t chunkCount, Fn&& fn) {
+    chunkCount = std::max<size_t>(1, std::min(chunkCount, count));
+    if (chunkCount == 1) {
+        fn(size_t{0}, size_t{0}, count);
+        return;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(chunkCount - 1);
+    for (size_t c = 1; c < chunkCount; c++) {
+        threads.emplace_back([&fn, c, count, chunkCount] { fn(c, count * c / chunkCount, count * (c + 1) / chunkCount); });
+    }
+    // the calling thread takes the first chunk
+    fn(size_t{0}, size_t{0}, count / chunkCount);
+    for (auto& t : threads) t.join();
+}
+
+/**
+ * @brief run fn(begin, end) over [0, count) on all worker threads
+ *
+ * Small ranges (below minChunk items per thread) stay on the calling thread.
+ */
+template <typename Fn>
+void parallelFor(size_t count, Fn&& fn, size_t minChunk = 4096) {
+    size_t chunks = std::min(workerCount(), (count + minChunk - 1) / std::max<size_t>(1, minChunk));
+    parallelForChunks(count, chunks, [&fn](size_t, size_t begin, size_t end) { fn(begin, end); });
+}
+
+/**
+ * @brief run fn(i) for every item in [0, count), handing items out dynamically
+ *
+ * Meant for a few coarse, unevenly sized work items (one per submesh, one per shape).
+ */
+template <typename Fn>
+void parallelForEach(size_t count, Fn&& fn) {
+    std::atomic<size_t> next{0};
+    parallelForChunks(count, workerCount(), [&](size_t, size_t, size_t) {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) fn(i);
+    });
+}
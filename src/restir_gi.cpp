@@ -0,0 +1,245 @@
+#include "tutorial.hpp"
+
+/*
+ReSTIR GI: one-bounce indirect light for the compute pass. restir_gi.slang traces one cosine-distributed secondary
+ray per pixel from the G-buffer, fetches the hit's normal, vertex color and texture coordinate through the vertex
+and index buffer device addresses of the instance it hit (GiGeometry, indexed by instanceCustomIndex), lights it
+with one light sample and keeps the path sample (hit position, normal, reflected radiance) in a per pixel
+reservoir merged with the reprojected one of the previous frame. restir_gi_spatial.slang then merges the samples
+of nearby pixels, both reuses correcting the sample density with the Jacobian of the reconnection, and adds the
+indirect light to the direct lighting in the output image. Rays per pixel: the secondary ray, the shadow ray of
+its hit, and a visibility ray when the resolved sample came from a neighbour.
+*/
+
+// restir_gi.slang reads Vertex through its device address at fixed offsets
+static_assert(sizeof(Vertex) == 44 && offsetof(Vertex, color) == 12 && offsetof(Vertex, texCoord) == 24 && offsetof(Vertex, normal) == 32,
+              "restir_gi.slang expects the 44 byte Vertex layout");
+
+void HelloTriangleApplication::createGiPipelines() {
+    // restir_gi.slang: Binding 0-4: G-buffer position, normal, previous position, previous normal, motion vectors,
+    // 5: texture, 6: lights, 7: light alias table, 8: geometry records, 9: GI reservoirs, 10: previous GI reservoirs, 11: TLAS
+    std::array<vk::DescriptorSetLayoutBinding, 12> bindings;
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        vk::DescriptorType type = i < 6    ? vk::DescriptorType::eCombinedImageSampler
+                                  : i < 11 ? vk::DescriptorType::eStorageBuffer
+                                           : vk::DescriptorType::eAccelerationStructureKHR;
+        bindings[i] = vk::DescriptorSetLayoutBinding{
+            .binding = i, .descriptorType = type, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute};
+    }
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
+    giSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::PushConstantRange pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(GiPushConstants)};
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+        .setLayoutCount = 1, .pSetLayouts = &*giSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
+    giPipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+
+    vk::raii::ShaderModule shaderModule = createShaderModule(readFile("shaders/restir_gi.spv"));
+    vk::PipelineShaderStageCreateInfo stageInfo{.stage = vk::ShaderStageFlagBits::eCompute, .module = shaderModule, .pName = "main"};
+    giPipeline = vk::raii::Pipeline(device, nullptr, vk::ComputePipelineCreateInfo{.stage = stageInfo, .layout = giPipelineLayout});
+
+    // restir_gi_spatial.slang: Binding 0-2: G-buffer position, normal, albedo, 3: GI reservoirs, 4: output image, 5: TLAS
+    std::array<vk::DescriptorSetLayoutBinding, 6> resolveBindings;
+    for (uint32_t i = 0; i < resolveBindings.size(); i++) {
+        vk::DescriptorType type = i < 3    ? vk::DescriptorType::eCombinedImageSampler
+                                  : i == 3 ? vk::DescriptorType::eStorageBuffer
+                                  : i == 4 ? vk::DescriptorType::eStorageImage
+                                           : vk::DescriptorType::eAccelerationStructureKHR;
+        resolveBindings[i] = vk::DescriptorSetLayoutBinding{
+            .binding = i, .descriptorType = type, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute};
+    }
+    vk::DescriptorSetLayoutCreateInfo resolveLayoutInfo{.bindingCount = static_cast<uint32_t>(resolveBindings.size()),
+                                                        .pBindings    = resolveBindings.data()};
+    giResolveSetLayout = vk::raii::DescriptorSetLayout(device, resolveLayoutInfo);
+
+    vk::PushConstantRange resolveRange{.stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(GiResolvePushConstants)};
+    vk::PipelineLayoutCreateInfo resolvePipelineLayoutInfo{
+        .setLayoutCount = 1, .pSetLayouts = &*giResolveSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &resolveRange};
+    giResolvePipelineLayout = vk::raii::PipelineLayout(device, resolvePipelineLayoutInfo);
+
+    vk::raii::ShaderModule resolveModule = createShaderModule(readFile("shaders/restir_gi_spatial.spv"));
+    vk::PipelineShaderStageCreateInfo resolveStageInfo{.stage = vk::ShaderStageFlagBits::eCompute, .module = resolveModule, .pName = "main"};
+    giResolvePipeline =
+        vk::raii::Pipeline(device, nullptr, vk::ComputePipelineCreateInfo{.stage = resolveStageInfo, .layout = giResolvePipelineLayout});
+}
+
+/**
+ * @brief per frame GI reservoirs, one per pixel of the storage image; new ones hold no history
+ *
+ * Called again by recreateSwapChain() after createStorageImage().
+ */
+void HelloTriangleApplication::createGiResources() {
+    giHistoryValid = false;
+    giReservoirBuffers.clear();
+    giReservoirBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+        giReservoirBuffers[f].size = sizeof(GiReservoir) * swapChainExtent.width * std::max(swapChainExtent.height, 1u);
+        createBuffer(giReservoirBuffers[f].size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     giReservoirBuffers[f].buffer,
+                     giReservoirBuffers[f].memory);
+    }
+}
+
+/**
+ * @brief per frame geometry records, one per submesh (the instances' instanceCustomIndex)
+ *
+ * Written once: the vertex and index buffers never move, and deforming submeshes read the frame's own vertices.
+ */
+void HelloTriangleApplication::createGiGeometry() {
+    vk::DeviceAddress vertexAddr = getVertAddress(vertexBuffer);
+    vk::DeviceAddress indexAddr  = getIndexAddr(indexBuffer);
+
+    giGeometryBuffers.clear();
+    giGeometryBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    std::vector<GiGeometry> records(std::max<size_t>(1, submeshes.size()), GiGeometry{});
+    for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+        vk::DeviceAddress deformedAddr = deformedVertexBuffers.empty() ? 0 : getVertAddress(deformedVertexBuffers[f].buffer);
+        for (size_t s = 0; s < submeshes.size(); s++) {
+            bool deformed = !deformedSlot.empty() && deformedSlot[s] >= 0;
+            // the triangles the BLAS was built from, so the primitive index of a hit finds them
+            MeshLod lod = submeshes[s].lod(std::min(BLAS_LOD, submeshes[s].lodCount - 1));
+            records[s]  = GiGeometry{.vertexAddress = deformed ? deformedAddr : vertexAddr,
+                                     .indexAddress  = indexAddr + lod.indexOffset * sizeof(uint32_t),
+                                     .vertexOffset  = submeshes[s].vertexOffset};
+        }
+
+        giGeometryBuffers[f].size = sizeof(GiGeometry) * records.size();
+        createBuffer(giGeometryBuffers[f].size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     giGeometryBuffers[f].buffer,
+                     giGeometryBuffers[f].memory);
+        void* data = giGeometryBuffers[f].memory.mapMemory(0, giGeometryBuffers[f].size);
+        memcpy(data, records.data(), giGeometryBuffers[f].size);
+        giGeometryBuffers[f].memory.unmapMemory();
+    }
+}
+
+/**
+ * @brief allocated once, rewritten whenever the G-buffer or the reservoirs were recreated
+ */
+void HelloTriangleApplication::createGiDescriptorSets() {
+    if (giDescriptorSets.empty()) {
+        std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *giSetLayout);
+        vk::DescriptorSetAllocateInfo allocInfo{
+            .descriptorPool = descriptorPool, .descriptorSetCount = static_cast<uint32_t>(layouts.size()), .pSetLayouts = layouts.data()};
+        giDescriptorSets = device.allocateDescriptorSets(allocInfo);
+        std::vector<vk::DescriptorSetLayout> resolveLayouts(MAX_FRAMES_IN_FLIGHT, *giResolveSetLayout);
+        allocInfo.pSetLayouts   = resolveLayouts.data();
+        giResolveDescriptorSets = device.allocateDescriptorSets(allocInfo);
+    }
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        // temporal reuse reads what the frame recorded before this one left behind
+        size_t previous = (i + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+        auto gBufferInfo = [&](const vk::raii::ImageView& view) {
+            return vk::DescriptorImageInfo{
+                .sampler = *viking_room.textureSampler, .imageView = *view, .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+        };
+        std::array<vk::DescriptorImageInfo, 6> imageInfos{gBufferInfo(gBufferPositionImageView[i]),
+                                                          gBufferInfo(gBufferNormalImageView[i]),
+                                                          gBufferInfo(gBufferPositionImageView[previous]),
+                                                          gBufferInfo(gBufferNormalImageView[previous]),
+                                                          gBufferInfo(gBufferMotionImageView[i]),
+                                                          vk::DescriptorImageInfo{.sampler     = *viking_room.textureSampler,
+                                                                                  .imageView   = *viking_room.textureImageView,
+                                                                                  .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal}};
+        std::array<vk::DescriptorBufferInfo, 5> bufferInfos{
+            vk::DescriptorBufferInfo{.buffer = *lightBuffers[i].buffer, .offset = 0, .range = lightBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *lightAliasBufferResource.buffer, .offset = 0, .range = lightAliasBufferResource.size},
+            vk::DescriptorBufferInfo{.buffer = *giGeometryBuffers[i].buffer, .offset = 0, .range = giGeometryBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *giReservoirBuffers[i].buffer, .offset = 0, .range = giReservoirBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *giReservoirBuffers[previous].buffer, .offset = 0, .range = giReservoirBuffers[previous].size}};
+        vk::WriteDescriptorSetAccelerationStructureKHR asInfo{.accelerationStructureCount = 1, .pAccelerationStructures = &*tlas[i]};
+
+        std::array<vk::WriteDescriptorSet, 12> descriptorWrites;
+        for (uint32_t b = 0; b < 6; b++) {
+            descriptorWrites[b] = vk::WriteDescriptorSet{.dstSet          = *giDescriptorSets[i],
+                                                         .dstBinding      = b,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                                                         .pImageInfo      = &imageInfos[b]};
+        }
+        for (uint32_t b = 6; b < 11; b++) {
+            descriptorWrites[b] = vk::WriteDescriptorSet{.dstSet          = *giDescriptorSets[i],
+                                                         .dstBinding      = b,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                         .pBufferInfo     = &bufferInfos[b - 6]};
+        }
+        descriptorWrites[11] = vk::WriteDescriptorSet{.pNext           = &asInfo,
+                                                      .dstSet          = *giDescriptorSets[i],
+                                                      .dstBinding      = 11,
+                                                      .descriptorCount = 1,
+                                                      .descriptorType  = vk::DescriptorType::eAccelerationStructureKHR};
+        device.updateDescriptorSets(descriptorWrites, {});
+
+        std::array<vk::DescriptorImageInfo, 3> resolveImageInfos{
+            gBufferInfo(gBufferPositionImageView[i]), gBufferInfo(gBufferNormalImageView[i]), gBufferInfo(gBufferAlbedoImageView[i])};
+        vk::DescriptorImageInfo outputInfo{.imageView = *storageImageView[i], .imageLayout = vk::ImageLayout::eGeneral};
+        std::array<vk::WriteDescriptorSet, 6> resolveWrites;
+        for (uint32_t b = 0; b < 3; b++) {
+            resolveWrites[b] = vk::WriteDescriptorSet{.dstSet          = *giResolveDescriptorSets[i],
+                                                      .dstBinding      = b,
+                                                      .descriptorCount = 1,
+                                                      .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                                                      .pImageInfo      = &resolveImageInfos[b]};
+        }
+        resolveWrites[3] = vk::WriteDescriptorSet{.dstSet          = *giResolveDescriptorSets[i],
+                                                  .dstBinding      = 3,
+                                                  .descriptorCount = 1,
+                                                  .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                  .pBufferInfo     = &bufferInfos[3]};
+        resolveWrites[4] = vk::WriteDescriptorSet{.dstSet          = *giResolveDescriptorSets[i],
+                                                  .dstBinding      = 4,
+                                                  .descriptorCount = 1,
+                                                  .descriptorType  = vk::DescriptorType::eStorageImage,
+                                                  .pImageInfo      = &outputInfo};
+        resolveWrites[5] = vk::WriteDescriptorSet{.pNext           = &asInfo,
+                                                  .dstSet          = *giResolveDescriptorSets[i],
+                                                  .dstBinding      = 5,
+                                                  .descriptorCount = 1,
+                                                  .descriptorType  = vk::DescriptorType::eAccelerationStructureKHR};
+        device.updateDescriptorSets(resolveWrites, {});
+    }
+}
+
+/**
+ * @brief the GI sample/temporal pass and the spatial resolve, recorded once the direct lighting is in the output image
+ */
+void HelloTriangleApplication::recordIndirectLighting(const vk::raii::CommandBuffer& cmd) {
+    // the direct passes wrote the output image, the previous frame's GI pass wrote the reservoirs read here and
+    // read the ones written here
+    vk::MemoryBarrier2 computeBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                      .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                                      .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                      .dstAccessMask = vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &computeBarrier});
+
+    uint32_t groupCountX = (swapChainExtent.width + 15) / 16;
+    uint32_t groupCountY = (swapChainExtent.height + 15) / 16;
+    GiPushConstants constants{.previousCameraPosition = glm::vec4(previousCameraFrame.position, 1.0f),
+                              .previousCameraForward  = glm::vec4(previousCameraFrame.forward, 0.0f),
+                              .frameIndex             = frameIndex,
+                              .lightCount             = static_cast<uint32_t>(lights.size()),
+                              .temporalReuse          = temporalReuse && giHistoryValid ? 1u : 0u,
+                              .influenceCutoff        = LIGHT_INFLUENCE_CUTOFF};
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *giPipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *giPipelineLayout, 0, *giDescriptorSets[currentFrame], nullptr);
+    cmd.pushConstants<GiPushConstants>(*giPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+    cmd.dispatch(groupCountX, groupCountY, 1);
+    giHistoryValid = true;
+
+    // the resolve merges the reservoirs of neighbouring pixels
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &computeBarrier});
+    GiResolvePushConstants resolveConstants{.cameraPosition = glm::vec4(camera.pos, 1.0f),
+                                            .frameIndex     = frameIndex,
+                                            .neighbors      = GI_SPATIAL_NEIGHBORS,
+                                            .radius         = GI_SPATIAL_RADIUS};
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *giResolvePipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *giResolvePipelineLayout, 0, *giResolveDescriptorSets[currentFrame], nullptr);
+    cmd.pushConstants<GiResolvePushConstants>(*giResolvePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, resolveConstants);
+    cmd.dispatch(groupCountX, groupCountY, 1);
+}
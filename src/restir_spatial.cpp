@@ -0,0 +1,224 @@
+#include "tutorial.hpp"
+
+/*
+ReSTIR spatial reuse: restir_spatial.slang runs as a chain of separate dispatches after the initial and temporal
+pass of restir.slang. Each pass reads one reservoir buffer and writes the other (the frame's reservoirs and its
+scratch copy), so a pass never sees a neighbour it already updated; every pass merges k neighbours within a pixel
+radius, skipping those on a different surface. The last pass shades. An odd chain ends in the scratch buffer and is
+copied back, the next frame's temporal reuse reads the frame's reservoirs. Pass count, k, radius and the MIS weights
+are spatialReuse, changed at runtime; every pass is timed.
+*/
+
+void HelloTriangleApplication::createSpatialReusePipeline() {
+    // Binding 0-2: G-buffer position, normal, albedo, 3: lights, 4: input reservoirs, 5: output reservoirs,
+    // 6: output image, 7: TLAS
+    std::array<vk::DescriptorSetLayoutBinding, 8> bindings;
+    for (uint32_t i = 0; i < 3; i++) {
+        bindings[i] = vk::DescriptorSetLayoutBinding{.binding         = i,
+                                                     .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                                                     .descriptorCount = 1,
+                                                     .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    }
+    for (uint32_t i = 3; i < 6; i++) {
+        bindings[i] = vk::DescriptorSetLayoutBinding{.binding         = i,
+                                                     .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                     .descriptorCount = 1,
+                                                     .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    }
+    bindings[6] = vk::DescriptorSetLayoutBinding{
+        .binding = 6, .descriptorType = vk::DescriptorType::eStorageImage, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute};
+    bindings[7] = vk::DescriptorSetLayoutBinding{.binding         = 7,
+                                                 .descriptorType  = vk::DescriptorType::eAccelerationStructureKHR,
+                                                 .descriptorCount = 1,
+                                                 .stageFlags      = vk::ShaderStageFlagBits::eCompute};
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
+    spatialReuseSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::PushConstantRange pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(SpatialReusePushConstants)};
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+        .setLayoutCount = 1, .pSetLayouts = &*spatialReuseSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
+    spatialReusePipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+
+    vk::raii::ShaderModule shaderModule = createShaderModule(readFile("shaders/restir_spatial.spv"));
+    vk::PipelineShaderStageCreateInfo stageInfo{.stage = vk::ShaderStageFlagBits::eCompute, .module = shaderModule, .pName = "main"};
+    vk::ComputePipelineCreateInfo pipelineInfo{.stage = stageInfo, .layout = spatialReusePipelineLayout};
+    spatialReusePipeline = vk::raii::Pipeline(device, nullptr, pipelineInfo);
+}
+
+/**
+ * @brief per frame scratch reservoirs, the size of the frame's reservoir buffer, and the pass timestamps
+ *
+ * Called again by recreateSwapChain() after createStorageImage().
+ */
+void HelloTriangleApplication::createSpatialReuseResources() {
+    spatialReservoirBuffers.clear();
+    spatialReservoirBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+        spatialReservoirBuffers[f].size = reservoirBuffers[f].size;
+        createBuffer(spatialReservoirBuffers[f].size,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     spatialReservoirBuffers[f].buffer,
+                     spatialReservoirBuffers[f].memory);
+    }
+    spatialPassesPending.fill(0);
+
+    if (spatialTimestampQueries.empty() && physicalDevice.getQueueFamilyProperties()[queueIndex].timestampValidBits != 0) {
+        for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+            vk::QueryPoolCreateInfo queryInfo{.queryType = vk::QueryType::eTimestamp, .queryCount = MAX_SPATIAL_PASSES + 1};
+            spatialTimestampQueries.emplace_back(device, queryInfo);
+        }
+    }
+}
+
+/**
+ * @brief two sets per frame, reservoirs to scratch and back; allocated once, rewritten with the buffers and G-buffer
+ */
+void HelloTriangleApplication::createSpatialReuseDescriptorSets() {
+    if (spatialReuseDescriptorSets.empty()) {
+        std::vector<vk::DescriptorSetLayout> layouts(2 * MAX_FRAMES_IN_FLIGHT, *spatialReuseSetLayout);
+        vk::DescriptorSetAllocateInfo allocInfo{
+            .descriptorPool = descriptorPool, .descriptorSetCount = static_cast<uint32_t>(layouts.size()), .pSetLayouts = layouts.data()};
+        spatialReuseDescriptorSets = device.allocateDescriptorSets(allocInfo);
+    }
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        std::array<vk::DescriptorImageInfo, 3> gBufferInfos{
+            vk::DescriptorImageInfo{.sampler     = *viking_room.textureSampler,
+                                    .imageView   = *gBufferPositionImageView[i],
+                                    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal},
+            vk::DescriptorImageInfo{.sampler     = *viking_room.textureSampler,
+                                    .imageView   = *gBufferNormalImageView[i],
+                                    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal},
+            vk::DescriptorImageInfo{.sampler     = *viking_room.textureSampler,
+                                    .imageView   = *gBufferAlbedoImageView[i],
+                                    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal}};
+        vk::DescriptorBufferInfo lightInfo{.buffer = *lightBuffers[i].buffer, .offset = 0, .range = lightBuffers[i].size};
+        std::array<vk::DescriptorBufferInfo, 2> reservoirInfos{
+            vk::DescriptorBufferInfo{.buffer = *reservoirBuffers[i].buffer, .offset = 0, .range = reservoirBuffers[i].size},
+            vk::DescriptorBufferInfo{.buffer = *spatialReservoirBuffers[i].buffer, .offset = 0, .range = spatialReservoirBuffers[i].size}};
+        vk::DescriptorImageInfo outputInfo{.imageView = *storageImageView[i], .imageLayout = vk::ImageLayout::eGeneral};
+        vk::WriteDescriptorSetAccelerationStructureKHR asInfo{.accelerationStructureCount = 1, .pAccelerationStructures = &*tlas[i]};
+
+        // set 2i reads the reservoirs and writes the scratch buffer, set 2i + 1 the other way round
+        for (size_t direction = 0; direction < 2; direction++) {
+            vk::DescriptorSet set = *spatialReuseDescriptorSets[2 * i + direction];
+            std::array<vk::WriteDescriptorSet, 8> descriptorWrites;
+            for (uint32_t b = 0; b < 3; b++) {
+                descriptorWrites[b] = vk::WriteDescriptorSet{.dstSet          = set,
+                                                             .dstBinding      = b,
+                                                             .dstArrayElement = 0,
+                                                             .descriptorCount = 1,
+                                                             .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                                                             .pImageInfo      = &gBufferInfos[b]};
+            }
+            descriptorWrites[3] = vk::WriteDescriptorSet{.dstSet          = set,
+                                                         .dstBinding      = 3,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                         .pBufferInfo     = &lightInfo};
+            descriptorWrites[4] = vk::WriteDescriptorSet{.dstSet          = set,
+                                                         .dstBinding      = 4,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                         .pBufferInfo     = &reservoirInfos[direction]};
+            descriptorWrites[5] = vk::WriteDescriptorSet{.dstSet          = set,
+                                                         .dstBinding      = 5,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                                                         .pBufferInfo     = &reservoirInfos[1 - direction]};
+            descriptorWrites[6] = vk::WriteDescriptorSet{.dstSet          = set,
+                                                         .dstBinding      = 6,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eStorageImage,
+                                                         .pImageInfo      = &outputInfo};
+            descriptorWrites[7] = vk::WriteDescriptorSet{.pNext           = &asInfo,
+                                                         .dstSet          = set,
+                                                         .dstBinding      = 7,
+                                                         .descriptorCount = 1,
+                                                         .descriptorType  = vk::DescriptorType::eAccelerationStructureKHR};
+            device.updateDescriptorSets(descriptorWrites, {});
+        }
+    }
+}
+
+/**
+ * @brief the spatial passes, recorded right after the restir.slang dispatch wrote the frame's reservoirs
+ *
+ * The pass times of the frame's previous chain are read first, its fence has signalled by now.
+ */
+void HelloTriangleApplication::recordSpatialReuse(const vk::raii::CommandBuffer& cmd) {
+    bool timestamps = !spatialTimestampQueries.empty() && tlasTimestampMask != 0;
+    if (timestamps && spatialPassesPending[currentFrame] > 0) {
+        uint32_t passes      = spatialPassesPending[currentFrame];
+        auto [result, ticks] = spatialTimestampQueries[currentFrame].getResults<uint64_t>(
+            0, passes + 1, (passes + 1) * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (result == vk::Result::eSuccess) {
+            spatialStats.passes = passes;
+            for (uint32_t p = 0; p < passes; p++) {
+                spatialStats.gpuMs[p] = double((ticks[p + 1] - ticks[p]) & tlasTimestampMask) * tlasTimestampPeriod * 1e-6;
+            }
+        }
+    }
+    spatialPassesPending[currentFrame] = 0;
+
+    uint32_t passes = std::min(spatialReuse.passes, MAX_SPATIAL_PASSES);
+    // every pass reads what the one before wrote, and overwrites what it read
+    vk::MemoryBarrier2 passBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                   .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                                   .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                   .dstAccessMask = vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &passBarrier});
+    if (timestamps) {
+        cmd.resetQueryPool(*spatialTimestampQueries[currentFrame], 0, passes + 1);
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eComputeShader, *spatialTimestampQueries[currentFrame], 0);
+    }
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *spatialReusePipeline);
+    SpatialReusePushConstants constants{.cameraPosition  = glm::vec4(camera.pos, 1.0f),
+                                        .frameIndex      = frameIndex,
+                                        .neighbors       = std::min(spatialReuse.neighbors, MAX_SPATIAL_NEIGHBORS),
+                                        .radius          = spatialReuse.radius,
+                                        .influenceCutoff = LIGHT_INFLUENCE_CUTOFF,
+                                        .unbiased        = spatialReuse.unbiased ? 1u : 0u,
+                                        .lightCount      = static_cast<uint32_t>(lights.size())};
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        constants.pass  = pass;
+        constants.shade = pass + 1 == passes ? 1u : 0u;
+        const vk::raii::DescriptorSet& set = spatialReuseDescriptorSets[2 * currentFrame + pass % 2];
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *spatialReusePipelineLayout, 0, *set, nullptr);
+        cmd.pushConstants<SpatialReusePushConstants>(*spatialReusePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+        cmd.dispatch((swapChainExtent.width + 15) / 16, (swapChainExtent.height + 15) / 16, 1);
+        if (pass + 1 < passes) cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &passBarrier});
+        if (timestamps) cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eComputeShader, *spatialTimestampQueries[currentFrame], pass + 1);
+    }
+
+    // an odd chain left the result in the scratch buffer, the next frame's temporal reuse reads the frame's reservoirs
+    if (passes % 2 == 1) {
+        vk::MemoryBarrier2 copyBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                       .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                                       .dstStageMask  = vk::PipelineStageFlagBits2::eCopy,
+                                       .dstAccessMask = vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite};
+        cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &copyBarrier});
+        cmd.copyBuffer(*spatialReservoirBuffers[currentFrame].buffer,
+                       *reservoirBuffers[currentFrame].buffer,
+                       vk::BufferCopy{.srcOffset = 0, .dstOffset = 0, .size = reservoirBuffers[currentFrame].size});
+        vk::MemoryBarrier2 historyBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eCopy,
+                                          .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                                          .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                          .dstAccessMask = vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite};
+        cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &historyBarrier});
+    }
+    if (timestamps) spatialPassesPending[currentFrame] = passes;
+}
+
+void HelloTriangleApplication::printSpatialReuseStats() const {
+    std::cout << "[Info] ReSTIR spatial reuse: " << spatialReuse.passes << " passes, " << spatialReuse.neighbors << " neighbours within "
+              << spatialReuse.radius << " px, " << (spatialReuse.unbiased ? "unbiased" : "biased") << " MIS weights" << std::endl;
+    double total = 0.0;
+    for (uint32_t p = 0; p < spatialStats.passes; p++) {
+        std::cout << "[Info]   pass " << p << ": " << spatialStats.gpuMs[p] << " ms GPU" << std::endl;
+        total += spatialStats.gpuMs[p];
+    }
+    if (spatialStats.passes > 0) std::cout << "[Info]   total: " << total << " ms GPU" << std::endl;
+}
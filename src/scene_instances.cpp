@@ -0,0 +1,88 @@
+#include "tutorial.hpp"
+
+/*
+instance table: every entry places one submesh in the scene. The TLAS gets one instance per entry, all
+pointing at the submesh's BLAS, and the raster pass draws every submesh once with instanceCount = its
+number of entries, reading the model matrices from instanceTransformBuffers by instance index (and the previous
+frame's from instancePreviousTransformBuffers, for motion vectors).
+Memory for another copy of the bunny is one TLAS instance and one mat4 per submesh, no geometry.
+*/
+
+void HelloTriangleApplication::createSceneInstances() {
+    static_assert(BUNNY_GRID >= 1, "every submesh needs at least one instance");
+    // the last submesh is the Cornell box, everything before it is the bunny
+    const uint32_t bunnyParts = static_cast<uint32_t>(submeshes.size()) - 1;
+
+    // copies sit on a grid in the floor plane, one bunny bounding box apart
+    InstanceBounds bunny{.min = glm::vec3(std::numeric_limits<float>::max()), .max = glm::vec3(std::numeric_limits<float>::lowest())};
+    for (uint32_t s = 0; s < bunnyParts; s++) {
+        InstanceBounds part = instanceBounds(submeshes[s].transform, submeshes[s].boundingSphere);
+        bunny.min           = glm::min(bunny.min, part.min);
+        bunny.max           = glm::max(bunny.max, part.max);
+    }
+    glm::vec3 extent = bunnyParts > 0 ? bunny.max - bunny.min : glm::vec3(0.0f);
+    float spacing    = 1.25f * std::max({extent.x, extent.y, extent.z});
+    float origin     = -0.5f * spacing * static_cast<float>(BUNNY_GRID - 1);
+
+    sceneInstances.clear();
+    sceneInstances.reserve(size_t(bunnyParts) * BUNNY_GRID * BUNNY_GRID + 1);
+    submeshInstances.assign(submeshes.size(), glm::uvec2(0));
+    for (uint32_t s = 0; s < submeshes.size(); s++) {
+        submeshInstances[s].x = static_cast<uint32_t>(sceneInstances.size());
+        if (s == bunnyParts) {
+            sceneInstances.push_back({.submesh = s, .customIndex = s, .animated = false, .transform = glm::mat4(1.0f)});
+        } else {
+            for (uint32_t y = 0; y < BUNNY_GRID; y++) {
+                for (uint32_t x = 0; x < BUNNY_GRID; x++) {
+                    glm::vec3 offset(origin + spacing * static_cast<float>(x), origin + spacing * static_cast<float>(y), 0.0f);
+                    glm::mat4 placement = glm::translate(glm::mat4(1.0f), offset);
+                    sceneInstances.push_back({.submesh = s, .customIndex = s, .animated = true, .transform = placement});
+                }
+            }
+        }
+        submeshInstances[s].y = static_cast<uint32_t>(sceneInstances.size()) - submeshInstances[s].x;
+    }
+
+    submeshInstanceBuffer.size = sizeof(glm::uvec2) * submeshInstances.size();
+    createDeviceLocalBuffer(submeshInstances.data(),
+                            submeshInstanceBuffer.size,
+                            vk::BufferUsageFlagBits::eStorageBuffer,
+                            submeshInstanceBuffer.buffer,
+                            submeshInstanceBuffer.memory);
+
+    // written by updateTLAS() for the instances that moved, together with the TLAS instances
+    instanceTransformBuffers.clear();
+    instanceTransformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (BufferResource& transforms : instanceTransformBuffers) {
+        transforms.size = sizeof(glm::mat4) * sceneInstances.size();
+        createBuffer(transforms.size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     transforms.buffer,
+                     transforms.memory);
+        transforms.mapped = transforms.memory.mapMemory(0, transforms.size);
+    }
+    instancePreviousTransformBuffers.clear();
+    instancePreviousTransformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    for (BufferResource& transforms : instancePreviousTransformBuffers) {
+        transforms.size = sizeof(glm::mat4) * sceneInstances.size();
+        createBuffer(transforms.size,
+                     vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     transforms.buffer,
+                     transforms.memory);
+        transforms.mapped = transforms.memory.mapMemory(0, transforms.size);
+    }
+    // the first frame has no history to reuse, its motion vectors are never read
+    instancePreviousModels.assign(sceneInstances.size(), glm::mat4(1.0f));
+    instancePreviousDirty.resize(sceneInstances.size());
+    instancePreviousDirty.markAll();
+    std::cout << "[Info] Scene instances: " << sceneInstances.size() << " (" << BUNNY_GRID * BUNNY_GRID << " bunnies), "
+              << (sizeof(vk::AccelerationStructureInstanceKHR) + 2 * sizeof(glm::mat4)) * sceneInstances.size() * MAX_FRAMES_IN_FLIGHT / 1024
+              << " KiB of instance data" << std::endl;
+}
+
+glm::mat4 HelloTriangleApplication::sceneInstanceMatrix(uint32_t instance) const {
+    const SceneInstance& entry = sceneInstances[instance];
+    return entry.transform * submeshModelMatrix(entry.submesh);
+}
@@ -0,0 +1,264 @@
+#include "tutorial.hpp"
+
+/*
+SVGF denoiser, between the lighting passes and the blit. svgf_temporal.slang divides the lit image by the albedo
+and blends the illumination into the reprojected history of the previous frame, along with the first two moments
+of its luminance. svgf_variance.slang estimates the variance spatially where the history is still too short, and
+svgf_atrous.slang runs DENOISER_ATROUS_ITERATIONS edge-aware wavelet iterations whose taps spread 1, 2, 4, ...
+pixels apart, so the footprint grows without more taps. The first iteration's output is the next frame's color
+history, the last multiplies the albedo back in and overwrites the output image.
+*/
+
+void HelloTriangleApplication::createDenoiserPipelines() {
+    auto createPipeline = [&](const std::vector<vk::DescriptorType>& types,
+                              uint32_t pushConstantSize,
+                              const std::string& shader,
+                              vk::raii::DescriptorSetLayout& setLayout,
+                              vk::raii::PipelineLayout& pipelineLayout,
+                              vk::raii::Pipeline& pipeline) {
+        std::vector<vk::DescriptorSetLayoutBinding> bindings(types.size());
+        for (uint32_t i = 0; i < bindings.size(); i++) {
+            bindings[i] = vk::DescriptorSetLayoutBinding{
+                .binding = i, .descriptorType = types[i], .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute};
+        }
+        vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()};
+        setLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+        vk::PushConstantRange pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = pushConstantSize};
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+            .setLayoutCount = 1, .pSetLayouts = &*setLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange};
+        pipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+
+        vk::raii::ShaderModule shaderModule = createShaderModule(readFile(shader));
+        vk::PipelineShaderStageCreateInfo stageInfo{.stage = vk::ShaderStageFlagBits::eCompute, .module = shaderModule, .pName = "main"};
+        pipeline = vk::raii::Pipeline(device, nullptr, vk::ComputePipelineCreateInfo{.stage = stageInfo, .layout = pipelineLayout});
+    };
+    constexpr vk::DescriptorType storage = vk::DescriptorType::eStorageImage;
+    constexpr vk::DescriptorType sampled = vk::DescriptorType::eCombinedImageSampler;
+
+    // svgf_temporal.slang: Binding 0: output image, 1-6: G-buffer position, normal, albedo, motion vectors, previous
+    // position, previous normal, 7-8: previous color history and moments, 9: integrated color, 10: moments
+    createPipeline({storage, sampled, sampled, sampled, sampled, sampled, sampled, storage, storage, storage, storage},
+                   sizeof(DenoiserTemporalPushConstants),
+                   "shaders/svgf_temporal.spv",
+                   denoiserTemporalSetLayout,
+                   denoiserTemporalPipelineLayout,
+                   denoiserTemporalPipeline);
+    // svgf_variance.slang: Binding 0: integrated color, 1: moments, 2-3: G-buffer position, normal, 4: filter input
+    createPipeline({storage, storage, sampled, sampled, storage},
+                   sizeof(DenoiserFilterPushConstants),
+                   "shaders/svgf_variance.spv",
+                   denoiserVarianceSetLayout,
+                   denoiserVariancePipelineLayout,
+                   denoiserVariancePipeline);
+    // svgf_atrous.slang: Binding 0: input, 1: output, 2: color history, 3: output image, 4-6: G-buffer position, normal, albedo
+    createPipeline({storage, storage, storage, storage, sampled, sampled, sampled},
+                   sizeof(DenoiserFilterPushConstants),
+                   "shaders/svgf_atrous.spv",
+                   denoiserAtrousSetLayout,
+                   denoiserAtrousPipelineLayout,
+                   denoiserAtrousPipeline);
+}
+
+/**
+ * @brief per frame history, moments and ping-pong images the size of the storage image, and the pass timestamps;
+ * new ones hold no history
+ *
+ * Called again by recreateSwapChain() after createStorageImage().
+ */
+void HelloTriangleApplication::createDenoiserResources() {
+    denoiserHistoryValid = false;
+    denoiserImageViews.clear();
+    denoiserImages.clear();
+    denoiserImageMemory.clear();
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT * DENOISER_IMAGE_COUNT; i++) {
+        vk::raii::Image img     = nullptr;
+        GpuAllocation imgMemory = nullptr;
+        createImage(swapChainExtent.width, std::max(swapChainExtent.height, 1u), vk::Format::eR32G32B32A32Sfloat, vk::ImageTiling::eOptimal,
+                    vk::ImageUsageFlagBits::eStorage, vk::MemoryPropertyFlagBits::eDeviceLocal, img, imgMemory);
+        denoiserImageViews.push_back(createImageView(img, vk::Format::eR32G32B32A32Sfloat, vk::ImageAspectFlagBits::eColor));
+        transitionImageLayout(*img, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, vk::AccessFlagBits2::eNone,
+                              vk::AccessFlagBits2::eShaderWrite, vk::PipelineStageFlagBits2::eTopOfPipe,
+                              vk::PipelineStageFlagBits2::eComputeShader, vk::ImageAspectFlagBits::eColor);
+        denoiserImages.push_back(std::move(img));
+        denoiserImageMemory.push_back(std::move(imgMemory));
+    }
+
+    if (denoiserTimestampQueries.empty() && physicalDevice.getQueueFamilyProperties()[queueIndex].timestampValidBits != 0) {
+        for (size_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+            vk::QueryPoolCreateInfo queryInfo{.queryType = vk::QueryType::eTimestamp, .queryCount = DENOISER_ATROUS_ITERATIONS + 3};
+            denoiserTimestampQueries.emplace_back(device, queryInfo);
+        }
+    }
+}
+
+/**
+ * @brief one temporal and one variance set per frame, two a-trous sets (pong to ping and back); allocated once,
+ * rewritten with the images and G-buffer
+ */
+void HelloTriangleApplication::createDenoiserDescriptorSets() {
+    if (denoiserTemporalDescriptorSets.empty()) {
+        std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *denoiserTemporalSetLayout);
+        vk::DescriptorSetAllocateInfo allocInfo{
+            .descriptorPool = descriptorPool, .descriptorSetCount = static_cast<uint32_t>(layouts.size()), .pSetLayouts = layouts.data()};
+        denoiserTemporalDescriptorSets = device.allocateDescriptorSets(allocInfo);
+        std::vector<vk::DescriptorSetLayout> varianceLayouts(MAX_FRAMES_IN_FLIGHT, *denoiserVarianceSetLayout);
+        allocInfo.pSetLayouts          = varianceLayouts.data();
+        denoiserVarianceDescriptorSets = device.allocateDescriptorSets(allocInfo);
+        std::vector<vk::DescriptorSetLayout> atrousLayouts(2 * MAX_FRAMES_IN_FLIGHT, *denoiserAtrousSetLayout);
+        allocInfo.descriptorSetCount = static_cast<uint32_t>(atrousLayouts.size());
+        allocInfo.pSetLayouts        = atrousLayouts.data();
+        denoiserAtrousDescriptorSets = device.allocateDescriptorSets(allocInfo);
+    }
+
+    auto gBufferInfo = [&](const vk::raii::ImageView& view) {
+        return vk::DescriptorImageInfo{
+            .sampler = *viking_room.textureSampler, .imageView = *view, .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+    };
+    auto storageInfo = [](const vk::raii::ImageView& view) {
+        return vk::DescriptorImageInfo{.imageView = *view, .imageLayout = vk::ImageLayout::eGeneral};
+    };
+    // one write per binding, the binding types in the order of the set layout
+    auto writeSet = [&](const vk::raii::DescriptorSet& set, const std::vector<vk::DescriptorImageInfo>& infos) {
+        std::vector<vk::WriteDescriptorSet> writes(infos.size());
+        for (uint32_t b = 0; b < infos.size(); b++) {
+            writes[b] = vk::WriteDescriptorSet{.dstSet          = *set,
+                                               .dstBinding      = b,
+                                               .descriptorCount = 1,
+                                               .descriptorType  = infos[b].sampler ? vk::DescriptorType::eCombinedImageSampler
+                                                                                   : vk::DescriptorType::eStorageImage,
+                                               .pImageInfo      = &infos[b]};
+        }
+        device.updateDescriptorSets(writes, {});
+    };
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        // the history is what the frame recorded before this one left behind
+        size_t previous = (i + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+        auto image      = [&](size_t frame, DenoiserImage which) -> const vk::raii::ImageView& {
+            return denoiserImageViews[frame * DENOISER_IMAGE_COUNT + which];
+        };
+
+        writeSet(denoiserTemporalDescriptorSets[i],
+                 {storageInfo(storageImageView[i]),
+                  gBufferInfo(gBufferPositionImageView[i]),
+                  gBufferInfo(gBufferNormalImageView[i]),
+                  gBufferInfo(gBufferAlbedoImageView[i]),
+                  gBufferInfo(gBufferMotionImageView[i]),
+                  gBufferInfo(gBufferPositionImageView[previous]),
+                  gBufferInfo(gBufferNormalImageView[previous]),
+                  storageInfo(image(previous, DenoiserColorHistory)),
+                  storageInfo(image(previous, DenoiserMoments)),
+                  storageInfo(image(i, DenoiserPing)),
+                  storageInfo(image(i, DenoiserMoments))});
+        writeSet(denoiserVarianceDescriptorSets[i],
+                 {storageInfo(image(i, DenoiserPing)),
+                  storageInfo(image(i, DenoiserMoments)),
+                  gBufferInfo(gBufferPositionImageView[i]),
+                  gBufferInfo(gBufferNormalImageView[i]),
+                  storageInfo(image(i, DenoiserPong))});
+        for (size_t direction = 0; direction < 2; direction++) {
+            DenoiserImage input  = direction == 0 ? DenoiserPong : DenoiserPing;
+            DenoiserImage output = direction == 0 ? DenoiserPing : DenoiserPong;
+            writeSet(denoiserAtrousDescriptorSets[2 * i + direction],
+                     {storageInfo(image(i, input)),
+                      storageInfo(image(i, output)),
+                      storageInfo(image(i, DenoiserColorHistory)),
+                      storageInfo(storageImageView[i]),
+                      gBufferInfo(gBufferPositionImageView[i]),
+                      gBufferInfo(gBufferNormalImageView[i]),
+                      gBufferInfo(gBufferAlbedoImageView[i])});
+        }
+    }
+}
+
+/**
+ * @brief temporal accumulation, variance estimation and the a-trous iterations, recorded once the lighting is in
+ * the output image
+ */
+void HelloTriangleApplication::recordDenoiser(const vk::raii::CommandBuffer& cmd) {
+    // the timestamps this frame slot wrote MAX_FRAMES_IN_FLIGHT frames ago, its fence has signalled
+    constexpr uint32_t queryCount = DENOISER_ATROUS_ITERATIONS + 3;
+    bool timestamps               = !denoiserTimestampQueries.empty() && tlasTimestampMask != 0;
+    if (timestamps && denoiserTimestampsPending[currentFrame]) {
+        auto [result, ticks] = denoiserTimestampQueries[currentFrame].getResults<uint64_t>(
+            0, queryCount, queryCount * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (result == vk::Result::eSuccess) {
+            denoiserStats.measured = true;
+            for (uint32_t p = 0; p + 1 < queryCount; p++) {
+                denoiserStats.gpuMs[p] = double((ticks[p + 1] - ticks[p]) & tlasTimestampMask) * tlasTimestampPeriod * 1e-6;
+            }
+        }
+    }
+    denoiserTimestampsPending[currentFrame] = false;
+
+    // every pass reads what the one before wrote; the previous frame's passes wrote the history read here and read
+    // the images overwritten here
+    vk::MemoryBarrier2 passBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                   .srcAccessMask = vk::AccessFlagBits2::eShaderWrite,
+                                   .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                   .dstAccessMask = vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite};
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &passBarrier});
+    if (timestamps) {
+        cmd.resetQueryPool(*denoiserTimestampQueries[currentFrame], 0, queryCount);
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eComputeShader, *denoiserTimestampQueries[currentFrame], 0);
+    }
+
+    uint32_t groupCountX = (swapChainExtent.width + 15) / 16;
+    uint32_t groupCountY = (swapChainExtent.height + 15) / 16;
+    DenoiserTemporalPushConstants temporalConstants{.previousCameraPosition = glm::vec4(previousCameraFrame.position, 1.0f),
+                                                    .previousCameraForward  = glm::vec4(previousCameraFrame.forward, 0.0f),
+                                                    .colorAlpha             = DENOISER_COLOR_ALPHA,
+                                                    .momentsAlpha           = DENOISER_MOMENTS_ALPHA,
+                                                    .historyValid           = denoiserHistoryValid ? 1u : 0u};
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *denoiserTemporalPipeline);
+    cmd.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute, *denoiserTemporalPipelineLayout, 0, *denoiserTemporalDescriptorSets[currentFrame], nullptr);
+    cmd.pushConstants<DenoiserTemporalPushConstants>(*denoiserTemporalPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, temporalConstants);
+    cmd.dispatch(groupCountX, groupCountY, 1);
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &passBarrier});
+    if (timestamps) cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eComputeShader, *denoiserTimestampQueries[currentFrame], 1);
+
+    DenoiserFilterPushConstants filterConstants{.cameraPosition = glm::vec4(camera.pos, 1.0f), .phiColor = DENOISER_PHI_COLOR};
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *denoiserVariancePipeline);
+    cmd.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute, *denoiserVariancePipelineLayout, 0, *denoiserVarianceDescriptorSets[currentFrame], nullptr);
+    cmd.pushConstants<DenoiserFilterPushConstants>(*denoiserVariancePipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, filterConstants);
+    cmd.dispatch(groupCountX, groupCountY, 1);
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &passBarrier});
+    if (timestamps) cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eComputeShader, *denoiserTimestampQueries[currentFrame], 2);
+
+    // the variance pass wrote pong, the iterations go pong to ping, ping to pong, ...
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *denoiserAtrousPipeline);
+    for (uint32_t iteration = 0; iteration < DENOISER_ATROUS_ITERATIONS; iteration++) {
+        filterConstants.stepSize     = 1 << iteration;
+        filterConstants.writeHistory = iteration == 0 ? 1u : 0u;
+        filterConstants.finalPass    = iteration + 1 == DENOISER_ATROUS_ITERATIONS ? 1u : 0u;
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                               *denoiserAtrousPipelineLayout,
+                               0,
+                               *denoiserAtrousDescriptorSets[2 * currentFrame + iteration % 2],
+                               nullptr);
+        cmd.pushConstants<DenoiserFilterPushConstants>(*denoiserAtrousPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, filterConstants);
+        cmd.dispatch(groupCountX, groupCountY, 1);
+        if (iteration + 1 < DENOISER_ATROUS_ITERATIONS) {
+            cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &passBarrier});
+        }
+        if (timestamps) cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eComputeShader, *denoiserTimestampQueries[currentFrame], iteration + 3);
+    }
+    denoiserHistoryValid = true;
+    if (timestamps) denoiserTimestampsPending[currentFrame] = true;
+}
+
+void HelloTriangleApplication::printDenoiserStats() const {
+    std::cout << "[Info] SVGF denoiser: " << (denoiserEnabled ? "on" : "off") << ", " << DENOISER_ATROUS_ITERATIONS
+              << " a-trous iterations, history blend " << DENOISER_COLOR_ALPHA << std::endl;
+    if (!denoiserStats.measured) return;
+    double total = 0.0;
+    for (uint32_t p = 0; p < denoiserStats.gpuMs.size(); p++) {
+        std::string pass = p == 0 ? "temporal" : p == 1 ? "variance" : "a-trous " + std::to_string(p - 2);
+        std::cout << "[Info]   " << pass << ": " << denoiserStats.gpuMs[p] << " ms GPU" << std::endl;
+        total += denoiserStats.gpuMs[p];
+    }
+    std::cout << "[Info]   total: " << total << " ms GPU" << std::endl;
+}
@@ -68,8 +68,16 @@ void HelloTriangleApplication::recreateSwapChain() {
     createDepthResources();
     createGbufferResources();
     createStorageImage();
+    createClusterResources();
+    createSpatialReuseResources();
+    createGiResources();
+    createDenoiserResources();
     createDescriptorSets();
     createComputeDescriptorSets();
+    createClusterDescriptorSets();
+    createSpatialReuseDescriptorSets();
+    createGiDescriptorSets();
+    createDenoiserDescriptorSets();
 }
 void HelloTriangleApplication::cleanupSwapChain() {
     swapChainImageViews.clear();
@@ -96,6 +104,10 @@ void HelloTriangleApplication::cleanupSwapChain() {
     gBufferAlbedoImage.clear();
     gBufferAlbedoImageMemory.clear();
 
+    gBufferMotionImageView.clear();
+    gBufferMotionImage.clear();
+    gBufferMotionImageMemory.clear();
+
     storageImageView.clear();
     storageImage.clear();
     storageImageMemory.clear();
@@ -30,27 +30,6 @@ void HelloTriangleApplication::createTextureImage() {
     unsigned char pixels[] = {255, 255, 255, 255};
 
     vk::DeviceSize imageSize = 4;  // 1 pixel * 4 bytes
-    // create staging buffer in host visible memory
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    // this buffer should be in host visible memory so that we can map it as a transfer source to
-    // copy to the image
-    createBuffer(imageSize,
-                 vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                 stagingBuffer,
-                 stagingBufferMemory);
-
-    // copy pixel data "from image" to "staging buffer"
-    void* data = stagingBufferMemory.mapMemory(0, imageSize);
-    memcpy(data, pixels, imageSize);
-    stagingBufferMemory.unmapMemory();
-    // free image memory loaded by stb_image
-    // stbi_image_free(pixels);
-
-    // better to access pixel value(now in the staging buffer) by using image object(Pixels within
-    // an image object are known as texels)
-
     createImage(texWidth,
                 texHeight,
                 vk::Format::eR8G8B8A8Srgb,
@@ -60,10 +39,16 @@ void HelloTriangleApplication::createTextureImage() {
                 viking_room.textureImage,
                 viking_room.textureImageMemory);
 
-    //  The last thing we did there was creating the texture image object, but it is still empty!
-    // Now we need to copy the pixel data from the staging buffer to the image object.
+    // The texture image object is still empty: the upload manager stages the pixels and records the copy
+    // between the two layout transitions, all in the same batch.
     transitionImageLayout(viking_room.textureImage, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-    copyBufferToImage(stagingBuffer, viking_room.textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+    uploads.uploadImage(*viking_room.textureImage,
+                        {static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1},
+                        vk::ImageAspectFlagBits::eColor,
+                        pixels,
+                        imageSize);
+    // free image memory loaded by stb_image
+    // stbi_image_free(pixels);
     transitionImageLayout(viking_room.textureImage, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
 }
 /**
@@ -101,31 +86,6 @@ void HelloTriangleApplication::transitionImageLayout(const vk::raii::Image& imag
     transitionImageLayout(*image, oldLayout, newLayout, srcAccessMask, dstAccessMask, srcStageMask, dstStageMask, aspectMask);
 }
 
-/**
- * @brief Copy data from a buffer to an image
- *
- * @param buffer
- * @param image
- * @param width
- * @param height
- */
-void HelloTriangleApplication::copyBufferToImage(const vk::raii::Buffer& buffer, vk::raii::Image& image, uint32_t width, uint32_t height) {
-    /*before we can use the image as a texture in shader, we need to copy the pixel data from the
-     * staging buffer to the image object*/
-    std::unique_ptr<vk::raii::CommandBuffer> commandBuffer = beginSingleTimeCommands();
-
-    vk::BufferImageCopy region{.bufferOffset      = 0,
-                               .bufferRowLength   = 0,
-                               .bufferImageHeight = 0,
-                               .imageSubresource  = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
-                               .imageOffset       = {0, 0, 0},
-                               .imageExtent       = {width, height, 1}};
-
-    commandBuffer->copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, {region});
-
-    endSingleTimeCommands(*commandBuffer);
-}
-
 /**
  * @brief create texture image view
  * call createImageView helper function
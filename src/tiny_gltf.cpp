@@ -0,0 +1,6 @@
+#define TINYGLTF_IMPLEMENTATION
+// images are never decoded (see loadGltfModel) and we never write glTF files
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include <tiny_gltf.h>
@@ -0,0 +1,44 @@
+#include "tlas_policy.hpp"
+
+namespace {
+
+float surfaceArea(const InstanceBounds& b) {
+    glm::vec3 d = glm::max(b.max - b.min, glm::vec3(0.0f));
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+}  // namespace
+
+InstanceBounds instanceBounds(const glm::mat4& model, const glm::vec4& sphere) {
+    glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f));
+    // box of the transformed cube [center - r, center + r]: |M| * r per axis
+    glm::vec3 extent = sphere.w * (glm::abs(glm::vec3(model[0])) + glm::abs(glm::vec3(model[1])) + glm::abs(glm::vec3(model[2])));
+    return {center - extent, center + extent};
+}
+
+void TlasUpdateStats::print(std::ostream& out) const {
+    const char* modeNames[] = {"skip", "refit", "rebuild"};
+    out << "[Info] TLAS: last update " << modeNames[static_cast<uint32_t>(mode)] << " (" << dirtyInstances << " dirty instances, area growth "
+        << areaGrowth << ", " << refitsSinceBuild << " refits since build, GPU " << gpuMs << " ms), totals: " << rebuilds << " rebuilds, "
+        << refits << " refits, " << skips << " skipped" << std::endl;
+}
+
+void TlasRefitPolicy::rebuilt(const std::vector<InstanceBounds>& bounds) {
+    buildBounds = bounds;
+    instanceUnionArea.resize(bounds.size());
+    buildArea = 0.0;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        instanceUnionArea[i] = surfaceArea(bounds[i]);
+        buildArea += instanceUnionArea[i];
+    }
+    unionArea  = buildArea;
+    refitCount = 0;
+}
+
+void TlasRefitPolicy::moved(uint32_t instance, const InstanceBounds& bounds) {
+    if (instance >= buildBounds.size()) return;
+    const InstanceBounds& built = buildBounds[instance];
+    float area                  = surfaceArea({glm::min(built.min, bounds.min), glm::max(built.max, bounds.max)});
+    unionArea += double(area) - double(instanceUnionArea[instance]);
+    instanceUnionArea[instance] = area;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+enum class TlasUpdateMode : uint32_t { Skip, Refit, Rebuild };
+
+// what the last TLAS update did, plus totals since startup
+struct TlasUpdateStats {
+    TlasUpdateMode mode       = TlasUpdateMode::Skip;
+    uint32_t dirtyInstances   = 0;
+    float areaGrowth          = 0.0f;  // of the updated TLAS, before a rebuild reset it
+    uint32_t refitsSinceBuild = 0;
+    double gpuMs              = 0.0;   // last measured update (timestamps are read one frame cycle later)
+    uint64_t rebuilds         = 0;
+    uint64_t refits           = 0;
+    uint64_t skips            = 0;
+
+    void print(std::ostream& out) const;
+};
+
+struct InstanceBounds {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+};
+
+// world-space box around a bounding sphere (xyz center, w radius) placed by model; grows with rotation like the BLAS box does
+InstanceBounds instanceBounds(const glm::mat4& model, const glm::vec4& sphere);
+
+/**
+ * @brief decides per TLAS update whether a refit is still good enough or a full build is due
+ *
+ * A refit keeps the BVH topology of the last build, so every node has to stretch over wherever its
+ * instances went since then. The policy tracks that with one number: the summed surface area of
+ * union(bounds at build, current bounds) over all instances, relative to the summed area at build time.
+ * moved() updates it in O(1) per instance, so the CPU cost follows the number of instances that moved.
+ * A rebuild is due once the area has grown by more than maxAreaGrowth or after maxRefits refits.
+ */
+class TlasRefitPolicy {
+   public:
+    struct Settings {
+        float maxAreaGrowth;
+        uint32_t maxRefits;
+    };
+
+    TlasRefitPolicy() : TlasRefitPolicy(Settings{.maxAreaGrowth = 0.5f, .maxRefits = 1800}) {}
+    explicit TlasRefitPolicy(Settings settings) : settings(settings) {}
+
+    // a full build from these bounds (one per instance) just happened
+    void rebuilt(const std::vector<InstanceBounds>& bounds);
+    // instance moved to bounds (call before the refit that picks the new transform up)
+    void moved(uint32_t instance, const InstanceBounds& bounds);
+    void refitted() { refitCount++; }
+
+    bool shouldRebuild() const { return buildBounds.empty() || areaGrowth() > settings.maxAreaGrowth || refitCount >= settings.maxRefits; }
+    // 0 right after a build, 1 = the refitted boxes cover twice the area
+    float areaGrowth() const { return buildArea > 0.0 ? float(unionArea / buildArea - 1.0) : 0.0f; }
+    uint32_t refitsSinceBuild() const { return refitCount; }
+
+   private:
+    Settings settings;
+    std::vector<InstanceBounds> buildBounds;
+    std::vector<float> instanceUnionArea;  // area of union(build bounds, current bounds) per instance
+    double buildArea    = 0.0;
+    double unionArea    = 0.0;
+    uint32_t refitCount = 0;
+};
@@ -0,0 +1,185 @@
+#include "tlsf_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+
+void TlsfAllocator::reset(uint64_t capacity) {
+    blocks.clear();
+    unusedBlocks.clear();
+    for (auto& row : heads) std::fill(std::begin(row), std::end(row), INVALID);
+    std::fill(std::begin(slBitmap), std::end(slBitmap), 0u);
+    flBitmap        = 0;
+    totalSize       = capacity;
+    usedSize        = 0;
+    allocationCount = 0;
+    if (capacity == 0) return;
+
+    uint32_t block     = newBlock();
+    blocks[block].size = capacity;
+    blocks[block].free = true;
+    insertFree(block);
+}
+
+/**
+ * @brief size class of a block: fl = power of two, sl = linear step inside it
+ *
+ * Sizes below SL_COUNT share the first row with a step of one byte.
+ */
+void TlsfAllocator::mapping(uint64_t size, uint32_t& fl, uint32_t& sl) {
+    if (size < SL_COUNT) {
+        fl = 0;
+        sl = static_cast<uint32_t>(size);
+        return;
+    }
+    const uint32_t msb = 63 - static_cast<uint32_t>(std::countl_zero(size));
+    fl                 = msb - SL_LOG2 + 1;
+    sl                 = static_cast<uint32_t>(size >> (msb - SL_LOG2)) - SL_COUNT;
+}
+
+uint32_t TlsfAllocator::newBlock() {
+    if (!unusedBlocks.empty()) {
+        uint32_t block = unusedBlocks.back();
+        unusedBlocks.pop_back();
+        blocks[block] = Block{};
+        return block;
+    }
+    blocks.emplace_back();
+    return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void TlsfAllocator::insertFree(uint32_t block) {
+    uint32_t fl, sl;
+    mapping(blocks[block].size, fl, sl);
+    blocks[block].prevFree = INVALID;
+    blocks[block].nextFree = heads[fl][sl];
+    if (heads[fl][sl] != INVALID) blocks[heads[fl][sl]].prevFree = block;
+    heads[fl][sl] = block;
+    flBitmap |= 1ull << fl;
+    slBitmap[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::removeFree(uint32_t block) {
+    uint32_t fl, sl;
+    mapping(blocks[block].size, fl, sl);
+    const Block& b = blocks[block];
+    if (b.prevFree != INVALID) blocks[b.prevFree].nextFree = b.nextFree;
+    if (b.nextFree != INVALID) blocks[b.nextFree].prevFree = b.prevFree;
+    if (heads[fl][sl] == block) {
+        heads[fl][sl] = b.nextFree;
+        if (heads[fl][sl] == INVALID) {
+            slBitmap[fl] &= ~(1u << sl);
+            if (slBitmap[fl] == 0) flBitmap &= ~(1ull << fl);
+        }
+    }
+}
+
+/**
+ * @brief a free block of at least size bytes, or INVALID
+ *
+ * Good fit: the size is rounded up to the next size class, so any block in that class or above fits.
+ */
+uint32_t TlsfAllocator::findFree(uint64_t size) const {
+    if (size >= SL_COUNT) {
+        const uint32_t msb   = 63 - static_cast<uint32_t>(std::countl_zero(size));
+        const uint64_t round = (1ull << (msb - SL_LOG2)) - 1;
+        if (size > ~0ull - round) return INVALID;
+        size += round;
+    }
+    uint32_t fl, sl;
+    mapping(size, fl, sl);
+    if (fl >= FL_COUNT) return INVALID;
+
+    uint32_t slMap = slBitmap[fl] & (~0u << sl);
+    if (slMap == 0) {
+        const uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0) return INVALID;
+        fl    = static_cast<uint32_t>(std::countr_zero(flMap));
+        slMap = slBitmap[fl];
+    }
+    sl = static_cast<uint32_t>(std::countr_zero(slMap));
+    return heads[fl][sl];
+}
+
+void TlsfAllocator::splitTail(uint32_t block, uint64_t size) {
+    if (blocks[block].size == size) return;
+    uint32_t tail = newBlock();  // may reallocate blocks, index again below
+    Block& b      = blocks[block];
+    Block& t      = blocks[tail];
+    t.offset      = b.offset + size;
+    t.size        = b.size - size;
+    t.prevPhys    = block;
+    t.nextPhys    = b.nextPhys;
+    t.free        = true;
+    if (b.nextPhys != INVALID) blocks[b.nextPhys].prevPhys = tail;
+    b.nextPhys = tail;
+    b.size     = size;
+    insertFree(tail);
+}
+
+TlsfAllocator::Allocation TlsfAllocator::allocate(uint64_t size, uint64_t alignment) {
+    if (size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0) return {};
+    // any block this large fits the size after moving its start up to the alignment
+    const uint64_t request = size + alignment - 1;
+    if (request < size) return {};
+    uint32_t block = findFree(request);
+    if (block == INVALID) return {};
+    removeFree(block);
+
+    const uint64_t padding = ((blocks[block].offset + alignment - 1) & ~(alignment - 1)) - blocks[block].offset;
+    if (padding > 0) {
+        // the padding stays behind as a free block; its front neighbour cannot be free, free neighbours are always merged
+        splitTail(block, padding);
+        insertFree(block);
+        block = blocks[block].nextPhys;
+        removeFree(block);
+    }
+    splitTail(block, size);
+    blocks[block].free = false;
+    usedSize += blocks[block].size;
+    allocationCount++;
+    return {blocks[block].offset, size, block};
+}
+
+void TlsfAllocator::free(uint32_t id) {
+    if (id >= blocks.size() || blocks[id].free) return;
+    usedSize -= blocks[id].size;
+    allocationCount--;
+    blocks[id].free = true;
+
+    // merge with the free neighbours so free space never stays split at a boundary
+    uint32_t next = blocks[id].nextPhys;
+    if (next != INVALID && blocks[next].free) {
+        removeFree(next);
+        blocks[id].size += blocks[next].size;
+        blocks[id].nextPhys = blocks[next].nextPhys;
+        if (blocks[id].nextPhys != INVALID) blocks[blocks[id].nextPhys].prevPhys = id;
+        unusedBlocks.push_back(next);
+    }
+    uint32_t prev = blocks[id].prevPhys;
+    if (prev != INVALID && blocks[prev].free) {
+        removeFree(prev);
+        blocks[prev].size += blocks[id].size;
+        blocks[prev].nextPhys = blocks[id].nextPhys;
+        if (blocks[prev].nextPhys != INVALID) blocks[blocks[prev].nextPhys].prevPhys = prev;
+        unusedBlocks.push_back(id);
+        id = prev;
+    }
+    insertFree(id);
+}
+
+TlsfAllocator::Stats TlsfAllocator::stats() const {
+    Stats stats;
+    stats.capacity        = totalSize;
+    stats.usedBytes       = usedSize;
+    stats.freeBytes       = totalSize - usedSize;
+    stats.allocationCount = allocationCount;
+    for (uint32_t fl = 0; fl < FL_COUNT; fl++) {
+        for (uint32_t sl = 0; sl < SL_COUNT; sl++) {
+            for (uint32_t block = heads[fl][sl]; block != INVALID; block = blocks[block].nextFree) {
+                stats.freeBlockCount++;
+                stats.largestFreeBlock = std::max(stats.largestFreeBlock, blocks[block].size);
+            }
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief two-level segregated fit (TLSF) allocator over an abstract range [0, capacity)
+ *
+ * Only offsets are handed out, nothing is read or written, so the same code manages a
+ * vk::DeviceMemory block in GpuAllocator and can be exercised on the CPU alone.
+ * Allocation and free are O(1): free blocks sit in size-class lists found through two
+ * bitmaps, and a freed block is merged with its free physical neighbours immediately.
+ */
+class TlsfAllocator {
+   public:
+    static constexpr uint32_t INVALID = ~0u;
+
+    struct Allocation {
+        uint64_t offset = 0;
+        uint64_t size   = 0;        // requested size; the block may be a little larger
+        uint32_t id     = INVALID;  // pass to free()
+        bool valid() const { return id != INVALID; }
+    };
+
+    struct Stats {
+        uint64_t capacity         = 0;
+        uint64_t usedBytes        = 0;  // including alignment padding absorbed by blocks
+        uint64_t freeBytes        = 0;
+        uint64_t largestFreeBlock = 0;
+        uint32_t allocationCount  = 0;
+        uint32_t freeBlockCount   = 0;
+        // 0 = all free space is one block, towards 1 = free space is scattered in small pieces
+        float fragmentation() const { return freeBytes ? 1.0f - float(largestFreeBlock) / float(freeBytes) : 0.0f; }
+    };
+
+    explicit TlsfAllocator(uint64_t capacity = 0) { reset(capacity); }
+
+    // forget every allocation and manage [0, capacity) as one free block
+    void reset(uint64_t capacity);
+
+    // alignment must be a power of two; returns an invalid allocation if no free block fits
+    Allocation allocate(uint64_t size, uint64_t alignment);
+    void free(uint32_t id);
+
+    uint64_t capacity() const { return totalSize; }
+    bool empty() const { return allocationCount == 0; }
+    Stats stats() const;
+
+   private:
+    static constexpr uint32_t SL_LOG2  = 4;  // 16 linear subdivisions per power of two
+    static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+    static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+
+    struct Block {
+        uint64_t offset   = 0;
+        uint64_t size     = 0;
+        uint32_t prevPhys = INVALID;  // neighbours in address order
+        uint32_t nextPhys = INVALID;
+        uint32_t prevFree = INVALID;  // neighbours in the size-class list (free blocks only)
+        uint32_t nextFree = INVALID;
+        bool free         = false;
+    };
+
+    static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+    uint32_t newBlock();
+    void insertFree(uint32_t block);
+    void removeFree(uint32_t block);
+    uint32_t findFree(uint64_t size) const;
+    // split [offset, offset + size) off the front of a block, the rest becomes a new free block
+    void splitTail(uint32_t block, uint64_t size);
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> unusedBlocks;  // recycled entries of blocks
+    uint32_t heads[FL_COUNT][SL_COUNT];
+    uint64_t flBitmap = 0;
+    uint32_t slBitmap[FL_COUNT];
+    uint64_t totalSize       = 0;
+    uint64_t usedSize        = 0;
+    uint32_t allocationCount = 0;
+};
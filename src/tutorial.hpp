@@ -10,10 +10,21 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
+#include "alias_table.hpp"
+#include "as_cache.hpp"
 #include "camera.hpp"
+#include "dirty_ranges.hpp"
+#include "gpu_allocator.hpp"
+#include "hash.hpp"
+#include "light_tree.hpp"
+#include "mesh_cache.hpp"
+#include "tlas_policy.hpp"
+#include "upload_manager.hpp"
+#include "vertex_packing.hpp"
 
 #if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULES)
 #include <vulkan/vulkan_raii.hpp>
@@ -37,8 +48,89 @@ import vulkan_hpp;
 constexpr uint32_t WIDTH           = 800;
 constexpr uint32_t HEIGHT          = 600;
 const std::string MODEL_PATH       = "../../../../model/bunny.obj";
+const std::string MESH_CACHE_PATH  = "../../../../model/bunny.vkmesh";
+const std::string AS_CACHE_PATH    = "../../../../model/bunny.vkas";
 const std::string TEXTURE_PATH     = "../../../../textures/viking_room.png";
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+// weld OBJ vertices on all cores (same output as the single-threaded path)
+constexpr bool PARALLEL_MODEL_LOADING = true;
+// reorder OBJ submeshes for the post-transform vertex cache and overdraw before baking
+constexpr bool OPTIMIZE_MESHES = true;
+// upload vertices as a position stream + packed attribute stream (PackedVertex) instead of the 44-byte Vertex
+constexpr bool PACKED_VERTICES = false;
+// with PACKED_VERTICES: fp16 positions for rasterization and the BLAS build instead of fp32
+constexpr bool PACKED_POSITIONS_FP16 = false;
+// build a QEM LOD chain for every OBJ submesh and pick a level per draw from its projected error
+constexpr bool GENERATE_MESH_LODS = true;
+// a LOD is good enough once its simplification error projects to at most this many pixels
+constexpr float LOD_ERROR_PIXELS = 1.0f;
+// LOD the BLAS builds use (0 = full detail); coarser geometry is usually fine for shadow rays
+constexpr uint32_t BLAS_LOD = 0;
+// BLAS builds share one scratch buffer and are submitted together, in batches of at most this much scratch memory
+constexpr uint64_t BLAS_SCRATCH_BUDGET = 64ull << 20;
+// build BLASes with eAllowCompaction and copy them into right-sized buffers afterwards
+constexpr bool COMPACT_BLAS = true;
+// TLAS refits until the refitted instance boxes cover this much more area than at the last build, then it is rebuilt
+constexpr float TLAS_REBUILD_AREA_GROWTH = 0.5f;
+// ... or after this many refits (~30 s at 60 fps), whichever comes first
+constexpr uint32_t TLAS_MAX_REFITS = 1800;
+// serialize the BLASes to AS_CACHE_PATH after the first build and deserialize them on later launches
+constexpr bool AS_CACHE = true;
+constexpr float CAMERA_FOV_DEGREES = 45.0f;
+// split OBJ submeshes into meshlets (64 vertices / 124 triangles) for the cluster culling mode
+constexpr bool BUILD_MESHLETS = true;
+// the bunny is instanced BUNNY_GRID x BUNNY_GRID times, every copy shares its BLASes (100 = 10k bunnies)
+constexpr uint32_t BUNNY_GRID = 1;
+// animate the bunny on the GPU (deform.slang) and refit its BLASes every frame, one BLAS set per frame in flight
+constexpr bool DEFORM_MESHES = false;
+// ... rebuilding them instead of refitting every this many updates (0 = always refit)
+constexpr uint32_t DEFORM_BLAS_REBUILD_INTERVAL = 120;
+// largest displacement of the deformation, relative to the bunny's bounding radius
+constexpr float DEFORM_AMPLITUDE = 0.05f;
+// random point lights in the Cornell box, restir.slang picks one per pixel from their light tree or alias table
+constexpr uint32_t LIGHT_COUNT = 100;
+// how restir.slang picks its light, L cycles through them
+enum class LightSampler : uint32_t {
+    AliasTable = 0,  // by power alone
+    LightTree  = 1,  // by an importance estimate relative to the shading point
+    Clusters   = 2,  // by the exact unshadowed contribution of the lights culled into the pixel's cluster
+};
+constexpr LightSampler DEFAULT_LIGHT_SAMPLER = LightSampler::Clusters;
+// move the lights along small orbits and pulse their color; the light tree bounds each light by its orbit, so it stays valid
+constexpr bool ANIMATE_LIGHTS      = true;
+constexpr float LIGHT_ORBIT_RADIUS = 0.15f;
+// from this many lights on, light_animation.slang animates them on the GPU instead of the CPU writing every light each frame
+constexpr uint32_t LIGHT_GPU_ANIMATION_THRESHOLD = 4096;
+constexpr bool GPU_LIGHT_ANIMATION               = ANIMATE_LIGHTS && LIGHT_COUNT >= LIGHT_GPU_ANIMATION_THRESHOLD;
+// lights end where their irradiance falls below this: radius sqrt(intensity * max(color) / cutoff), windowed to 0 there
+constexpr float LIGHT_INFLUENCE_CUTOFF = 0.002f;
+// clustered light culling (cluster_cull.slang): screen tiles x exponential slices of the distance to the camera
+constexpr uint32_t CLUSTER_TILE_SIZE = 16;  // pixels, the workgroup size of cluster_cull.slang
+constexpr uint32_t CLUSTER_SLICES    = 16;  // at most 32 (groupshared arrays in cluster_cull.slang)
+constexpr float CLUSTER_NEAR         = 0.1f;
+constexpr float CLUSTER_FAR          = 20.0f;
+// light indices all clusters of a frame can hold, clusters past it are cut short (K reports it)
+constexpr uint32_t CLUSTER_INDEX_CAPACITY = 1u << 21;
+static_assert(CLUSTER_SLICES >= 1 && CLUSTER_SLICES <= 32, "cluster_cull.slang keeps one groupshared box per slice");
+// ReSTIR DI: candidates per pixel drawn from the light sampler and resampled (RIS) by their unshadowed contribution
+constexpr uint32_t RESTIR_CANDIDATES = 32;
+// temporal reuse: the reprojected reservoir of the previous frame counts at most this many times the new candidates
+constexpr uint32_t RESTIR_TEMPORAL_M_CAP = 20;
+// spatial reuse (restir_spatial.slang): a chain of passes after the temporal one, each pixel merging the reservoirs of
+// k neighbours within a pixel radius; pass count, k and radius are tunable at runtime up to these limits
+constexpr uint32_t MAX_SPATIAL_PASSES    = 4;
+constexpr uint32_t MAX_SPATIAL_NEIGHBORS = 16;  // restir_spatial.slang keeps the accepted neighbours for the MIS weights
+// ReSTIR GI spatial reuse (restir_gi_spatial.slang): neighbours merged per pixel, within this many pixels
+constexpr uint32_t GI_SPATIAL_NEIGHBORS = 5;
+constexpr float GI_SPATIAL_RADIUS       = 30.0f;
+// SVGF denoiser (svgf_*.slang) between the lighting passes and the blit: temporal accumulation with per pixel
+// luminance moments, variance estimation for short histories and an edge-aware a-trous wavelet filter
+constexpr uint32_t DENOISER_ATROUS_ITERATIONS = 5;     // filter footprint doubles every iteration
+constexpr float DENOISER_COLOR_ALPHA          = 0.2f;  // exponential moving average weight of the new frame
+constexpr float DENOISER_MOMENTS_ALPHA        = 0.2f;
+constexpr float DENOISER_PHI_COLOR            = 4.0f;  // luminance edge stopping, in standard deviations
+// vertex binding of the previous frame's positions (inPrevPosition in shader.slang), next to the layout's own bindings
+constexpr uint32_t PREVIOUS_POSITION_BINDING = 2;
 
 const std::vector<char const*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
 
@@ -54,10 +146,10 @@ class SDLException final : public std::runtime_error {
     explicit SDLException(const std::string& message) : std::runtime_error(std::format("{}: {}", message, SDL_GetError())) {}
 };
 struct BufferResource {
-    vk::raii::Buffer buffer       = nullptr;
-    vk::raii::DeviceMemory memory = nullptr;
-    vk::DeviceSize size           = 0;
-    void* mapped                  = nullptr;  // for vulkan persistent mapped memory
+    vk::raii::Buffer buffer = nullptr;
+    GpuAllocation memory    = nullptr;
+    vk::DeviceSize size     = 0;
+    void* mapped            = nullptr;  // for vulkan persistent mapped memory
 };
 /**
  * @brief Texture structure to hold texture image, its memory, image view and sampler
@@ -65,12 +157,22 @@ struct BufferResource {
  */
 struct Texture {
     // texture image and its memory
-    vk::raii::Image textureImage              = nullptr;
-    vk::raii::DeviceMemory textureImageMemory = nullptr;
-    vk::raii::ImageView textureImageView      = nullptr;
-    vk::raii::Sampler textureSampler          = nullptr;
+    vk::raii::Image textureImage     = nullptr;
+    GpuAllocation textureImageMemory = nullptr;
+    vk::raii::ImageView textureImageView = nullptr;
+    vk::raii::Sampler textureSampler     = nullptr;
 };
 
+/**
+ * @brief one simplified index range of a SubMesh, indexes the same vertices as the full-detail range
+ *
+ */
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error;  // object space distance to the full-detail surface
+};
+constexpr uint32_t MAX_MESH_LODS = 4;  // including the full-detail range
 /**
  * @brief SubMesh structure to hold information about a subset of a mesh
  *
@@ -78,16 +180,71 @@ struct Texture {
 struct SubMesh {
     uint32_t indexOffset;
     uint32_t indexCount;
-    uint32_t maxVertex;
-    bool alphaCut = false;
+    uint32_t maxVertex;  // highest index value in the range (relative to vertexOffset)
+    bool alphaCut         = false;
+    int32_t vertexOffset  = 0;   // added to every index (glTF primitives keep their local indices)
+    int32_t materialIndex = -1;  // glTF material, -1 for OBJ geometry
+    glm::mat4 transform   = glm::mat4(1.0f);  // node transform from the scene file
+    // LOD chain: level 0 is indexOffset/indexCount, levels 1..lodCount-1 live in lods[level - 1]
+    uint32_t lodCount = 1;
+    std::array<MeshLod, MAX_MESH_LODS - 1> lods{};
+    glm::vec4 boundingSphere = glm::vec4(0.0f);  // xyz center, w radius, in the submesh's own space
+    // meshlets of the full-detail range (the range is stored in meshlet order), none for glTF geometry
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+
+    MeshLod lod(uint32_t level) const { return level == 0 ? MeshLod{indexOffset, indexCount, 0.0f} : lods[level - 1]; }
 };
+/**
+ * @brief where one glTF primitive lands in the shared vertex/index buffers
+ *
+ */
+struct GltfPrimitiveRange {
+    int mesh;
+    int primitive;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    glm::vec3 baseColor;
+};
+namespace tinygltf {
+class Model;
+}
 /**
  * @brief
  *
  */
 struct Light {
-    glm::vec4 position;
-    glm::vec4 color;
+    glm::vec4 position;  // xyz, w = intensity
+    glm::vec4 color;     // rgb, w = padding
+};
+/**
+ * @brief animation parameters of one light, the layout of LightMotion in light_animation.slang
+ */
+struct LightMotion {
+    glm::vec4 center;  // xyz orbit center, w orbit radius
+    glm::vec4 color;   // rgb base color, w intensity
+    glm::vec4 params;  // x angular speed, y phase, z pulse rate, w padding
+};
+/**
+ * @brief the same parameters as one stream per field, so the CPU animation loop reads contiguous floats
+ */
+struct LightMotionStreams {
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<float> red, green, blue, intensity;
+    std::vector<float> speed, phase, pulse;
+
+    void resize(size_t count) {
+        for (std::vector<float>* stream : {&centerX, &centerY, &centerZ, &radius, &red, &green, &blue, &intensity, &speed, &phase, &pulse}) {
+            stream->resize(count);
+        }
+    }
+    LightMotion motion(size_t i) const {
+        return LightMotion{.center = glm::vec4(centerX[i], centerY[i], centerZ[i], radius[i]),
+                           .color  = glm::vec4(red[i], green[i], blue[i], intensity[i]),
+                           .params = glm::vec4(speed[i], phase[i], pulse[i], 0.0f)};
+    }
 };
 /**
  * @brief Vertex data structure
@@ -102,6 +259,19 @@ struct Vertex {
     bool operator==(const Vertex& other) const {
         return pos == other.pos && color == other.color && texCoord == other.texCoord && normal == other.normal;
     }
+    /**
+     * @brief 64-bit hash over the packed vertex bytes
+     * -0.0f is folded into 0.0f first so the hash stays consistent with operator==
+     *
+     * @return uint64_t
+     */
+    uint64_t hash() const {
+        static_assert(sizeof(Vertex) == 11 * sizeof(float), "Vertex must stay tightly packed for hashing");
+        float packed[11];
+        memcpy(packed, this, sizeof(packed));
+        for (float& f : packed) f = (f == 0.0f) ? 0.0f : f;
+        return hash64(packed, sizeof(packed));
+    }
 
     /**
      * @brief Get the Binding Description object: binding, stride, inputRate
@@ -124,20 +294,210 @@ struct Vertex {
 namespace std {
 template <>
 struct hash<Vertex> {
-    size_t operator()(Vertex const& vertex) const {
-        size_t h = std::hash<glm::vec3>()(vertex.pos) ^ (std::hash<glm::vec3>()(vertex.color) << 1);
-        h        = (h >> 1) ^ (std::hash<glm::vec2>()(vertex.texCoord) << 1);
-        h        = (h >> 1) ^ (std::hash<glm::vec3>()(vertex.normal) << 1);
-        return h;
-    }
+    size_t operator()(Vertex const& vertex) const { return static_cast<size_t>(vertex.hash()); }
 };
 }  // namespace std
+/**
+ * @brief compact GPU vertex layout selected with PACKED_VERTICES
+ *
+ * binding 0: positions, R32G32B32_SFLOAT (12 bytes) or R16G16B16A16_SFLOAT (8 bytes), also the BLAS build input
+ * binding 1: Attributes (12 bytes), the per-shape color is replaced by an index into the material color SSBO
+ */
+struct PackedVertex {
+    struct Attributes {
+        int16_t normal[2];       // octahedral, snorm16
+        uint16_t texCoord[2];    // fp16
+        uint32_t materialIndex;  // materialColors[] in shader.slang
+    };
+    static_assert(sizeof(Attributes) == 12);
+
+    static constexpr vk::Format positionFormat = PACKED_POSITIONS_FP16 ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR32G32B32Sfloat;
+    static constexpr uint32_t positionStride   = PACKED_POSITIONS_FP16 ? 4 * sizeof(uint16_t) : 3 * sizeof(float);
+
+    static std::array<vk::VertexInputBindingDescription, 2> getBindingDescriptions() {
+        return {vk::VertexInputBindingDescription(0, positionStride, vk::VertexInputRate::eVertex),
+                vk::VertexInputBindingDescription(1, sizeof(Attributes), vk::VertexInputRate::eVertex)};
+    }
+    /**
+     * @brief locations 0 pos, 1 normal, 2 texCoord, 3 materialIndex (see VSInputPacked in shader.slang)
+     */
+    static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescriptions() {
+        return {vk::VertexInputAttributeDescription(0, 0, positionFormat, 0),
+                vk::VertexInputAttributeDescription(1, 1, vk::Format::eR16G16Snorm, offsetof(Attributes, normal)),
+                vk::VertexInputAttributeDescription(2, 1, vk::Format::eR16G16Sfloat, offsetof(Attributes, texCoord)),
+                vk::VertexInputAttributeDescription(3, 1, vk::Format::eR32Uint, offsetof(Attributes, materialIndex))};
+    }
+};
 struct UniformBufferObject {
     glm::mat4 view;
     glm::mat4 proj;
+    glm::mat4 previousViewProj;  // the camera of the frame recorded before, for motion vectors
+};
+// the camera a frame was rendered with, kept for the next frame's reprojection
+struct CameraFrame {
+    glm::mat4 viewProj;
+    glm::vec3 position;
+    glm::vec3 forward;
 };
-struct MeshPushConstants {
-    glm::mat4 modelMatrix;
+// the cluster grid as cluster_cull.slang and restir.slang see it
+struct ClusterGrid {
+    glm::vec4 cameraPosition;  // xyz, w = CLUSTER_NEAR
+    glm::vec4 params;          // x = CLUSTER_SLICES / log(CLUSTER_FAR / CLUSTER_NEAR), y = LIGHT_INFLUENCE_CUTOFF
+    glm::uvec4 size;           // tiles x, tiles y, slices, index capacity
+};
+// push constants of restir.slang
+struct RestirPushConstants {
+    ClusterGrid clusters;
+    glm::vec4 previousCameraPosition;  // xyz, the previous frame's camera for the reprojection depth test
+    glm::vec4 previousCameraForward;   // xyz
+    uint32_t frameIndex;               // seeds the per pixel random numbers
+    uint32_t lightCount;
+    uint32_t lightSampler;    // LightSampler
+    uint32_t debugView;       // 1: heatmap of the lights per cluster
+    uint32_t candidateCount;  // RIS candidates per pixel, 0: one plain sample from lightSampler
+    uint32_t temporalReuse;   // 1: merge the previous frame's reservoirs (valid history only)
+    uint32_t deferShading;    // 1: spatial reuse passes follow, the last one shades
+};
+// push constants of restir_spatial.slang
+struct SpatialReusePushConstants {
+    glm::vec4 cameraPosition;  // xyz, for the depth similarity test
+    uint32_t frameIndex;
+    uint32_t pass;
+    uint32_t neighbors;
+    float radius;  // pixels
+    float influenceCutoff;
+    uint32_t unbiased;  // 1: MIS weights count only neighbours whose surface sees the light (one ray each)
+    uint32_t shade;     // 1: last pass, shades the pixel with its reservoir
+    uint32_t lightCount;
+};
+// runtime settings of the spatial reuse chain
+struct SpatialReuseSettings {
+    uint32_t passes    = 1;
+    uint32_t neighbors = 5;
+    float radius       = 30.0f;
+    bool unbiased      = false;
+};
+// GPU time of every pass of the last measured chain
+struct SpatialReuseStats {
+    uint32_t passes = 0;
+    std::array<double, MAX_SPATIAL_PASSES> gpuMs{};
+};
+// one pixel's ReSTIR GI reservoir (GiReservoir in restir_gi.slang): a secondary hit and the radiance it reflects back
+struct GiReservoir {
+    glm::vec3 position;
+    float weightSum;
+    glm::vec3 normal;
+    uint32_t M;
+    glm::vec3 radiance;
+    float W;
+};
+static_assert(sizeof(GiReservoir) == 48, "restir_gi.slang reads a 48 byte GiReservoir");
+// where the triangles of one TLAS instance live, indexed by its instanceCustomIndex (GiGeometry in restir_gi.slang)
+struct GiGeometry {
+    vk::DeviceAddress vertexAddress;  // Vertex[], the frame's deformed copy for deforming submeshes
+    vk::DeviceAddress indexAddress;   // first index of the LOD range the BLAS was built from
+    int32_t vertexOffset;
+    uint32_t padding;
+};
+// push constants of restir_gi.slang
+struct GiPushConstants {
+    glm::vec4 previousCameraPosition;  // xyz
+    glm::vec4 previousCameraForward;   // xyz
+    uint32_t frameIndex;
+    uint32_t lightCount;
+    uint32_t temporalReuse;  // 1: merge the previous frame's GI reservoirs (valid history only)
+    float influenceCutoff;
+};
+// push constants of restir_gi_spatial.slang
+struct GiResolvePushConstants {
+    glm::vec4 cameraPosition;  // xyz
+    uint32_t frameIndex;
+    uint32_t neighbors;
+    float radius;  // pixels
+    uint32_t padding;
+};
+// push constants of svgf_temporal.slang
+struct DenoiserTemporalPushConstants {
+    glm::vec4 previousCameraPosition;  // xyz
+    glm::vec4 previousCameraForward;   // xyz
+    float colorAlpha;
+    float momentsAlpha;
+    uint32_t historyValid;  // 0: the history images hold nothing of the previous frame
+    uint32_t padding;
+};
+// push constants of svgf_variance.slang and svgf_atrous.slang
+struct DenoiserFilterPushConstants {
+    glm::vec4 cameraPosition;  // xyz
+    int32_t stepSize;          // a-trous tap spacing in pixels
+    uint32_t writeHistory;     // 1: the first iteration, its result is the next frame's color history
+    uint32_t finalPass;        // 1: the last iteration, writes the remodulated color into the output image
+    float phiColor;
+};
+// per frame denoiser images, at [frame * DENOISER_IMAGE_COUNT + image]
+enum DenoiserImage : uint32_t { DenoiserColorHistory, DenoiserMoments, DenoiserPing, DenoiserPong, DENOISER_IMAGE_COUNT };
+// GPU time of every denoiser pass: temporal, variance, then one per a-trous iteration
+struct DenoiserStats {
+    bool measured = false;
+    std::array<double, DENOISER_ATROUS_ITERATIONS + 2> gpuMs{};
+};
+// one pixel's ReSTIR reservoir (Reservoir in restir.slang)
+struct Reservoir {
+    uint32_t lightIndex;  // the surviving light
+    float weightSum;      // sum of the candidates' resampling weights
+    uint32_t M;           // candidates seen
+    float W;              // unbiased contribution weight of lightIndex
+};
+// push constants of cluster_cull.slang
+struct ClusterCullPushConstants {
+    ClusterGrid clusters;
+    uint32_t lightCount;
+};
+// what the last measured cull pass produced
+struct ClusterStats {
+    uint32_t clusters = 0;
+    uint32_t indices  = 0;  // light indices written, all clusters together
+    bool overflowed   = false;
+    double gpuMs      = 0.0;
+};
+// push constants of light_animation.slang
+struct LightAnimationPushConstants {
+    float time;
+    uint32_t lightCount;
+};
+// push constants of deform.slang
+struct DeformPushConstants {
+    glm::vec4 center;  // xyz center of the deformed geometry, w radius
+    float time;
+    float amplitude;
+    float frequency;
+    uint32_t vertexCount;
+    uint32_t strideWords;
+};
+// what the last deformation pass did, plus totals since startup
+struct DeformStats {
+    bool rebuilt       = false;
+    uint32_t vertices  = 0;
+    uint32_t blasCount = 0;
+    double gpuMs       = 0.0;  // animation + BLAS update of the last measured frame
+    uint64_t refits    = 0;
+    uint64_t rebuilds  = 0;
+};
+/**
+ * @brief one entry of the instance table: a submesh (and with it its BLAS) placed in the scene
+ *
+ */
+struct SceneInstance {
+    uint32_t submesh;
+    uint32_t customIndex;  // TLAS instanceCustomIndex, the submesh's material slot
+    bool animated;         // follows currentModelMatrix, like the spinning bunny
+    glm::mat4 transform;   // placement in the world, applied after submeshModelMatrix(submesh)
+};
+// push constants of meshlet_cull.slang
+struct MeshletCullPushConstants {
+    glm::vec4 frustumPlanes[6];  // xyz normal pointing inside, w distance
+    glm::vec4 cameraPosition;
+    uint32_t meshletCount;
+    uint32_t coneCulling;
 };
 class HelloTriangleApplication {
     bool running = true;
@@ -160,6 +520,10 @@ class HelloTriangleApplication {
     vk::raii::Device device                         = nullptr;
     uint32_t queueIndex                             = ~0;
     vk::raii::Queue queue                           = nullptr;
+    // every buffer / image memory below comes from here, so it has to be declared before them
+    GpuAllocator gpuAllocator;
+    // startup copies and layout transitions, batched into a few submits
+    UploadManager uploads;
     vk::raii::SwapchainKHR swapChain                = nullptr;
     std::vector<vk::Image> swapChainImages;
     vk::SurfaceFormatKHR swapChainSurfaceFormat;
@@ -170,21 +534,57 @@ class HelloTriangleApplication {
     vk::raii::PipelineLayout pipelineLayout           = nullptr;
     vk::raii::Pipeline graphicsPipeline               = nullptr;
     //
-    vk::raii::CommandPool commandPool         = nullptr;
-    vk::raii::Buffer vertexBuffer             = nullptr;
-    vk::raii::DeviceMemory vertexBufferMemory = nullptr;
-    vk::raii::Buffer indexBuffer              = nullptr;
-    vk::raii::DeviceMemory indexBufferMemory  = nullptr;
+    vk::raii::CommandPool commandPool = nullptr;
+    vk::raii::Buffer vertexBuffer     = nullptr;  // Vertex[], or the position stream with PACKED_VERTICES
+    GpuAllocation vertexBufferMemory  = nullptr;
+    // PACKED_VERTICES only: PackedVertex::Attributes[]
+    vk::raii::Buffer vertexAttributeBuffer    = nullptr;
+    GpuAllocation vertexAttributeBufferMemory = nullptr;
+    // one float4 color per distinct vertex color, indexed by PackedVertex::Attributes::materialIndex
+    BufferResource materialBufferResource;
+    vk::raii::Buffer indexBuffer    = nullptr;
+    GpuAllocation indexBufferMemory = nullptr;
     // uniform buffer
     std::vector<vk::raii::Buffer> uniformBuffers;
-    std::vector<vk::raii::DeviceMemory> uniformBuffersMemory;
+    std::vector<GpuAllocation> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
     // descriptor pool
     vk::raii::DescriptorPool descriptorPool = nullptr;
     std::vector<vk::raii::DescriptorSet> descriptorSets;
     // light buffer
     std::vector<Light> lights;
-    BufferResource lightBufferResource;
+    LightMotionStreams lightMotion;
+    // one light buffer per frame in flight, persistently mapped; only dirty ranges are written (updateLights())
+    std::vector<BufferResource> lightBuffers;
+    FrameDirtyRanges<MAX_FRAMES_IN_FLIGHT> lightDirty;
+    // GPU_LIGHT_ANIMATION: light_animation.slang writes this frame's lights from its motion buffer
+    std::vector<BufferResource> lightMotionBuffers;
+    FrameDirtyRanges<MAX_FRAMES_IN_FLIGHT> lightMotionDirty;
+    vk::raii::DescriptorSetLayout lightAnimationSetLayout = nullptr;
+    vk::raii::PipelineLayout lightAnimationPipelineLayout = nullptr;
+    vk::raii::Pipeline lightAnimationPipeline             = nullptr;
+    std::vector<vk::raii::DescriptorSet> lightAnimationDescriptorSets;
+    // alias table over light power (luminance * intensity), for importance sampled light picks
+    BufferResource lightAliasBufferResource;
+    // light BVH over the same power, flattened depth first (LightTreeNode)
+    LightTree lightTree;
+    std::vector<LightTreeLight> lightTreeLights;  // what the tree was built or last refit from
+    std::vector<BufferResource> lightTreeBuffers;  // per frame in flight, refits write the touched nodes
+    FrameDirtyRanges<MAX_FRAMES_IN_FLIGHT> lightTreeDirty;
+    LightSampler lightSampler = DEFAULT_LIGHT_SAMPLER;
+    // clustered light culling: per frame cluster ranges (offset, count) into a compact light index list
+    std::vector<BufferResource> clusterRangeBuffers;
+    std::vector<BufferResource> clusterIndexBuffers;
+    std::vector<BufferResource> clusterCounterBuffers;  // host visible, the indices used, read back a frame cycle later
+    vk::raii::DescriptorSetLayout clusterCullSetLayout = nullptr;
+    vk::raii::PipelineLayout clusterCullPipelineLayout = nullptr;
+    vk::raii::Pipeline clusterCullPipeline             = nullptr;
+    std::vector<vk::raii::DescriptorSet> clusterCullDescriptorSets;
+    std::vector<vk::raii::QueryPool> clusterTimestampQueries;
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> clusterResultsPending{};
+    ClusterStats clusterStats;
+    bool clusterHeatmap = false;
+    uint32_t frameIndex = 0;  // frames recorded since startup
     // vk::raii::Buffer lightBuffer             = nullptr;
     // vk::raii::DeviceMemory lightBufferMemory = nullptr;
     //
@@ -198,24 +598,56 @@ class HelloTriangleApplication {
     Texture viking_room;
     // depth buffering
     std::vector<vk::raii::Image> depthImage;
-    std::vector<vk::raii::DeviceMemory> depthImageMemory;
+    std::vector<GpuAllocation> depthImageMemory;
     std::vector<vk::raii::ImageView> depthImageView;
     // G-Buffer Normal
     std::vector<vk::raii::Image> gBufferNormalImage;
-    std::vector<vk::raii::DeviceMemory> gBufferNormalImageMemory;
+    std::vector<GpuAllocation> gBufferNormalImageMemory;
     std::vector<vk::raii::ImageView> gBufferNormalImageView;
     // G-Buffer Position
     std::vector<vk::raii::Image> gBufferPositionImage;
-    std::vector<vk::raii::DeviceMemory> gBufferPositionImageMemory;
+    std::vector<GpuAllocation> gBufferPositionImageMemory;
     std::vector<vk::raii::ImageView> gBufferPositionImageView;
     // G-Buffer alebedo
     std::vector<vk::raii::Image> gBufferAlbedoImage;
-    std::vector<vk::raii::DeviceMemory> gBufferAlbedoImageMemory;
+    std::vector<GpuAllocation> gBufferAlbedoImageMemory;
     std::vector<vk::raii::ImageView> gBufferAlbedoImageView;
+    // G-Buffer motion: xy screen uv offset to the previous frame, z previous view depth
+    std::vector<vk::raii::Image> gBufferMotionImage;
+    std::vector<GpuAllocation> gBufferMotionImageMemory;
+    std::vector<vk::raii::ImageView> gBufferMotionImageView;
 
     // class member for model
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    // geometry uploaded by createVertexBuffer()/createIndexBuffer(): the vectors above or a mapped .vkmesh cache
+    std::span<const Vertex> vertexView;
+    std::span<const uint32_t> indexView;
+    MeshCache meshCache;
+    // content hash of what the vertex/index buffers hold (OBJ + bake settings or the glTF buffers), 0 if unknown
+    uint64_t geometryHash = 0;
+    // meshlets of all submeshes, same vector/view split as the vertices
+    std::vector<MeshCacheMeshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint8_t> meshletTriangles;
+    std::span<const MeshCacheMeshlet> meshletView;
+    std::span<const uint32_t> meshletVertexView;
+    std::span<const uint8_t> meshletTriangleView;
+    // cluster culling mode (toggle with C): meshlet_cull.slang fills one indirect draw per meshlet
+    bool clusterCulling = false;
+    BufferResource meshletBufferResource;
+    BufferResource meshletVertexBufferResource;    // local vertex lists, for mesh shading later
+    BufferResource meshletTriangleBufferResource;  // local triangle lists, for mesh shading later
+    std::vector<BufferResource> meshletCommandBuffers;    // per frame, vk::DrawIndexedIndirectCommand per meshlet
+    vk::raii::DescriptorSetLayout meshletCullSetLayout    = nullptr;
+    vk::raii::PipelineLayout meshletCullPipelineLayout    = nullptr;
+    vk::raii::Pipeline meshletCullPipeline                = nullptr;
+    std::vector<vk::raii::DescriptorSet> meshletCullDescriptorSets;
+    // glTF scene, kept until its buffers have been copied to the GPU; its geometry sits in front of vertexView/indexView
+    std::shared_ptr<tinygltf::Model> gltfModel;
+    std::vector<GltfPrimitiveRange> gltfPrimitives;
+    uint32_t gltfVertexCount = 0;
+    uint32_t gltfIndexCount  = 0;
 
     //
     bool framebufferResized = false;
@@ -229,8 +661,61 @@ class HelloTriangleApplication {
     std::vector<vk::raii::DescriptorSet> computeDescriptorSets;
     // storage_Image processed by compute shader
     std::vector<vk::raii::Image> storageImage;
-    std::vector<vk::raii::DeviceMemory> storageImageMemory;
+    std::vector<GpuAllocation> storageImageMemory;
     std::vector<vk::raii::ImageView> storageImageView;
+    // per frame in flight, one Reservoir per pixel, sized with the storage image
+    std::vector<BufferResource> reservoirBuffers;
+    bool restirEnabled = true;
+    bool temporalReuse = true;
+    // the previous frame wrote its reservoirs, G-buffer and motion vectors for this frame to reuse
+    bool restirHistoryValid = false;
+    // spatial reuse: per frame scratch reservoirs the passes ping-pong with, two sets per frame (one per direction)
+    SpatialReuseSettings spatialReuse;
+    std::vector<BufferResource> spatialReservoirBuffers;
+    vk::raii::DescriptorSetLayout spatialReuseSetLayout = nullptr;
+    vk::raii::PipelineLayout spatialReusePipelineLayout = nullptr;
+    vk::raii::Pipeline spatialReusePipeline             = nullptr;
+    std::vector<vk::raii::DescriptorSet> spatialReuseDescriptorSets;
+    std::vector<vk::raii::QueryPool> spatialTimestampQueries;  // per frame: before the chain and after every pass
+    std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> spatialPassesPending{};
+    SpatialReuseStats spatialStats;
+    // ReSTIR GI: one-bounce indirect light from a secondary ray per pixel, reservoirs reused like the direct ones
+    bool giEnabled      = false;
+    bool giHistoryValid = false;
+    std::vector<BufferResource> giReservoirBuffers;
+    std::vector<BufferResource> giGeometryBuffers;  // per frame, the deformed submeshes point at the frame's vertices
+    vk::raii::DescriptorSetLayout giSetLayout        = nullptr;
+    vk::raii::PipelineLayout giPipelineLayout        = nullptr;
+    vk::raii::Pipeline giPipeline                    = nullptr;
+    vk::raii::DescriptorSetLayout giResolveSetLayout = nullptr;
+    vk::raii::PipelineLayout giResolvePipelineLayout = nullptr;
+    vk::raii::Pipeline giResolvePipeline             = nullptr;
+    std::vector<vk::raii::DescriptorSet> giDescriptorSets;
+    std::vector<vk::raii::DescriptorSet> giResolveDescriptorSets;
+    // SVGF denoiser: history, moments and ping-pong images per frame; the a-trous sets go ping to pong and back
+    bool denoiserEnabled      = false;
+    bool denoiserHistoryValid = false;
+    std::vector<vk::raii::Image> denoiserImages;
+    std::vector<GpuAllocation> denoiserImageMemory;
+    std::vector<vk::raii::ImageView> denoiserImageViews;
+    vk::raii::DescriptorSetLayout denoiserTemporalSetLayout = nullptr;
+    vk::raii::PipelineLayout denoiserTemporalPipelineLayout = nullptr;
+    vk::raii::Pipeline denoiserTemporalPipeline             = nullptr;
+    vk::raii::DescriptorSetLayout denoiserVarianceSetLayout = nullptr;
+    vk::raii::PipelineLayout denoiserVariancePipelineLayout = nullptr;
+    vk::raii::Pipeline denoiserVariancePipeline             = nullptr;
+    vk::raii::DescriptorSetLayout denoiserAtrousSetLayout   = nullptr;
+    vk::raii::PipelineLayout denoiserAtrousPipelineLayout   = nullptr;
+    vk::raii::Pipeline denoiserAtrousPipeline               = nullptr;
+    std::vector<vk::raii::DescriptorSet> denoiserTemporalDescriptorSets;
+    std::vector<vk::raii::DescriptorSet> denoiserVarianceDescriptorSets;
+    std::vector<vk::raii::DescriptorSet> denoiserAtrousDescriptorSets;  // [2 * frame]: pong to ping, [2 * frame + 1]: ping to pong
+    std::vector<vk::raii::QueryPool> denoiserTimestampQueries;          // per frame: before the first pass and after every pass
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> denoiserTimestampsPending{};
+    DenoiserStats denoiserStats;
+    CameraFrame currentCameraFrame{};
+    CameraFrame previousCameraFrame{};
+    bool cameraHistoryValid = false;
     // maintain the time and matrix for animation
     glm::mat4 currentModelMatrix;
 
@@ -277,11 +762,22 @@ class HelloTriangleApplication {
         //
         createGraphicsPipeline();
         createComputePipeline();
+        createMeshletCullPipeline();
+        createDeformPipeline();
+        createLightAnimationPipeline();
+        createClusterCullPipeline();
+        createSpatialReusePipeline();
+        createGiPipelines();
+        createDenoiserPipelines();
         createCommandPool();
         //
         createDepthResources();
         createGbufferResources();
         createStorageImage();
+        createClusterResources();
+        createSpatialReuseResources();
+        createGiResources();
+        createDenoiserResources();
         //
         createTextureImage();
         createTextureImageView();
@@ -291,15 +787,29 @@ class HelloTriangleApplication {
         //
         createVertexBuffer();
         createIndexBuffer();
+        createSceneInstances();
+        createMeshletBuffers();
         createUniformBuffers();
         createLightBuffer();
+        createDeformedGeometry();
         createAccelerationStructures();
+        createGiGeometry();
         //
         createDescriptorPool();
         createDescriptorSets();
         createComputeDescriptorSets();
+        createMeshletDescriptorSets();
+        createDeformDescriptorSets();
+        createLightAnimationDescriptorSets();
+        createClusterDescriptorSets();
+        createSpatialReuseDescriptorSets();
+        createGiDescriptorSets();
+        createDenoiserDescriptorSets();
         createCommandBuffers();
         createSyncObjects();
+        uploads.flush();
+        uploads.printStats(std::cout);
+        gpuAllocator.printStats(std::cout);
     }
 
     void mainLoop() {
@@ -342,6 +852,96 @@ class HelloTriangleApplication {
                         case SDLK_D:
                             dPressed = true;
                             break;
+                        case SDLK_C:
+                            if (!event.key.repeat && !meshletView.empty()) {
+                                clusterCulling = !clusterCulling;
+                                std::cout << "[Info] Cluster culling " << (clusterCulling ? "on" : "off") << std::endl;
+                            }
+                            break;
+                        case SDLK_M:
+                            if (!event.key.repeat) gpuAllocator.printStats(std::cout);
+                            break;
+                        case SDLK_T:
+                            if (!event.key.repeat) tlasStats.print(std::cout);
+                            break;
+                        case SDLK_G:
+                            if (!event.key.repeat) printDeformStats();
+                            break;
+                        case SDLK_L:
+                            if (!event.key.repeat) {
+                                static constexpr const char* samplerNames[] = {"alias table", "light tree", "clusters"};
+                                lightSampler = static_cast<LightSampler>((static_cast<uint32_t>(lightSampler) + 1) % 3);
+                                std::cout << "[Info] Light sampling: " << samplerNames[static_cast<uint32_t>(lightSampler)] << std::endl;
+                            }
+                            break;
+                        case SDLK_H:
+                            if (!event.key.repeat) {
+                                clusterHeatmap = !clusterHeatmap;
+                                std::cout << "[Info] Cluster heatmap " << (clusterHeatmap ? "on" : "off") << std::endl;
+                            }
+                            break;
+                        case SDLK_K:
+                            if (!event.key.repeat) printClusterStats();
+                            break;
+                        case SDLK_R:
+                            if (!event.key.repeat) {
+                                restirEnabled = !restirEnabled;
+                                std::cout << "[Info] ReSTIR " << (restirEnabled ? "on" : "off") << std::endl;
+                            }
+                            break;
+                        case SDLK_P:
+                            if (!event.key.repeat) {
+                                temporalReuse = !temporalReuse;
+                                std::cout << "[Info] ReSTIR temporal reuse " << (temporalReuse ? "on" : "off") << std::endl;
+                            }
+                            break;
+                        case SDLK_N:
+                            if (!event.key.repeat) {
+                                spatialReuse.passes = (spatialReuse.passes + 1) % (MAX_SPATIAL_PASSES + 1);
+                                std::cout << "[Info] ReSTIR spatial passes: " << spatialReuse.passes << std::endl;
+                            }
+                            break;
+                        case SDLK_V:
+                            if (!event.key.repeat) {
+                                spatialReuse.neighbors = spatialReuse.neighbors * 2 > MAX_SPATIAL_NEIGHBORS ? 2 : spatialReuse.neighbors * 2;
+                                std::cout << "[Info] ReSTIR spatial neighbours: " << spatialReuse.neighbors << std::endl;
+                            }
+                            break;
+                        case SDLK_X:
+                            if (!event.key.repeat) {
+                                spatialReuse.radius = spatialReuse.radius >= 40.0f ? 5.0f : spatialReuse.radius + 5.0f;
+                                std::cout << "[Info] ReSTIR spatial radius: " << spatialReuse.radius << " px" << std::endl;
+                            }
+                            break;
+                        case SDLK_B:
+                            if (!event.key.repeat) {
+                                spatialReuse.unbiased = !spatialReuse.unbiased;
+                                std::cout << "[Info] ReSTIR spatial MIS weights: "
+                                          << (spatialReuse.unbiased ? "unbiased (visibility rays)" : "biased") << std::endl;
+                            }
+                            break;
+                        case SDLK_J:
+                            if (!event.key.repeat) printSpatialReuseStats();
+                            break;
+                        case SDLK_F:
+                            if (!event.key.repeat) {
+                                denoiserEnabled = !denoiserEnabled;
+                                std::cout << "[Info] SVGF denoiser " << (denoiserEnabled ? "on" : "off") << std::endl;
+                            }
+                            break;
+                        case SDLK_U:
+                            if (!event.key.repeat) printDenoiserStats();
+                            break;
+                        case SDLK_I:
+                            if (!event.key.repeat) {
+                                if (PACKED_VERTICES) {
+                                    std::cout << "[Warning] ReSTIR GI reads the Vertex layout, unavailable with PACKED_VERTICES" << std::endl;
+                                    break;
+                                }
+                                giEnabled = !giEnabled;
+                                std::cout << "[Info] ReSTIR GI " << (giEnabled ? "on" : "off") << std::endl;
+                            }
+                            break;
                     }
                     break;
                 case SDL_EVENT_KEY_UP:
@@ -439,7 +1039,36 @@ class HelloTriangleApplication {
     void createTextureImage();
 
     void loadModel();
+    void appendCornellBox(uint32_t vertexBase, uint32_t indexBase);
+    bool loadMeshCache(uint64_t sourceHash);
+    void writeMeshCache(uint64_t sourceHash);
+    void weldShapesSerial(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes);
+    void weldShapesParallel(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes);
+    void optimizeMeshes();
+    void generateMeshLods();
+    void buildMeshlets();
+    void createMeshletCullPipeline();
+    void createMeshletBuffers();
+    void createMeshletDescriptorSets();
+    void recordMeshletCulling(const vk::raii::CommandBuffer& cmd);
+    glm::mat4 submeshModelMatrix(size_t submesh) const;
+    glm::mat4 sceneInstanceMatrix(uint32_t instance) const;
+    void createSceneInstances();
+    void createDeformPipeline();
+    void createDeformedGeometry();
+    void createDeformDescriptorSets();
+    void recordDeformation(const vk::raii::CommandBuffer& cmd);
+    void printDeformStats() const;
+    glm::mat4 projectionMatrix() const;
+    uint32_t selectLod(const SubMesh& submesh, const glm::mat4& modelMatrix) const;
+    static bool isGltfPath(const std::string& path);
+    void loadGltfModel(const std::string& path);
+    void writeGltfVertices(uint8_t* dst) const;
+    void writeGltfIndices(uint32_t* dst) const;
     void createVertexBuffer();
+    void createPackedVertexBuffers(std::span<const Vertex> sceneVertices);
+    void createDeviceLocalBuffer(const void* data, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::raii::Buffer& buffer,
+                                 GpuAllocation& bufferMemory);
     void createIndexBuffer();
     void createUniformBuffers();
 
@@ -459,17 +1088,15 @@ class HelloTriangleApplication {
     // recreate swap chain
     void recreateSwapChain();
     void cleanupSwapChain();
-    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
     void createBuffer(vk::DeviceSize size,
                       vk::BufferUsageFlags usage,
                       vk::MemoryPropertyFlags properties,
                       vk::raii::Buffer& buffer,
-                      vk::raii::DeviceMemory& bufferMemory);
+                      GpuAllocation& bufferMemory);
     void updateUniformBuffer(uint32_t currentImage);
     void createDescriptorPool();
     void createDescriptorSets();
     void transitionImageLayout(const vk::raii::Image& image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
-    void copyBufferToImage(const vk::raii::Buffer& buffer, vk::raii::Image& image, uint32_t width, uint32_t height);
     void createTextureImageView();
     void createTextureSampler();
     void createDepthResources();
@@ -558,7 +1185,8 @@ class HelloTriangleApplication {
     }
 
     std::unique_ptr<vk::raii::CommandBuffer> beginSingleTimeCommands() {
-        // helper funtion for transition
+        // pending uploads go first, so the one-off commands see their data
+        uploads.flush();
         vk::CommandBufferAllocateInfo allocInfo{.commandPool = commandPool, .level = vk::CommandBufferLevel::ePrimary, .commandBufferCount = 1};
         std::unique_ptr<vk::raii::CommandBuffer> commandBuffer =
             std::make_unique<vk::raii::CommandBuffer>(std::move(device.allocateCommandBuffers(allocInfo).front()));
@@ -574,24 +1202,6 @@ class HelloTriangleApplication {
         queue.submit(submitInfo, nullptr);
         queue.waitIdle();
     }
-    void copyBuffer(vk::raii::Buffer& srcBuffer, vk::raii::Buffer& dstBuffer, vk::DeviceSize size) {
-        /*
-        copy data from srcBuffer to dstBuffer, the whole process is done by command buffer,just like
-        drawing commands
-
-        */
-
-        vk::CommandBufferAllocateInfo allocInfo{.commandPool = commandPool, .level = vk::CommandBufferLevel::ePrimary, .commandBufferCount = 1};
-
-        vk::raii::CommandBuffer commandCopyBuffer = std::move(device.allocateCommandBuffers(allocInfo).front());
-        // start recording command buffer
-        commandCopyBuffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-        commandCopyBuffer.copyBuffer(*srcBuffer, *dstBuffer, vk::BufferCopy{.size = size});
-        commandCopyBuffer.end();
-        // submit the command buffer and wait until it finishes
-        queue.submit(vk::SubmitInfo{.commandBufferCount = 1, .pCommandBuffers = &*commandCopyBuffer}, nullptr);
-        queue.waitIdle();
-    }
     /**
      * @brief create an image object and allocate memory for it
      *
@@ -611,7 +1221,7 @@ class HelloTriangleApplication {
                      vk::ImageUsageFlags usage,
                      vk::MemoryPropertyFlags properties,
                      vk::raii::Image& image,
-                     vk::raii::DeviceMemory& imageMemory) {
+                     GpuAllocation& imageMemory) {
         vk::ImageCreateInfo imageInfo{.imageType   = vk::ImageType::e2D,
                                       .format      = format,
                                       .extent      = {width, height, 1},
@@ -624,11 +1234,7 @@ class HelloTriangleApplication {
 
         image = vk::raii::Image(device, imageInfo);
 
-        vk::MemoryRequirements memRequirements = image.getMemoryRequirements();
-        vk::MemoryAllocateInfo allocInfo{.allocationSize  = memRequirements.size,
-                                         .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties)};
-        imageMemory = vk::raii::DeviceMemory(device, allocInfo);
-        image.bindMemory(*imageMemory, 0);
+        imageMemory = gpuAllocator.allocateImage(image, properties, tiling);
     }
     /**
      * @brief create an image view for the given image
@@ -661,6 +1267,40 @@ class HelloTriangleApplication {
     }
     //
     void createLightBuffer();
+    void createLightAliasTable();
+    void createLightTree();
+    void createLightAnimationPipeline();
+    void createLightAnimationDescriptorSets();
+    void animateLights(float time);
+    void updateLights(const vk::raii::CommandBuffer& cmd);
+    void moveLight(uint32_t index, const glm::vec3& center);
+    void setLightColor(uint32_t index, const glm::vec3& color, float intensity);
+    LightTreeLight lightTreeLight(uint32_t index) const;
+    // clustered light culling
+    void createClusterCullPipeline();
+    void createClusterResources();
+    void createClusterDescriptorSets();
+    ClusterGrid clusterGrid() const;
+    void recordLightCulling(const vk::raii::CommandBuffer& cmd);
+    void printClusterStats() const;
+    // spatial reuse
+    void createSpatialReusePipeline();
+    void createSpatialReuseResources();
+    void createSpatialReuseDescriptorSets();
+    void recordSpatialReuse(const vk::raii::CommandBuffer& cmd);
+    void printSpatialReuseStats() const;
+    // ReSTIR GI
+    void createGiPipelines();
+    void createGiResources();
+    void createGiGeometry();
+    void createGiDescriptorSets();
+    void recordIndirectLighting(const vk::raii::CommandBuffer& cmd);
+    // SVGF denoiser
+    void createDenoiserPipelines();
+    void createDenoiserResources();
+    void createDenoiserDescriptorSets();
+    void recordDenoiser(const vk::raii::CommandBuffer& cmd);
+    void printDenoiserStats() const;
     // compute shader related functions
     void createStorageImage();
     void createComputeDescriptorSetLayout();
@@ -677,24 +1317,82 @@ class HelloTriangleApplication {
 
     /*Ray tracing*/
     void createAccelerationStructures();
+    void buildBottomLevelAccelerationStructures();
+    void compactBottomLevelAccelerationStructures(const std::vector<vk::DeviceSize>& builtSizes, const std::vector<vk::DeviceSize>& compactedSizes);
+    AsCacheDevice asCacheDevice() const;
+    bool loadBlasCache(const std::vector<uint64_t>& keys);
+    void writeBlasCache(const std::vector<uint64_t>& keys, double buildMs);
 
     std::vector<SubMesh> submeshes;
     std::vector<tinyobj::material_t> materials;
 
+    // instance table, grouped by submesh so every submesh is a single instanced draw
+    std::vector<SceneInstance> sceneInstances;
+    std::vector<glm::uvec2> submeshInstances;  // first instance, instance count per submesh
+    BufferResource submeshInstanceBuffer;      // submeshInstances for meshlet_cull.slang
+    // per frame, the model matrix of every scene instance (vertex shader and meshlet culling), persistently mapped
+    std::vector<BufferResource> instanceTransformBuffers;
+    // per frame, the model matrices of the frame recorded before it, for motion vectors (persistently mapped)
+    std::vector<BufferResource> instancePreviousTransformBuffers;
+    std::vector<glm::mat4> instancePreviousModels;  // every instance's model matrix as the last recorded frame drew it
+    FrameDirtyRanges<MAX_FRAMES_IN_FLIGHT> instancePreviousDirty;
+
+    // deforming geometry (DEFORM_MESHES): per frame animated vertices and BLASes refit from them
+    std::vector<uint32_t> deformedSubmeshes;
+    std::vector<int32_t> deformedSlot;  // per submesh: index into deformedSubmeshes, -1 for static geometry
+    // the per frame vertex buffers mirror vertexBuffer[0, deformedVertexCount)
+    uint32_t deformedVertexCount = 0;
+    glm::vec4 deformBounds       = glm::vec4(0.0f);  // center, radius of the deformed geometry in object space
+    std::vector<BufferResource> deformedVertexBuffers;
+    std::vector<BufferResource> deformScratchBuffers;       // per frame, one range per BLAS
+    std::vector<vk::DeviceAddress> deformScratchAddresses;  // per frame, aligned start of the ranges
+    std::vector<vk::DeviceSize> deformScratchOffsets;       // per BLAS, inside its frame's scratch buffer
+    std::vector<uint32_t> deformPrimitiveCounts;            // per BLAS
+    // BLAS of deformed submesh slot in frame f at [f * deformedSubmeshes.size() + slot]
+    std::vector<vk::raii::AccelerationStructureKHR> deformedBlasHandles;
+    std::vector<vk::raii::Buffer> deformedBlasBuffers;
+    std::vector<GpuAllocation> deformedBlasMemories;
+    std::vector<vk::DeviceAddress> deformedBlasAddresses;
+    std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> deformUpdateCount{};
+    std::vector<vk::raii::QueryPool> deformTimestampQueries;  // per frame: before the animation and after the BLAS update
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> deformTimestampsPending{};
+    float animationTime = 0.0f;  // seconds since startup, set with currentModelMatrix
+    DeformStats deformStats;
+    vk::raii::DescriptorSetLayout deformSetLayout = nullptr;
+    vk::raii::PipelineLayout deformPipelineLayout = nullptr;
+    vk::raii::Pipeline deformPipeline             = nullptr;
+    std::vector<vk::raii::DescriptorSet> deformDescriptorSets;
+
     std::vector<vk::raii::AccelerationStructureKHR> blasHandles;
     std::vector<vk::raii::Buffer> blasBuffers;
-    std::vector<vk::raii::DeviceMemory> blasMemories;
+    std::vector<GpuAllocation> blasMemories;
 
     std::vector<vk::raii::AccelerationStructureKHR> tlas;
     std::vector<vk::raii::Buffer> tlasBuffer;
-    std::vector<vk::raii::DeviceMemory> tlasMemory;
+    std::vector<GpuAllocation> tlasMemory;
     std::vector<vk::raii::Buffer> tlasScratchBuffer;
-    std::vector<vk::raii::DeviceMemory> tlasScratchMemory;
+    std::vector<GpuAllocation> tlasScratchMemory;
 
     void updateTLAS(const vk::raii::CommandBuffer& commandBuffer);
 
     std::vector<vk::raii::Buffer> instanceBuffer;
-    std::vector<vk::raii::DeviceMemory> instanceMemory;
+    std::vector<GpuAllocation> instanceMemory;
+    std::vector<vk::AccelerationStructureInstanceKHR*> instanceMapped;  // instanceBuffer[frame], persistently mapped
+    // device addresses of blasHandles, taken once when the instances are created
+    std::vector<vk::DeviceAddress> blasAddresses;
+    // instances whose transform has to be rewritten into instanceBuffer[frame] and instanceTransformBuffers[frame], one list per frame in flight
+    std::array<std::vector<uint32_t>, MAX_FRAMES_IN_FLIGHT> dirtyInstances;
+    std::vector<uint8_t> instanceDirtyMask;  // bit f: the instance is queued in dirtyInstances[f]
+    glm::mat4 instanceModelMatrix{1.0f};     // currentModelMatrix the instances were last marked dirty for
+    // refit or rebuild, decided per frame's TLAS
+    std::array<TlasRefitPolicy, MAX_FRAMES_IN_FLIGHT> tlasPolicies;
+    std::vector<vk::raii::QueryPool> tlasTimestampQueries;  // per frame: before and after the TLAS update
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> tlasTimestampsPending{};
+    uint64_t tlasTimestampMask = 0;  // valid timestamp bits, 0 without timestamp support
+    float tlasTimestampPeriod  = 0.0f;
+    TlasUpdateStats tlasStats;
+
+    void markInstanceDirty(uint32_t instance);
 
     vk::DeviceAddress getVertAddress(const vk::raii::Buffer& buffer) {
         vk::BufferDeviceAddressInfo vertex_addr_info{.buffer = *buffer};
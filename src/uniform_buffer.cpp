@@ -14,7 +14,7 @@ void HelloTriangleApplication::createUniformBuffers() {
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vk::DeviceSize bufferSize = sizeof(UniformBufferObject);
         vk::raii::Buffer buffer({});
-        vk::raii::DeviceMemory bufferMem({});
+        GpuAllocation bufferMem({});
         createBuffer(bufferSize,
                      vk::BufferUsageFlagBits::eUniformBuffer,
                      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
@@ -31,9 +31,14 @@ void HelloTriangleApplication::updateUniformBuffer(uint32_t currentImage) {
     // ubo.model = currentModelMatrix;
 
     ubo.view = camera.getViewMatrix();
-    ubo.proj =
-        glm::perspective(glm::radians(45.0f), static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height), 0.1f, 100.0f);
-    ubo.proj[1][1] *= -1;
+    ubo.proj = projectionMatrix();
+
+    // motion vectors reproject against the camera of the previous frame (the current one on the first frame)
+    CameraFrame frame{.viewProj = ubo.proj * ubo.view, .position = camera.pos, .forward = camera.front};
+    previousCameraFrame  = cameraHistoryValid ? currentCameraFrame : frame;
+    currentCameraFrame   = frame;
+    cameraHistoryValid   = true;
+    ubo.previousViewProj = previousCameraFrame.viewProj;
 
     memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
 }
@@ -0,0 +1,174 @@
+#include "upload_manager.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+void UploadManager::init(const vk::raii::Device& logicalDevice,
+                         const vk::raii::Queue& uploadQueue,
+                         uint32_t queueFamilyIndex,
+                         GpuAllocator& gpuAllocator,
+                         vk::DeviceSize size) {
+    device    = &logicalDevice;
+    queue     = &uploadQueue;
+    allocator = &gpuAllocator;
+
+    commandPool = vk::raii::CommandPool(
+        logicalDevice,
+        vk::CommandPoolCreateInfo{.flags            = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                  .queueFamilyIndex = queueFamilyIndex});
+
+    vk::BufferCreateInfo ringInfo{.size = size, .usage = vk::BufferUsageFlagBits::eTransferSrc, .sharingMode = vk::SharingMode::eExclusive};
+    ringSize   = size;
+    ringBuffer = vk::raii::Buffer(logicalDevice, ringInfo);
+    ringMemory = gpuAllocator.allocateBuffer(ringBuffer,
+                                             vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                                             GpuMemoryCategory::Staging);
+    ring       = static_cast<uint8_t*>(ringMemory.mapMemory(0, size));
+}
+
+UploadManager::Batch& UploadManager::recording() {
+    if (isRecording) return current;
+    collect(false);
+    if (!spare.empty()) {
+        current = std::move(spare.back());
+        spare.pop_back();
+        current.commandBuffer.reset();
+        device->resetFences(*current.fence);
+    } else {
+        vk::CommandBufferAllocateInfo allocInfo{.commandPool = commandPool, .level = vk::CommandBufferLevel::ePrimary, .commandBufferCount = 1};
+        current.commandBuffer = std::move(device->allocateCommandBuffers(allocInfo).front());
+        current.fence         = vk::raii::Fence(*device, vk::FenceCreateInfo{});
+    }
+    current.ringBegin = NO_RING_SPACE;
+    current.ringEnd   = 0;
+    current.commandBuffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    isRecording = true;
+    return current;
+}
+
+const vk::raii::CommandBuffer& UploadManager::commandBuffer() { return recording().commandBuffer; }
+
+/**
+ * @brief FIFO ring allocation: live data is [tail, head) or wraps around the end
+ *
+ * The tail is the first ring byte of the oldest batch that still uses the ring.
+ */
+vk::DeviceSize UploadManager::allocateRing(vk::DeviceSize size) {
+    vk::DeviceSize tail = NO_RING_SPACE;
+    for (const Batch& batch : submitted) {
+        if (batch.ringBegin != NO_RING_SPACE) {
+            tail = batch.ringBegin;
+            break;
+        }
+    }
+    if (tail == NO_RING_SPACE && isRecording) tail = current.ringBegin;
+    if (tail == NO_RING_SPACE) ringHead = 0;  // nothing in flight uses the ring
+
+    vk::DeviceSize offset = (ringHead + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+    if (tail == NO_RING_SPACE || ringHead > tail) {
+        if (offset + size > ringSize) {
+            // wrap: the bytes up to the end stay unused until the tail passes them
+            offset = 0;
+            if (tail != NO_RING_SPACE && size > tail) return NO_RING_SPACE;
+        }
+    } else if (ringHead == tail || offset + size > tail) {
+        return NO_RING_SPACE;  // head caught up with the tail
+    }
+    ringHead = offset + size;
+    return offset;
+}
+
+std::pair<vk::Buffer, vk::DeviceSize> UploadManager::allocateStaging(vk::DeviceSize size, uint8_t*& mapped) {
+    stagedBytes += size;
+    copyCount++;
+    if (size + RING_ALIGNMENT <= ringSize / 2) {
+        vk::DeviceSize offset = allocateRing(size);
+        while (offset == NO_RING_SPACE) {
+            // ring full: submit what we have and wait for the oldest batch to give space back
+            ringStalls++;
+            flush();
+            collect(true);
+            offset = allocateRing(size);
+        }
+        Batch& batch = recording();
+        if (batch.ringBegin == NO_RING_SPACE) batch.ringBegin = offset;
+        batch.ringEnd = ringHead;
+        mapped        = ring + offset;
+        return {*ringBuffer, offset};
+    }
+
+    // too large for the ring: a temporary staging buffer released with its batch
+    vk::raii::Buffer buffer(
+        *device, vk::BufferCreateInfo{.size = size, .usage = vk::BufferUsageFlagBits::eTransferSrc, .sharingMode = vk::SharingMode::eExclusive});
+    GpuAllocation memory = allocator->allocateBuffer(buffer,
+                                                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                     GpuMemoryCategory::Staging);
+    mapped               = static_cast<uint8_t*>(memory.mapMemory(0, size));
+    vk::Buffer handle    = *buffer;
+    recording().temporaries.emplace_back(std::move(buffer), std::move(memory));
+    return {handle, 0};
+}
+
+void* UploadManager::stageBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, vk::DeviceSize size) {
+    uint8_t* mapped              = nullptr;
+    auto [stagingBuffer, offset] = allocateStaging(size, mapped);
+    recording().commandBuffer.copyBuffer(stagingBuffer, dst, vk::BufferCopy{.srcOffset = offset, .dstOffset = dstOffset, .size = size});
+    return mapped;
+}
+
+void UploadManager::uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size) {
+    memcpy(stageBuffer(dst, dstOffset, size), data, static_cast<size_t>(size));
+}
+
+void UploadManager::uploadImage(vk::Image dst, vk::Extent3D extent, vk::ImageAspectFlags aspect, const void* data, vk::DeviceSize size) {
+    uint8_t* mapped              = nullptr;
+    auto [stagingBuffer, offset] = allocateStaging(size, mapped);
+    memcpy(mapped, data, static_cast<size_t>(size));
+    vk::BufferImageCopy region{.bufferOffset      = offset,
+                               .bufferRowLength   = 0,
+                               .bufferImageHeight = 0,
+                               .imageSubresource  = {aspect, 0, 0, 1},
+                               .imageOffset       = {0, 0, 0},
+                               .imageExtent       = extent};
+    recording().commandBuffer.copyBufferToImage(stagingBuffer, dst, vk::ImageLayout::eTransferDstOptimal, region);
+}
+
+void UploadManager::flush() {
+    if (!isRecording) return;
+    // everything submitted after this batch sees its writes
+    vk::MemoryBarrier2 barrier{.srcStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+                               .srcAccessMask = vk::AccessFlagBits2::eMemoryWrite,
+                               .dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+                               .dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite};
+    current.commandBuffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+    current.commandBuffer.end();
+
+    queue->submit(vk::SubmitInfo{.commandBufferCount = 1, .pCommandBuffers = &*current.commandBuffer}, *current.fence);
+    submitted.push_back(std::move(current));
+    current     = Batch{};
+    isRecording = false;
+    submitCount++;
+}
+
+void UploadManager::collect(bool waitOldest) {
+    if (waitOldest && !submitted.empty()) {
+        while (vk::Result::eTimeout == device->waitForFences(*submitted.front().fence, vk::True, UINT64_MAX));
+    }
+    while (!submitted.empty() && submitted.front().fence.getStatus() == vk::Result::eSuccess) {
+        Batch batch = std::move(submitted.front());
+        submitted.pop_front();
+        batch.temporaries.clear();
+        spare.push_back(std::move(batch));
+    }
+}
+
+void UploadManager::waitIdle() {
+    if (!device) return;
+    flush();
+    while (!submitted.empty()) collect(true);
+}
+
+void UploadManager::printStats(std::ostream& out) const {
+    out << "[Info] Uploads: " << copyCount << " copies, " << stagedBytes / 1024 << " KiB staged in " << submitCount << " submits, " << ringStalls
+        << " ring stalls" << std::endl;
+}
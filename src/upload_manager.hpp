@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "gpu_allocator.hpp"
+
+/**
+ * @brief batches host -> device uploads through a persistently mapped staging ring
+ *
+ * Copies and layout transitions are recorded into one command buffer per batch instead of a
+ * submit + queue.waitIdle() each. flush() submits the batch with a fence and returns; ring space is
+ * reclaimed once that fence signals. Every batch ends with a full memory barrier, so anything
+ * submitted to the queue after flush() sees the uploaded data.
+ * Uploads larger than the ring go through a temporary staging buffer that lives as long as its batch.
+ */
+class UploadManager {
+   public:
+    static constexpr vk::DeviceSize DEFAULT_RING_SIZE = 16ull << 20;
+
+    UploadManager()                                = default;
+    UploadManager(const UploadManager&)            = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+    ~UploadManager() { waitIdle(); }
+
+    void init(const vk::raii::Device& device,
+              const vk::raii::Queue& queue,
+              uint32_t queueFamilyIndex,
+              GpuAllocator& allocator,
+              vk::DeviceSize ringSize = DEFAULT_RING_SIZE);
+
+    // staging memory for size bytes that the current batch copies to dst + dstOffset; fill it before the next flush()
+    void* stageBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, vk::DeviceSize size);
+    void uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+    // tightly packed texels for mip 0 / layer 0; the image has to be in eTransferDstOptimal when the batch executes
+    void uploadImage(vk::Image dst, vk::Extent3D extent, vk::ImageAspectFlags aspect, const void* data, vk::DeviceSize size);
+
+    // the batch being recorded, for barriers that belong to the uploads (e.g. image layout transitions)
+    const vk::raii::CommandBuffer& commandBuffer();
+
+    // submit the current batch if it recorded anything, without waiting
+    void flush();
+    // flush and wait until every batch has executed
+    void waitIdle();
+
+    void printStats(std::ostream& out) const;
+
+   private:
+    static constexpr vk::DeviceSize NO_RING_SPACE  = ~vk::DeviceSize(0);
+    static constexpr vk::DeviceSize RING_ALIGNMENT = 16;  // covers the texel size and 4-byte rule of buffer -> image copies
+
+    struct Batch {
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        vk::raii::Fence fence                 = nullptr;
+        vk::DeviceSize ringBegin              = NO_RING_SPACE;  // first ring byte used by this batch
+        vk::DeviceSize ringEnd                = 0;              // ring head after its last allocation
+        std::vector<std::pair<vk::raii::Buffer, GpuAllocation>> temporaries;
+    };
+
+    Batch& recording();
+    // offset into the staging memory of the returned buffer, which is the ring or a temporary
+    std::pair<vk::Buffer, vk::DeviceSize> allocateStaging(vk::DeviceSize size, uint8_t*& mapped);
+    vk::DeviceSize allocateRing(vk::DeviceSize size);
+    // retire submitted batches whose fence has signalled (waiting for the oldest one first if asked)
+    void collect(bool waitOldest);
+
+    const vk::raii::Device* device    = nullptr;
+    const vk::raii::Queue* queue      = nullptr;
+    GpuAllocator* allocator           = nullptr;
+    vk::raii::CommandPool commandPool = nullptr;
+    vk::raii::Buffer ringBuffer       = nullptr;
+    GpuAllocation ringMemory          = nullptr;
+    uint8_t* ring                     = nullptr;
+    vk::DeviceSize ringSize           = 0;
+    vk::DeviceSize ringHead           = 0;
+
+    Batch current;
+    bool isRecording = false;
+    std::deque<Batch> submitted;  // oldest first
+    std::vector<Batch> spare;     // retired batches, command buffer and fence are reused
+
+    uint64_t submitCount = 0;
+    uint64_t copyCount   = 0;
+    uint64_t stagedBytes = 0;
+    uint64_t ringStalls  = 0;  // waits because the ring was full
+};
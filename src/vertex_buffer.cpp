@@ -1,34 +1,116 @@
+#include <map>
+
 #include "tutorial.hpp"
 
 void HelloTriangleApplication::createVertexBuffer() {
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
-
-    void* dataStaging = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(dataStaging, vertices.data(), bufferSize);
-    stagingBufferMemory.unmapMemory();
-
+    if (PACKED_VERTICES) {
+        if (!gltfModel) {
+            createPackedVertexBuffers(vertexView);
+            return;
+        }
+        // the packer wants one contiguous Vertex array: glTF primitives first, then the loader's own vertices
+        std::vector<Vertex> sceneVertices(gltfVertexCount + vertexView.size());
+        writeGltfVertices(reinterpret_cast<uint8_t*>(sceneVertices.data()));
+        std::copy(vertexView.begin(), vertexView.end(), sceneVertices.begin() + gltfVertexCount);
+        createPackedVertexBuffers(sceneVertices);
+        return;
+    }
+    // glTF primitives (if any) first, then the loader's own vertices
+    vk::DeviceSize sceneSize  = vk::DeviceSize(gltfVertexCount) * sizeof(Vertex);
+    vk::DeviceSize bufferSize = sceneSize + vertexView.size_bytes();
+    // also the rest pose of the deformation pass (storage buffer, copy source)
     createBuffer(bufferSize,
                  vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress |
-                     vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR,
+                     vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR | vk::BufferUsageFlagBits::eStorageBuffer |
+                     vk::BufferUsageFlagBits::eTransferSrc,
                  vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexBufferMemory);
 
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    // written straight into the staging ring, the copy runs with the next upload batch
+    uint8_t* dataStaging = static_cast<uint8_t*>(uploads.stageBuffer(*vertexBuffer, 0, bufferSize));
+    if (gltfModel) {
+        writeGltfVertices(dataStaging);
+    }
+    memcpy(dataStaging + sceneSize, vertexView.data(), vertexView.size_bytes());
 }
 
-uint32_t HelloTriangleApplication::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
-    vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
+/**
+ * @brief split sceneVertices into the PackedVertex position and attribute streams and build the material color table
+ *
+ * Vertex colors are constant per shape in practice, so the palette stays tiny; the last color is cached to
+ * skip the map lookup for runs of equal colors.
+ */
+void HelloTriangleApplication::createPackedVertexBuffers(std::span<const Vertex> sceneVertices) {
+    std::vector<uint8_t> positions(sceneVertices.size() * PackedVertex::positionStride);
+    std::vector<PackedVertex::Attributes> attributes(sceneVertices.size());
+    std::vector<glm::vec4> materialColors;
+    std::map<std::array<float, 3>, uint32_t> materialLookup;
+
+    std::array<float, 3> lastColor{};
+    uint32_t lastMaterial = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < sceneVertices.size(); i++) {
+        const Vertex& vertex = sceneVertices[i];
+        if (PACKED_POSITIONS_FP16) {
+            uint16_t packed[4] = {floatToHalf(vertex.pos.x), floatToHalf(vertex.pos.y), floatToHalf(vertex.pos.z), floatToHalf(1.0f)};
+            memcpy(&positions[i * PackedVertex::positionStride], packed, sizeof(packed));
+        } else {
+            memcpy(&positions[i * PackedVertex::positionStride], &vertex.pos, sizeof(vertex.pos));
+        }
+
+        PackedVertex::Attributes& packed = attributes[i];
+        encodeOctahedral(vertex.normal.x, vertex.normal.y, vertex.normal.z, packed.normal);
+        packed.texCoord[0] = floatToHalf(vertex.texCoord.x);
+        packed.texCoord[1] = floatToHalf(vertex.texCoord.y);
 
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
+        std::array<float, 3> color = {vertex.color.r, vertex.color.g, vertex.color.b};
+        if (lastMaterial == std::numeric_limits<uint32_t>::max() || color != lastColor) {
+            auto [it, inserted] = materialLookup.try_emplace(color, static_cast<uint32_t>(materialColors.size()));
+            if (inserted) {
+                materialColors.emplace_back(vertex.color, 1.0f);
+            }
+            lastColor    = color;
+            lastMaterial = it->second;
         }
+        packed.materialIndex = lastMaterial;
     }
-    throw std::runtime_error("failed to find suitable memory type!");
+    if (materialColors.empty()) {
+        materialColors.emplace_back(1.0f);  // keep the SSBO non-empty
+    }
+
+    createDeviceLocalBuffer(positions.data(),
+                            positions.size(),
+                            vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress |
+                                vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR | vk::BufferUsageFlagBits::eStorageBuffer |
+                                vk::BufferUsageFlagBits::eTransferSrc,
+                            vertexBuffer,
+                            vertexBufferMemory);
+    createDeviceLocalBuffer(attributes.data(),
+                            attributes.size() * sizeof(PackedVertex::Attributes),
+                            vk::BufferUsageFlagBits::eVertexBuffer,
+                            vertexAttributeBuffer,
+                            vertexAttributeBufferMemory);
+    materialBufferResource.size = materialColors.size() * sizeof(glm::vec4);
+    createDeviceLocalBuffer(materialColors.data(),
+                            materialBufferResource.size,
+                            vk::BufferUsageFlagBits::eStorageBuffer,
+                            materialBufferResource.buffer,
+                            materialBufferResource.memory);
+
+    vk::DeviceSize packedBytes = positions.size() + attributes.size() * sizeof(PackedVertex::Attributes);
+    std::cout << "[Info] Packed vertices: " << sceneVertices.size() << " vertices, " << materialColors.size() << " materials, "
+              << packedBytes / 1024 << " KiB (" << sceneVertices.size_bytes() / 1024 << " KiB unpacked)" << std::endl;
+}
+
+/**
+ * @brief create a device local buffer and queue its contents on the upload manager
+ *
+ * @param usage usage of the final buffer, eTransferDst is added
+ */
+void HelloTriangleApplication::createDeviceLocalBuffer(const void* data, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::raii::Buffer& buffer,
+                                                       GpuAllocation& bufferMemory) {
+    createBuffer(size, usage | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, buffer, bufferMemory);
+    uploads.uploadBuffer(*buffer, 0, data, size);
 }
+
 /**
  * @brief create a buffer object and allocate memory for it
  *
@@ -39,7 +121,7 @@ uint32_t HelloTriangleApplication::findMemoryType(uint32_t typeFilter, vk::Memor
  * @param bufferMemory
  */
 void HelloTriangleApplication::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
-                                            vk::raii::Buffer& buffer, vk::raii::DeviceMemory& bufferMemory) {
+                                            vk::raii::Buffer& buffer, GpuAllocation& bufferMemory) {
     /*
     we want create a host visible buffer that we can map and copy the vertex data to,
     then we want to create a device local buffer that will be used as the actual vertex buffer for
@@ -47,39 +129,35 @@ void HelloTriangleApplication::createBuffer(vk::DeviceSize size, vk::BufferUsage
     */
     vk::BufferCreateInfo bufferInfo{.size = size, .usage = usage, .sharingMode = vk::SharingMode::eExclusive};
     buffer = vk::raii::Buffer(device, bufferInfo);
-    vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
-    vk::MemoryAllocateInfo allocInfo{.allocationSize = memRequirements.size,
-                                     .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties)};
 
-    // for ray tracing usage, we need to set the memory allocate flag info
-    vk::MemoryAllocateFlagsInfo allocFlagsInfo{};
-    if (usage & vk::BufferUsageFlagBits::eShaderDeviceAddress) {
-        allocFlagsInfo.flags = vk::MemoryAllocateFlagBits::eDeviceAddress;
-        allocInfo.pNext = &allocFlagsInfo;
+    // sub-allocated from a shared block; the block was allocated with eDeviceAddress, so ray tracing inputs work as before
+    GpuMemoryCategory category = GpuMemoryCategory::Buffer;
+    if (usage & vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR) {
+        category = GpuMemoryCategory::AccelerationStructure;
+    } else if (usage == vk::BufferUsageFlagBits::eTransferSrc) {
+        category = GpuMemoryCategory::Staging;
     }
-    //
-    bufferMemory = vk::raii::DeviceMemory(device, allocInfo);
-    buffer.bindMemory(bufferMemory, 0);
+    // device addresses of acceleration structures (256) and build scratch memory need more than the usual buffer alignment
+    vk::DeviceSize minAlignment = (usage & vk::BufferUsageFlagBits::eShaderDeviceAddress) ? 256 : 1;
+    bufferMemory                = gpuAllocator.allocateBuffer(buffer, properties, category, minAlignment);
 }
 /**
  * @brief create index buffer
  */
 void HelloTriangleApplication::createIndexBuffer() {
-    vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
-
-    void* data = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(data, indices.data(), (size_t)bufferSize);
-    stagingBufferMemory.unmapMemory();
+    vk::DeviceSize sceneSize  = vk::DeviceSize(gltfIndexCount) * sizeof(uint32_t);
+    vk::DeviceSize bufferSize = sceneSize + indexView.size_bytes();
 
     createBuffer(bufferSize,
                  vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress |
                      vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR,
                  vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexBufferMemory);
 
-    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+    uint8_t* data = static_cast<uint8_t*>(uploads.stageBuffer(*indexBuffer, 0, bufferSize));
+    if (gltfModel) {
+        writeGltfIndices(reinterpret_cast<uint32_t*>(data));
+        // both buffers have been written, the parsed scene is no longer needed
+        gltfModel.reset();
+    }
+    memcpy(data + sceneSize, indexView.data(), indexView.size_bytes());
 }
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief scalar encoders for the packed vertex layout (PackedVertex in tutorial.hpp)
+ *
+ * The matching decoders live in shader.slang (vertMainPacked); the fixed-function vertex
+ * fetch already converts half and snorm16 formats, so only the octahedral mapping is undone there.
+ */
+
+/**
+ * @brief IEEE 754 binary32 -> binary16, round to nearest even, overflow to inf
+ */
+inline uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign     = (bits >> 16) & 0x8000u;
+    const uint32_t exponent = (bits >> 23) & 0xFFu;
+    uint32_t mantissa       = bits & 0x7FFFFFu;
+
+    if (exponent == 0xFF) return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));  // inf / nan
+    const int32_t e = static_cast<int32_t>(exponent) - 127 + 15;
+    if (e >= 0x1F) return static_cast<uint16_t>(sign | 0x7C00u);
+    if (e <= 0) {
+        // subnormal half (or zero)
+        if (e < -10) return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000u;
+        const uint32_t shift     = static_cast<uint32_t>(14 - e);
+        uint32_t half            = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        const uint32_t halfway   = 1u << (shift - 1u);
+        if (remainder > halfway || (remainder == halfway && (half & 1u))) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half            = (static_cast<uint32_t>(e) << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1FFFu;
+    // a carry out of the mantissa bumps the exponent, which is the correctly rounded result (up to inf)
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) half++;
+    return static_cast<uint16_t>(sign | half);
+}
+
+/**
+ * @brief unit vector -> octahedral map in snorm16 (R16G16_SNORM), under 0.05 degrees worst case error
+ *  a zero vector encodes as +Z
+ */
+inline void encodeOctahedral(float x, float y, float z, int16_t out[2]) {
+    const float l1 = std::fabs(x) + std::fabs(y) + std::fabs(z);
+    float u = 0.0f, v = 0.0f;
+    if (l1 > 0.0f) {
+        u = x / l1;
+        v = y / l1;
+        if (z < 0.0f) {
+            // fold the lower hemisphere over the diagonals
+            const float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+            const float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+            u                   = foldedU;
+            v                   = foldedV;
+        }
+    }
+    out[0] = static_cast<int16_t>(std::lround(std::clamp(u, -1.0f, 1.0f) * 32767.0f));
+    out[1] = static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+/**
+ * @brief Lock-free open-addressing table used to weld duplicate vertices across threads
+ *
+ * The table does not own keys. Every key is identified by its position p in a flat array
+ * (one entry per index of the source mesh) together with a precomputed 64-bit hash, and a
+ * slot stores the position of the first key published into it. Equal keys inserted from
+ * different threads land in the same slot, and the slot keeps the smallest position seen,
+ * which is the first occurrence in file order. Numbering unique keys by that position
+ * reproduces exactly what a single-threaded std::unordered_map pass would produce.
+ *
+ * Keys must be written before any insert and stay unchanged until the table is discarded.
+ */
+template <typename Key>
+class ConcurrentWeldTable {
+   public:
+    static constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * @brief create a table for up to maxKeys insertions (capacity is kept at <= 50% load)
+     */
+    explicit ConcurrentWeldTable(size_t maxKeys) {
+        capacity = std::bit_ceil(std::max<size_t>(16, maxKeys * 2));
+        mask     = capacity - 1;
+        slots    = std::make_unique<std::atomic<uint32_t>[]>(capacity);
+        firstPos = std::make_unique<std::atomic<uint32_t>[]>(capacity);
+        for (size_t i = 0; i < capacity; i++) {
+            slots[i].store(EMPTY, std::memory_order_relaxed);
+            firstPos[i].store(EMPTY, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief insert the key at position p, return the slot holding its equivalence class
+     *
+     * @param keys   flat key array shared by all threads
+     * @param hashes hash of every key in keys
+     * @param p      position of the key to insert
+     */
+    uint32_t insert(const Key* keys, const uint64_t* hashes, uint32_t p) {
+        const uint64_t h = hashes[p];
+        size_t slot      = static_cast<size_t>(h) & mask;
+        for (;;) {
+            uint32_t owner = slots[slot].load(std::memory_order_acquire);
+            if (owner == EMPTY) {
+                if (slots[slot].compare_exchange_strong(owner, p, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    fetchMin(firstPos[slot], p);
+                    return static_cast<uint32_t>(slot);
+                }
+                // lost the race, owner now holds the winner: fall through and compare against it
+            }
+            if (hashes[owner] == h && keys[owner] == keys[p]) {
+                fetchMin(firstPos[slot], p);
+                return static_cast<uint32_t>(slot);
+            }
+            slot = (slot + 1) & mask;  // linear probing
+        }
+    }
+
+    /**
+     * @brief position of the first occurrence of the key stored in slot (valid once all inserts finished)
+     */
+    uint32_t firstOccurrence(uint32_t slot) const { return firstPos[slot].load(std::memory_order_relaxed); }
+
+   private:
+    static void fetchMin(std::atomic<uint32_t>& target, uint32_t value) {
+        uint32_t current = target.load(std::memory_order_relaxed);
+        while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed));
+    }
+
+    size_t capacity = 0;
+    size_t mask     = 0;
+    std::unique_ptr<std::atomic<uint32_t>[]> slots;
+    std::unique_ptr<std::atomic<uint32_t>[]> firstPos;
+};